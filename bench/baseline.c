@@ -0,0 +1,100 @@
+/* Native baseline for bench/binding.js: runs one of its cases with the
+   objective and constraints written in C instead of JavaScript and prints
+   {"evaluations": ..., "seconds": ...} (evaluations of the first repetition,
+   seconds summed over all of them).  The functions, starting point, bounds and
+   settings must stay the same as in binding.js, so that the difference in
+   time is what the binding adds.
+
+   usage: binding_baseline call|evaluation|gradient|mconstraint n m maxeval repetitions */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "nlopt.h"
+#include "nlopt-util.h"
+
+static int evaluations;
+
+/* Rosenbrock's function of the first and the last parameter */
+static double objective(unsigned n, const double *x, double *grad, void *data)
+{
+    double a = x[n - 1] - x[0] * x[0], b = 1 - x[0];
+    (void) data;
+    ++evaluations;
+    if (grad) {
+        memset(grad, 0, sizeof(double) * n);
+        grad[0] = -400 * a * x[0] - 2 * b;
+        grad[n - 1] += 200 * a;
+    }
+    return 100 * a * a + b * b;
+}
+
+/* x[0] + x[1] <= 3 + i, none of them active at the minimum */
+static void mconstraint(unsigned m, double *result, unsigned n, const double *x, double *grad, void *data)
+{
+    unsigned i;
+    (void) n;
+    (void) grad;
+    (void) data;
+    for (i = 0; i < m; ++i)
+        result[i] = x[0] + x[1] - 3 - i;
+}
+
+int main(int argc, char **argv)
+{
+    const char *name = argc == 6 ? argv[1] : "";
+    unsigned n = argc == 6 ? (unsigned) atoi(argv[2]) : 0, m = argc == 6 ? (unsigned) atoi(argv[3]) : 0, i;
+    int maxeval = argc == 6 ? atoi(argv[4]) : 0, repetitions = argc == 6 ? atoi(argv[5]) : 0, rep, first = -1;
+    nlopt_algorithm algorithm;
+    double *x, *lb, *ub, *tol, minf, seconds = 0;
+
+    if (!strcmp(name, "call") || !strcmp(name, "evaluation"))
+        algorithm = NLOPT_LN_SBPLX;
+    else if (!strcmp(name, "gradient"))
+        algorithm = NLOPT_LD_MMA;
+    else if (!strcmp(name, "mconstraint"))
+        algorithm = NLOPT_LN_COBYLA;
+    else
+        n = 0;
+    if (n < 2 || repetitions < 1) {
+        fprintf(stderr, "usage: binding_baseline call|evaluation|gradient|mconstraint n m maxeval repetitions\n");
+        return EXIT_FAILURE;
+    }
+    x = (double *) malloc(sizeof(double) * (3 * n + m + 1));
+    if (!x) {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+    lb = x + n;
+    ub = lb + n;
+    tol = ub + n;
+    for (i = 0; i < n; ++i) {
+        lb[i] = -1;
+        ub[i] = 2;
+    }
+    memset(tol, 0, sizeof(double) * (m + 1));
+
+    for (rep = 0; rep < repetitions; ++rep) {
+        /* everything nlopt() does per call, as in binding.js */
+        double start = nlopt_seconds();
+        nlopt_opt opt = nlopt_create(algorithm, n);
+        nlopt_set_min_objective(opt, objective, NULL);
+        nlopt_set_lower_bounds(opt, lb);
+        nlopt_set_upper_bounds(opt, ub);
+        nlopt_set_maxeval(opt, maxeval);
+        if (m > 0)
+            nlopt_add_inequality_mconstraint(opt, m, mconstraint, NULL, tol);
+        for (i = 0; i < n; ++i)
+            x[i] = 0.5;
+        evaluations = 0;
+        nlopt_optimize(opt, x, &minf);
+        nlopt_destroy(opt);
+        seconds += nlopt_seconds() - start;
+        if (first < 0)
+            first = evaluations;
+    }
+    printf("{\"evaluations\": %d, \"seconds\": %.9g}\n", first, seconds);
+    free(x);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,111 @@
+// What the binding costs on top of NLopt: runs the same optimizations with a
+// trivial JavaScript objective through nlopt() and with the same functions in C
+// (build/Release/binding_baseline, see baseline.c), and writes both times and
+// their difference to a JSON file for compare.js:
+//   node bench/binding.js [output.json]       (default bench/binding.json)
+// The cases are
+//   call         nlopt() with a single evaluation: option copying, validation, setup
+//   evaluation   LN_SBPLX at n = 2 ... 1e5: passing x to the objective and the value back
+//   gradient     LD_MMA at n = 2 ... 1e5: the gradient's round trip on top of that
+//   mconstraint  LN_COBYLA with m = 1 ... 1000 constraints in one inequalityMConstraints callback
+var path = require('path');
+var fs = require('fs');
+var childProcess = require('child_process');
+var nlopt = require('../nlopt.js');
+
+var baseline = path.join(__dirname, '..', 'build', 'Release', 'binding_baseline' + (process.platform == 'win32' ? '.exe' : ''));
+if (!fs.existsSync(baseline)) {
+  console.error(baseline + " is missing; build it with npm install --nlopt_bench=1 (or npm run bench:binding)");
+  process.exit(2);
+}
+var output = process.argv[2] || path.join(__dirname, 'binding.json');
+
+var cases = [{name: 'call', n: 2, m: 0, maxEval: 1, repetitions: 5000}];
+[[2, 2000, 50], [10, 2000, 20], [100, 2000, 10], [1000, 500, 10], [10000, 100, 5], [100000, 20, 3]].forEach(function(c) {
+  cases.push({name: 'evaluation', n: c[0], m: 0, maxEval: c[1], repetitions: c[2]});
+});
+[[2, 200, 200], [10, 200, 100], [100, 200, 50], [1000, 200, 10], [10000, 100, 5], [100000, 20, 3]].forEach(function(c) {
+  cases.push({name: 'gradient', n: c[0], m: 0, maxEval: c[1], repetitions: c[2]});
+});
+[[1, 500, 20], [10, 500, 20], [100, 500, 5], [1000, 200, 3]].forEach(function(c) {
+  cases.push({name: 'mconstraint', n: 2, m: c[0], maxEval: c[1], repetitions: c[2]});
+});
+
+// the same functions as in baseline.c
+var evaluations = 0;
+var objective = function(n, x, grad) {
+  evaluations++;
+  var a = x[n - 1] - x[0] * x[0], b = 1 - x[0];
+  if (grad) {
+    for (var i = 1; i < n - 1; i++) grad[i] = 0;
+    grad[0] = -400 * a * x[0] - 2 * b;
+    grad[n - 1] = 200 * a;
+  }
+  return 100 * a * a + b * b;
+};
+var mconstraint = function(m, n, x, grad) {
+  var result = new Float64Array(m);
+  for (var i = 0; i < m; i++) result[i] = x[0] + x[1] - 3 - i;
+  return result;
+};
+
+var fill = function(n, value) {
+  var a = new Array(n);
+  for (var i = 0; i < n; i++) a[i] = value;
+  return a;
+};
+
+var runJs = function(c) {
+  var options = {
+    algorithm: {call: 'LN_SBPLX', evaluation: 'LN_SBPLX', gradient: 'LD_MMA', mconstraint: 'LN_COBYLA'}[c.name],
+    numberOfParameters: c.n,
+    minObjectiveFunction: objective,
+    lowerBounds: fill(c.n, -1),
+    upperBounds: fill(c.n, 2),
+    initialGuess: fill(c.n, 0.5),
+    maxEval: c.maxEval
+  };
+  if (c.m > 0) {
+    options.inequalityMConstraints = [{callback: mconstraint, tolerances: fill(c.m, 0)}];
+  }
+  nlopt(options); // warm up the JIT
+  var first = -1, nanoseconds = 0n;
+  for (var rep = 0; rep < c.repetitions; rep++) {
+    evaluations = 0;
+    var start = process.hrtime.bigint();
+    nlopt(options);
+    nanoseconds += process.hrtime.bigint() - start;
+    if (first < 0) first = evaluations;
+  }
+  return {evaluations: first, seconds: Number(nanoseconds) * 1e-9};
+};
+
+var runNative = function(c) {
+  var out = childProcess.execFileSync(baseline, [c.name, c.n, c.m, c.maxEval, c.repetitions].map(String), {encoding: 'utf8'});
+  return JSON.parse(out);
+};
+
+var results = cases.map(function(c) {
+  var js = runJs(c), native = runNative(c);
+  var overhead = js.seconds - native.seconds;
+  var units = c.name == 'call' ? c.repetitions : js.evaluations * c.repetitions;
+  var record = {
+    case: c.name, n: c.n, m: c.m, maxEval: c.maxEval, repetitions: c.repetitions,
+    evaluations: js.evaluations, native_evaluations: native.evaluations,
+    seconds: js.seconds, native_seconds: native.seconds, overhead_seconds: overhead,
+    // per call for 'call', per evaluation otherwise
+    overhead_micros: units > 0 ? overhead * 1e6 / units : null
+  };
+  console.error(c.name + " n=" + c.n + " m=" + c.m + ": " + (record.overhead_micros === null ? "-" : record.overhead_micros.toFixed(3)) + " us overhead per " + (c.name == 'call' ? "call" : "evaluation"));
+  return record;
+});
+
+fs.writeFileSync(output, JSON.stringify({
+  benchmark: 'binding',
+  version: require('../package.json').version,
+  settings: {node: process.version, platform: process.platform + '-' + process.arch},
+  key: ['case', 'n', 'm'],
+  metrics: {evaluations: 'exact', native_evaluations: 'exact', seconds: 'time', native_seconds: 'time', overhead_seconds: 'time'},
+  results: results
+}, null, 2) + '\n');
+console.error("wrote " + output);
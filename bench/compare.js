@@ -0,0 +1,98 @@
+// Compares two benchmark JSON files (from nlopt_bench or the bench/ suite) and
+// flags the records of the second that regressed against the first:
+//   node bench/compare.js old.json new.json [--threshold 0.2] [--min-seconds 0.001]
+// Records are matched on the fields listed in the file's "key"; "metrics"
+// says how each field is judged:
+//   exact   any change (e.g. status, evaluation count: the algorithm's path changed)
+//   time    new > old*(1+threshold) and new-old > --min-seconds
+//   memory  new > old*(1+threshold) and new-old > --min-kb
+//   error   new > old*(1+threshold) + --min-error
+// The exit status is 1 if anything regressed, so the script can gate a change.
+var fs = require('fs');
+
+var options = {threshold: 0.2, 'min-seconds': 0.001, 'min-kb': 1024, 'min-error': 1e-6};
+var files = [];
+for (var i = 2; i < process.argv.length; i++) {
+  var arg = process.argv[i];
+  if (arg.substr(0, 2) == '--') {
+    var name = arg.substr(2);
+    if (!(name in options) || !(i + 1 < process.argv.length) || isNaN(parseFloat(process.argv[i + 1]))) {
+      console.error("unknown option or missing value: " + arg);
+      process.exit(2);
+    }
+    options[name] = parseFloat(process.argv[++i]);
+  }
+  else {
+    files.push(arg);
+  }
+}
+if (files.length != 2) {
+  console.error("usage: node bench/compare.js old.json new.json [--threshold 0.2] [--min-seconds 0.001] [--min-kb 1024] [--min-error 1e-6]");
+  process.exit(2);
+}
+
+var before = JSON.parse(fs.readFileSync(files[0], 'utf8'));
+var after = JSON.parse(fs.readFileSync(files[1], 'utf8'));
+var key = after.key, metrics = after.metrics;
+if (JSON.stringify(before.key) != JSON.stringify(key)) {
+  console.error("the files don't describe the same benchmark (key " + JSON.stringify(before.key) + " vs " + JSON.stringify(key) + ")");
+  process.exit(2);
+}
+if (JSON.stringify(before.settings) != JSON.stringify(after.settings)) {
+  console.warn("warning: different settings " + JSON.stringify(before.settings) + " vs " + JSON.stringify(after.settings));
+}
+
+var recordKey = function(record) {
+  return key.map(function(field) { return record[field]; }).join(' / ');
+};
+var old = {};
+before.results.forEach(function(record) { old[recordKey(record)] = record; });
+
+// null is how the benchmarks write a value that doesn't exist (failed runs)
+var worse = function(kind, a, b) {
+  var t = options.threshold;
+  if (kind == 'exact') return a !== b;
+  if (a === null || b === null) return b === null && a !== null;
+  if (kind == 'time') return b > a * (1 + t) && b - a > options['min-seconds'];
+  if (kind == 'memory') return b > a * (1 + t) && b - a > options['min-kb'];
+  if (kind == 'error') return b > a * (1 + t) + options['min-error'];
+  return false;
+};
+
+var regressions = [], missing = [], ratios = {}, seen = {};
+after.results.forEach(function(record) {
+  var k = recordKey(record), prev = old[k];
+  seen[k] = true;
+  if (!prev) {
+    missing.push("only in " + files[1] + ": " + k);
+    return;
+  }
+  // a run cut short by maxtime does a different amount of work every time
+  var timedOut = prev.status == 'MAXTIME_REACHED' && record.status == 'MAXTIME_REACHED';
+  Object.keys(metrics).forEach(function(field) {
+    var kind = metrics[field], a = prev[field], b = record[field];
+    if (!(timedOut && kind != 'time') && worse(kind, a, b)) {
+      regressions.push(k + ": " + field + " " + a + " -> " + b);
+    }
+    // the overall change in each time, over the records long enough to measure
+    if (kind == 'time' && a > options['min-seconds'] && b > 0) {
+      (ratios[field] = ratios[field] || []).push(b / a);
+    }
+  });
+});
+Object.keys(old).forEach(function(k) {
+  if (!seen[k]) missing.push("only in " + files[0] + ": " + k);
+});
+
+Object.keys(ratios).forEach(function(field) {
+  var r = ratios[field];
+  var logSum = r.reduce(function(sum, x) { return sum + Math.log(x); }, 0);
+  console.log(field + ": geometric mean ratio " + Math.exp(logSum / r.length).toFixed(3) + " over " + r.length + " records (new/old)");
+});
+missing.forEach(function(line) { console.log(line); });
+if (regressions.length) {
+  console.log(regressions.length + " regression(s):");
+  regressions.forEach(function(line) { console.log("  " + line); });
+  process.exit(1);
+}
+console.log("no regressions in " + after.results.length + " records");
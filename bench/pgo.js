@@ -0,0 +1,87 @@
+// Builds the addon and nloptlib with profile-guided and link-time optimization
+// (see nlopt-2.10.0/pgo.gypi) and reports the speedup of each algorithm:
+//   node bench/pgo.js [node-gyp options]      (npm run build:pgo)
+// 1. a plain build, timed with nlopt_bench       -> bench/pgo-before.json
+// 2. an instrumented build (--nlopt_pgo=generate), trained by running
+//    nlopt_bench over the test functions and bench/binding.js through the addon
+// 3. a rebuild with the profiles and -flto (--nlopt_pgo=use), timed again
+//                                                -> bench/pgo-after.json
+// The per-algorithm totals of nlopt_bench's solver time go to bench/pgo.json.
+// The addon is left built in the optimized configuration.
+var path = require('path');
+var fs = require('fs');
+var childProcess = require('child_process');
+
+var root = path.join(__dirname, '..');
+var release = path.join(root, 'build', 'Release');
+var profileDir = path.join(root, 'pgo-profile');
+var exe = process.platform == 'win32' ? '.exe' : '';
+if (process.platform == 'win32') {
+  console.error("profile-guided builds need GCC or clang");
+  process.exit(2);
+}
+
+var run = function(file, args) {
+  console.error("> " + [file].concat(args).join(' '));
+  childProcess.execFileSync(file, args, {cwd: root, stdio: 'inherit'});
+};
+// npm run sets npm_config_node_gyp to the node-gyp it bundles
+var nodeGyp = function(args) {
+  args = ['rebuild', '--nlopt_bench=1'].concat(args, process.argv.slice(2));
+  if (process.env.npm_config_node_gyp) run(process.execPath, [process.env.npm_config_node_gyp].concat(args));
+  else run('node-gyp', args);
+};
+var bench = function(output, args) {
+  run(path.join(release, 'nlopt_bench' + exe), args.concat(['-O', output]));
+};
+
+nodeGyp([]);
+bench(path.join(__dirname, 'pgo-before.json'), []);
+
+fs.rmSync(profileDir, {recursive: true, force: true});
+fs.mkdirSync(profileDir);
+nodeGyp(['--nlopt_pgo=generate', '--nlopt_pgo_dir=' + profileDir]);
+// one pass over every algorithm and function, with a different seed from the
+// timed runs, and the binding's own paths
+var training = path.join(profileDir, 'training.json');
+bench(training, ['-i', '1', '-t', '0.5', '-r', '2']);
+run(process.execPath, [path.join(__dirname, 'binding.js'), path.join(profileDir, 'binding.json')]);
+// clang writes raw profiles that have to be merged first
+var raw = fs.readdirSync(profileDir).filter(function(file) { return /\.profraw$/.test(file); });
+if (raw.length) {
+  run('llvm-profdata', ['merge', '-o', path.join(profileDir, 'default.profdata')].concat(raw.map(function(file) {
+    return path.join(profileDir, file);
+  })));
+}
+
+nodeGyp(['--nlopt_pgo=use', '--nlopt_pgo_dir=' + profileDir]);
+bench(path.join(__dirname, 'pgo-after.json'), []);
+
+// per algorithm, the solver time over the cases that succeeded in both runs
+var load = function(name) { return JSON.parse(fs.readFileSync(path.join(__dirname, name), 'utf8')).results; };
+var before = {}, totals = {};
+load('pgo-before.json').forEach(function(r) { before[r.algorithm + '/' + r.function + '/' + r.n] = r; });
+load('pgo-after.json').forEach(function(r) {
+  var b = before[r.algorithm + '/' + r.function + '/' + r.n];
+  if (!b || b.minf === null || r.minf === null) return;
+  var t = totals[r.algorithm] = totals[r.algorithm] || {algorithm: r.algorithm, before_seconds: 0, after_seconds: 0};
+  t.before_seconds += b.solver_seconds;
+  t.after_seconds += r.solver_seconds;
+});
+var algorithms = Object.keys(totals).map(function(a) {
+  var t = totals[a];
+  t.speedup = t.after_seconds > 0 ? t.before_seconds / t.after_seconds : null;
+  return t;
+}).sort(function(a, b) { return b.before_seconds - a.before_seconds; });
+var logSum = 0, count = 0;
+algorithms.forEach(function(t) {
+  if (t.speedup) {
+    logSum += Math.log(t.speedup);
+    count++;
+  }
+  console.log(t.algorithm + new Array(Math.max(2, 24 - t.algorithm.length)).join(' ') +
+    (t.before_seconds * 1e3).toFixed(2) + " ms -> " + (t.after_seconds * 1e3).toFixed(2) + " ms  x" + (t.speedup ? t.speedup.toFixed(2) : "-"));
+});
+var geomean = count ? Math.exp(logSum / count) : null;
+console.log("geometric mean speedup over " + count + " algorithms: x" + (geomean ? geomean.toFixed(3) : "-"));
+fs.writeFileSync(path.join(__dirname, 'pgo.json'), JSON.stringify({geometric_mean_speedup: geomean, algorithms: algorithms}, null, 2) + '\n');
@@ -1,8 +1,12 @@
 {
+  "includes": [ "./nlopt-2.10.0/pgo.gypi" ],
+  "variables": {
+    "nlopt_bench%": 0
+  },
   "targets": [
     {
       "target_name": "nlopt",
-      "sources": [ "nlopt.cc" ],
+      "sources": [ "nlopt.cc", "evalstore.cc", "evaltrace.cc", "instrumentation.cc", "timeline.cc", "progress.cc" ],
        "include_dirs": [
 	     "./nlopt-2.10.0/src/api/",
         "<!(node -e \"require('nan')\")"
@@ -11,5 +15,25 @@
        		"./nlopt-2.10.0/nlopt.gyp:nloptlib"
     	]
     }
+  ],
+  "conditions": [
+    ["nlopt_bench==1", {
+      "targets": [
+        {
+          "target_name": "binding_baseline",
+          "type": "executable",
+          "sources": [ "bench/baseline.c" ],
+          "include_dirs": [
+            "./nlopt-2.10.0/",
+            "./nlopt-2.10.0/src/api/",
+            "./nlopt-2.10.0/src/util/"
+          ],
+          "dependencies": [
+            "./nlopt-2.10.0/nlopt.gyp:nloptlib",
+            "./nlopt-2.10.0/nlopt.gyp:nlopt_bench"
+          ]
+        }
+      ]
+    }]
   ]
 }
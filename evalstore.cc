@@ -0,0 +1,354 @@
+#include "evalstore.h"
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+const char MAGIC[8] = {'N', 'L', 'O', 'P', 'T', 'E', 'V', 'S'};
+const uint32_t VERSION = 1;
+const uint32_t RECORD_TAG = 0x31434552; // "REC1"
+const uint64_t COMMIT_SALT = 0x9e3779b97f4a7c15ULL;
+const uint64_t MIN_MAPPING = 1 << 16;
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t n;
+  uint32_t fingerprintLength;
+  uint32_t reserved;
+  // followed by the fingerprint, padded to a multiple of 8 bytes
+};
+
+struct RecordHeader {
+  uint32_t tag;
+  int32_t fid;
+  uint32_t m;
+  uint32_t hasGrad;
+  uint64_t hash;
+  // followed by x[n], values[m], grad[m*n] if hasGrad, and the commit word
+};
+
+inline uint64_t align8(uint64_t v) {
+  return (v + 7) & ~(uint64_t)7;
+}
+
+}
+
+EvalStore::EvalStore()
+  : hits(0), misses(0), fd(-1), n(0), base(NULL), mapped(0), size(0), dataStart(0), scanned(0), used(0) {
+}
+
+EvalStore::~EvalStore() {
+#ifndef _WIN32
+  if (base) {
+    munmap((void*)base, mapped);
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+#endif
+}
+
+#ifdef _WIN32
+
+EvalStore* EvalStore::open(const char*, const std::string&, unsigned, std::string& err) {
+  err = "evaluation stores are not supported on this platform";
+  return NULL;
+}
+
+bool EvalStore::lookup(int, unsigned, const double*, double*, double*) { return false; }
+void EvalStore::append(int, unsigned, const double*, const double*, const double*) {}
+
+#else
+
+EvalStore* EvalStore::open(const char* path, const std::string& fingerprint, unsigned n, std::string& err) {
+  EvalStore* s = new EvalStore();
+  s->n = n;
+  s->fd = ::open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+  if (s->fd < 0) {
+    err = std::string("cannot open ") + path + ": " + strerror(errno);
+    delete s;
+    return NULL;
+  }
+
+  // create or validate the header while holding the lock, so two processes
+  // creating the same store don't both write one
+  flock(s->fd, LOCK_EX);
+  struct stat st;
+  fstat(s->fd, &st);
+  FileHeader h;
+  s->dataStart = align8(sizeof(FileHeader) + fingerprint.size());
+  if (st.st_size == 0) {
+    std::vector<unsigned char> header(s->dataStart, 0);
+    memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.n = n;
+    h.fingerprintLength = fingerprint.size();
+    h.reserved = 0;
+    memcpy(header.data(), &h, sizeof(h));
+    memcpy(header.data() + sizeof(h), fingerprint.data(), fingerprint.size());
+    if (write(s->fd, header.data(), header.size()) != (ssize_t)header.size()) {
+      err = std::string("cannot write ") + path + ": " + strerror(errno);
+    }
+  }
+  else if (pread(s->fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h) || memcmp(h.magic, MAGIC, sizeof(MAGIC)) || h.version != VERSION) {
+    err = std::string(path) + " is not an evaluation store";
+  }
+  else if (h.n != n) {
+    err = std::string(path) + " was recorded for a different numberOfParameters";
+  }
+  else {
+    std::string stored(h.fingerprintLength, '\0');
+    if (pread(s->fd, &stored[0], stored.size(), sizeof(h)) != (ssize_t)stored.size() || stored != fingerprint) {
+      err = std::string(path) + " was recorded for a different problem fingerprint";
+    }
+  }
+  flock(s->fd, LOCK_UN);
+  if (!err.empty()) {
+    delete s;
+    return NULL;
+  }
+
+  s->scanned = s->dataStart;
+  s->slots.assign(1024, 0);
+  s->scan();
+  return s;
+}
+
+uint64_t EvalStore::recordSize(unsigned m, bool hasGrad) const {
+  return sizeof(RecordHeader) + sizeof(double) * ((uint64_t)n + m + (hasGrad ? (uint64_t)m * n : 0)) + sizeof(uint64_t);
+}
+
+uint64_t EvalStore::keyHash(int fid, const double* x) const {
+  uint64_t h = 14695981039346656037ULL ^ (uint32_t)fid; // FNV-1a
+  for (unsigned i = 0; i < n; ++i) {
+    double xi = x[i] == 0 ? 0.0 : x[i]; // -0 == +0
+    uint64_t bits;
+    memcpy(&bits, &xi, sizeof(bits));
+    for (int b = 0; b < 8; ++b, bits >>= 8) {
+      h = (h ^ (bits & 0xff)) * 1099511628211ULL;
+    }
+  }
+  return h;
+}
+
+// Picks up the current size of the file. The mapping is reserved past the
+// end of the file and doubled when the file outgrows it, so it is only
+// replaced a logarithmic number of times; pages past `size` are never read.
+bool EvalStore::remap() {
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (uint64_t)st.st_size <= size) {
+    return false;
+  }
+  if ((uint64_t)st.st_size > mapped) {
+    uint64_t length = std::max<uint64_t>(std::max<uint64_t>(st.st_size, 2 * mapped), MIN_MAPPING);
+    void* p = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+      length = st.st_size;
+      p = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+      if (p == MAP_FAILED) {
+        return false;
+      }
+    }
+    if (base) {
+      munmap((void*)base, mapped);
+    }
+    base = (const unsigned char*)p;
+    mapped = length;
+  }
+  size = st.st_size;
+  return true;
+}
+
+// Whether a whole record whose commit word (and key hash) matches starts at
+// offset; the record may be unaligned after a torn one.
+bool EvalStore::committed(uint64_t offset) {
+  RecordHeader r;
+  if (offset + sizeof(r) > size) {
+    return false;
+  }
+  memcpy(&r, base + offset, sizeof(r));
+  if (r.tag != RECORD_TAG || r.hasGrad > 1) {
+    return false;
+  }
+  uint64_t end = offset + recordSize(r.m, r.hasGrad);
+  uint64_t commit;
+  if (end > size) {
+    return false;
+  }
+  memcpy(&commit, base + end - sizeof(commit), sizeof(commit));
+  if (commit != (r.hash ^ COMMIT_SALT)) {
+    return false;
+  }
+  key.resize(n);
+  memcpy(key.data(), base + offset + sizeof(r), sizeof(double) * n);
+  return keyHash(r.fid, key.data()) == r.hash;
+}
+
+// Index the committed records past `scanned`. Appends are serialized by the
+// lock, so a record that isn't committed is either still being written, if
+// nothing committed follows it (stop there and pick it up on a later scan),
+// or was torn by a writer that died or ran out of space, and is skipped by
+// resynchronizing on the next committed record. The bytes already in the
+// file never change, so there is nothing new to find unless it has grown.
+void EvalStore::scan() {
+  if (!remap()) {
+    return;
+  }
+  while (scanned < size) {
+    if (committed(scanned)) {
+      RecordHeader r;
+      memcpy(&r, base + scanned, sizeof(r));
+      indexRecord(scanned);
+      scanned += recordSize(r.m, r.hasGrad);
+      continue;
+    }
+    uint64_t next = scanned + 1;
+    while (next + sizeof(RecordHeader) <= size && !committed(next)) {
+      ++next;
+    }
+    if (next + sizeof(RecordHeader) > size) {
+      break;
+    }
+    scanned = next;
+  }
+}
+
+int64_t EvalStore::find(int fid, unsigned m, const double* x, uint64_t hash) const {
+  size_t mask = slots.size() - 1;
+  for (size_t i = hash & mask; slots[i]; i = (i + 1) & mask) {
+    uint64_t offset = slots[i] - 1;
+    RecordHeader r;
+    memcpy(&r, base + offset, sizeof(r));
+    if (r.hash == hash && r.fid == fid && r.m == m &&
+        !memcmp(base + offset + sizeof(r), x, sizeof(double) * n)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void EvalStore::indexRecord(uint64_t offset) {
+  RecordHeader r;
+  memcpy(&r, base + offset, sizeof(r));
+  const double* x = (const double*)(base + offset + sizeof(r));
+  int64_t i = find(r.fid, r.m, x, r.hash);
+  if (i >= 0) {
+    // keep whichever copy has a gradient
+    RecordHeader old;
+    memcpy(&old, base + slots[i] - 1, sizeof(old));
+    if (r.hasGrad || !old.hasGrad) {
+      slots[i] = offset + 1;
+    }
+    return;
+  }
+  if (2 * (used + 1) > slots.size()) {
+    std::vector<uint64_t> old;
+    old.swap(slots);
+    slots.assign(2 * old.size(), 0);
+    size_t mask = slots.size() - 1;
+    for (size_t k = 0; k < old.size(); ++k) {
+      if (old[k]) {
+        RecordHeader o;
+        memcpy(&o, base + old[k] - 1, sizeof(o));
+        size_t j = o.hash & mask;
+        while (slots[j]) {
+          j = (j + 1) & mask;
+        }
+        slots[j] = old[k];
+      }
+    }
+  }
+  size_t mask = slots.size() - 1;
+  size_t j = r.hash & mask;
+  while (slots[j]) {
+    j = (j + 1) & mask;
+  }
+  slots[j] = offset + 1;
+  ++used;
+}
+
+bool EvalStore::lookup(int fid, unsigned m, const double* x, double* result, double* grad) {
+  uint64_t hash = keyHash(fid, x);
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    int64_t i = base ? find(fid, m, x, hash) : -1;
+    if (i >= 0) {
+      const unsigned char* p = base + slots[i] - 1;
+      RecordHeader r;
+      memcpy(&r, p, sizeof(r));
+      if (!grad || r.hasGrad) {
+        p += sizeof(r) + sizeof(double) * n;
+        memcpy(result, p, sizeof(double) * m);
+        if (grad) {
+          memcpy(grad, p + sizeof(double) * m, sizeof(double) * m * n);
+        }
+        ++hits;
+        return true;
+      }
+    }
+    if (attempt == 0) {
+      scan(); // pick up records appended since the last scan, by us or others
+    }
+  }
+  ++misses;
+  return false;
+}
+
+void EvalStore::append(int fid, unsigned m, const double* x, const double* result, const double* grad) {
+  RecordHeader r;
+  r.tag = RECORD_TAG;
+  r.fid = fid;
+  r.m = m;
+  r.hasGrad = grad != NULL;
+  r.hash = keyHash(fid, x);
+  uint64_t size = recordSize(m, grad != NULL);
+  uint64_t commit = r.hash ^ COMMIT_SALT;
+  buffer.resize(size);
+  unsigned char* p = buffer.data();
+  memcpy(p, &r, sizeof(r));
+  p += sizeof(r);
+  memcpy(p, x, sizeof(double) * n);
+  p += sizeof(double) * n;
+  memcpy(p, result, sizeof(double) * m);
+  p += sizeof(double) * m;
+  if (grad) {
+    memcpy(p, grad, sizeof(double) * m * n);
+    p += sizeof(double) * m * n;
+  }
+  memcpy(p, &commit, sizeof(commit));
+  // O_APPEND under the lock keeps records contiguous when several processes
+  // share the file. The commit word goes in a write of its own after the
+  // rest, so a record cut short (the process dies, the disk fills up) is
+  // never committed and scans skip it. The file is never shrunk: that would
+  // make the pages other processes have mapped past the new end fault.
+  flock(fd, LOCK_EX);
+  if (writeAll(buffer.data(), size - sizeof(commit))) {
+    writeAll(buffer.data() + size - sizeof(commit), sizeof(commit));
+  }
+  flock(fd, LOCK_UN);
+}
+
+bool EvalStore::writeAll(const unsigned char* p, uint64_t length) {
+  while (length > 0) {
+    ssize_t written = write(fd, p, length);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    p += written;
+    length -= written;
+  }
+  return true;
+}
+
+#endif
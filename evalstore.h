@@ -0,0 +1,56 @@
+#ifndef NODE_NLOPT_EVALSTORE_H
+#define NODE_NLOPT_EVALSTORE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Persistent, append-only store of function evaluations shared across runs
+// (and processes). The file is a header (magic, dimension, problem
+// fingerprint) followed by fixed-layout records
+//   {tag, fid, m, hasGrad, hash, x[n], values[m], grad[m*n] (if hasGrad), commit}
+// appended under an exclusive flock, the commit word last. Readers map the
+// file and keep an open-addressing index (hash -> record offset) in memory
+// that is built by scanning the records once and then extended as the file
+// grows, so other processes' appends become visible without any coordination
+// beyond the lock. Records that were never committed are skipped.
+class EvalStore {
+public:
+  // Returns NULL and sets err if the file can't be opened or belongs to a
+  // different problem (fingerprint or dimension mismatch).
+  static EvalStore* open(const char* path, const std::string& fingerprint, unsigned n, std::string& err);
+  ~EvalStore();
+
+  // fid identifies the function (0 = objective, then the constraints in
+  // registration order). A record without a gradient doesn't satisfy a
+  // lookup that needs one.
+  bool lookup(int fid, unsigned m, const double* x, double* result, double* grad);
+  void append(int fid, unsigned m, const double* x, const double* result, const double* grad);
+
+  unsigned hits, misses;
+
+private:
+  EvalStore();
+  bool remap();
+  bool committed(uint64_t offset);
+  void scan();
+  bool writeAll(const unsigned char* p, uint64_t length);
+  void indexRecord(uint64_t offset);
+  int64_t find(int fid, unsigned m, const double* x, uint64_t hash) const;
+  uint64_t keyHash(int fid, const double* x) const;
+  uint64_t recordSize(unsigned m, bool hasGrad) const;
+
+  int fd;
+  unsigned n;
+  const unsigned char* base;  // read-only mapping of the whole file
+  uint64_t mapped;            // bytes mapped, past the end of the file
+  uint64_t size;              // bytes in the file, as of the last remap
+  uint64_t dataStart;         // offset of the first record
+  uint64_t scanned;           // offset up to which records are indexed
+  std::vector<uint64_t> slots; // open addressing: record offset + 1, 0 = empty
+  size_t used;
+  std::vector<unsigned char> buffer; // record being appended
+  std::vector<double> key;    // x of a record being checked, aligned
+};
+
+#endif
@@ -0,0 +1,143 @@
+#include "evaltrace.h"
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <chrono>
+
+namespace {
+
+const char MAGIC[8] = {'N', 'L', 'O', 'P', 'T', 'T', 'R', 'C'};
+const uint32_t VERSION = 1;
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t n;
+  uint32_t algorithm;
+  uint32_t reserved;
+};
+
+struct RecordHeader {
+  int32_t fid;
+  uint32_t m;
+  uint32_t hasGrad;
+  uint32_t reserved;
+  uint64_t requested;
+  uint64_t answered;
+};
+
+}
+
+EvalTrace::EvalTrace()
+  : count(0), diverged(-1), n(0), out(NULL), start(0), position(0) {
+}
+
+EvalTrace::~EvalTrace() {
+  if (out) {
+    fclose(out);
+  }
+}
+
+uint64_t EvalTrace::now() const {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count() - start;
+}
+
+EvalTrace* EvalTrace::record(const char* path, unsigned n, unsigned algorithm, std::string& err) {
+  EvalTrace* t = new EvalTrace();
+  t->n = n;
+  t->out = fopen(path, "wb");
+  if (!t->out) {
+    err = std::string("cannot create ") + path + ": " + strerror(errno);
+    delete t;
+    return NULL;
+  }
+  FileHeader h;
+  memcpy(h.magic, MAGIC, sizeof(MAGIC));
+  h.version = VERSION;
+  h.n = n;
+  h.algorithm = algorithm;
+  h.reserved = 0;
+  fwrite(&h, sizeof(h), 1, t->out);
+  t->start = t->now();
+  return t;
+}
+
+EvalTrace* EvalTrace::replay(const char* path, unsigned n, unsigned algorithm, std::string& err) {
+  FILE* in = fopen(path, "rb");
+  if (!in) {
+    err = std::string("cannot open ") + path + ": " + strerror(errno);
+    return NULL;
+  }
+  EvalTrace* t = new EvalTrace();
+  t->n = n;
+  unsigned char chunk[65536];
+  size_t got;
+  while ((got = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+    t->data.insert(t->data.end(), chunk, chunk + got);
+  }
+  fclose(in);
+
+  FileHeader h;
+  if (t->data.size() < sizeof(h) || (memcpy(&h, t->data.data(), sizeof(h)), memcmp(h.magic, MAGIC, sizeof(MAGIC))) || h.version != VERSION) {
+    err = std::string(path) + " is not an evaluation trace";
+  }
+  else if (h.n != n) {
+    err = std::string(path) + " was recorded for a different numberOfParameters";
+  }
+  else if (h.algorithm != algorithm) {
+    err = std::string(path) + " was recorded with a different algorithm";
+  }
+  if (!err.empty()) {
+    delete t;
+    return NULL;
+  }
+  t->position = sizeof(h);
+  return t;
+}
+
+void EvalTrace::write(int fid, unsigned m, const double* x, const double* result, const double* grad, uint64_t requested, uint64_t answered) {
+  RecordHeader r;
+  r.fid = fid;
+  r.m = m;
+  r.hasGrad = grad != NULL;
+  r.reserved = 0;
+  r.requested = requested;
+  r.answered = answered;
+  fwrite(&r, sizeof(r), 1, out);
+  fwrite(x, sizeof(double), n, out);
+  fwrite(result, sizeof(double), m, out);
+  if (grad) {
+    fwrite(grad, sizeof(double), (size_t)m * n, out);
+  }
+  ++count;
+}
+
+bool EvalTrace::next(int fid, unsigned m, const double* x, double* result, double* grad) {
+  RecordHeader r;
+  const unsigned char* p = data.data() + position;
+  bool ok = diverged < 0 && position + sizeof(r) <= data.size();
+  if (ok) {
+    memcpy(&r, p, sizeof(r));
+    size_t size = sizeof(r) + sizeof(double) * (n + m + (r.hasGrad ? (size_t)m * n : 0));
+    ok = r.fid == fid && r.m == m && (!grad || r.hasGrad) && position + size <= data.size() &&
+         !memcmp(p + sizeof(r), x, sizeof(double) * n);
+    if (ok) {
+      p += sizeof(r) + sizeof(double) * n;
+      memcpy(result, p, sizeof(double) * m);
+      if (grad) {
+        memcpy(grad, p + sizeof(double) * m, sizeof(double) * m * n);
+      }
+      position += size;
+      ++count;
+      return true;
+    }
+  }
+  if (diverged < 0) {
+    diverged = count;
+  }
+  for (unsigned i = 0; i < m; ++i) {
+    result[i] = HUGE_VAL;
+  }
+  return false;
+}
@@ -0,0 +1,48 @@
+#ifndef NODE_NLOPT_EVALTRACE_H
+#define NODE_NLOPT_EVALTRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Binary trace of every evaluation request/response of one optimization:
+// a header (magic, dimension, algorithm) followed by records
+//   {fid, m, hasGrad, reserved, requested, answered, x[n], values[m], grad[m*n] (if hasGrad)}
+// with timestamps in nanoseconds since the start of the run.
+//
+// Recording streams records to the file as they happen. Replaying loads a
+// trace and answers each request from the next record, without calling the
+// objective, so the solver can be benchmarked or profiled on its own; a
+// request that doesn't match the next record (different function, point, or
+// a gradient that wasn't recorded) means the run diverged from the trace.
+class EvalTrace {
+public:
+  static EvalTrace* record(const char* path, unsigned n, unsigned algorithm, std::string& err);
+  static EvalTrace* replay(const char* path, unsigned n, unsigned algorithm, std::string& err);
+  ~EvalTrace();
+
+  bool replaying() const { return !out; }
+
+  // Recording: called around the real evaluation.
+  uint64_t now() const;
+  void write(int fid, unsigned m, const double* x, const double* result, const double* grad, uint64_t requested, uint64_t answered);
+
+  // Replaying: fills result/grad from the next record; returns false (and
+  // sets diverged) if the request doesn't match it.
+  bool next(int fid, unsigned m, const double* x, double* result, double* grad);
+
+  uint64_t count;        // records written or replayed
+  int64_t diverged;      // index of the first mismatching request, or -1
+
+private:
+  EvalTrace();
+
+  unsigned n;
+  FILE* out;
+  uint64_t start;
+  std::vector<unsigned char> data; // replay: the whole trace
+  size_t position;
+};
+
+#endif
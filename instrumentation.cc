@@ -0,0 +1,61 @@
+#include "instrumentation.h"
+#include <math.h>
+
+LatencyHistogram::LatencyHistogram()
+  : count(0), min(UINT64_MAX), max(0), total(0), counts(BUCKETS, 0) {
+}
+
+unsigned LatencyHistogram::bucketOf(uint64_t ns) {
+  if (ns < (1U << SUB_BITS)) {
+    return ns;
+  }
+#if defined(__GNUC__)
+  unsigned e = 63 - __builtin_clzll(ns); // e >= SUB_BITS
+#else
+  unsigned e = SUB_BITS;
+  while (ns >> (e + 1)) {
+    ++e;
+  }
+#endif
+  unsigned sub = (ns >> (e - SUB_BITS)) & ((1U << SUB_BITS) - 1);
+  return (1U << SUB_BITS) + (e - SUB_BITS) * (1U << SUB_BITS) + sub;
+}
+
+uint64_t LatencyHistogram::upperBound(unsigned bucket) {
+  if (bucket < (1U << SUB_BITS)) {
+    return bucket;
+  }
+  unsigned e = (bucket >> SUB_BITS) - 1 + SUB_BITS;
+  uint64_t sub = bucket & ((1U << SUB_BITS) - 1);
+  return (((1ULL << SUB_BITS) + sub + 1) << (e - SUB_BITS)) - 1;
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+  ++counts[bucketOf(ns)];
+  ++count;
+  total += ns;
+  if (ns < min) {
+    min = ns;
+  }
+  if (ns > max) {
+    max = ns;
+  }
+}
+
+uint64_t LatencyHistogram::percentile(double q) const {
+  if (!count) {
+    return 0;
+  }
+  // nearest rank: the smallest value with at least q * count values <= it
+  uint64_t rank = (uint64_t)ceil(q * count), seen = 0;
+  if (rank < 1) {
+    rank = 1;
+  }
+  for (unsigned b = 0; b < BUCKETS; ++b) {
+    seen += counts[b];
+    if (seen >= rank) {
+      return upperBound(b) < max ? upperBound(b) : max;
+    }
+  }
+  return max;
+}
@@ -0,0 +1,50 @@
+#ifndef NODE_NLOPT_INSTRUMENTATION_H
+#define NODE_NLOPT_INSTRUMENTATION_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <chrono>
+
+inline uint64_t monotonicNanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Latency histogram in the style of HdrHistogram: a value v (ns) falls into
+// the power-of-two range containing it, split into 2^SUB_BITS linear
+// sub-buckets, so every bucket is within 1/8 relative precision of its values
+// while the whole 64-bit range fits into a fixed, small array.
+class LatencyHistogram {
+public:
+  static const unsigned SUB_BITS = 3;
+  static const unsigned BUCKETS = (1 << SUB_BITS) + (64 - SUB_BITS) * (1 << SUB_BITS);
+
+  LatencyHistogram();
+  void record(uint64_t ns);
+  // Upper bound (ns) of the bucket containing the q-quantile, 0 <= q <= 1.
+  uint64_t percentile(double q) const;
+  static uint64_t upperBound(unsigned bucket);
+
+  uint64_t count, min, max, total;
+  std::vector<uint64_t> counts; // BUCKETS entries
+
+private:
+  static unsigned bucketOf(uint64_t ns);
+};
+
+struct FunctionStats {
+  std::string name;
+  uint64_t evaluations;
+  LatencyHistogram latency; // time inside the JS callback
+};
+
+struct Instrumentation {
+  Instrumentation() : callbackNs(0), gcNs(0), gcCount(0) {}
+
+  std::vector<FunctionStats> functions; // indexed by function id
+  uint64_t callbackNs;
+  uint64_t gcNs, gcCount;
+};
+
+#endif
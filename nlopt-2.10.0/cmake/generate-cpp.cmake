@@ -36,6 +36,7 @@ foreach (NLOPT_HPP_LINE ${NLOPT_HPP_LINES})
   if (NLOPT_HPP_LINE MATCHES "GEN_ENUMS_HERE")
     file (APPEND ${CMAKE_CURRENT_BINARY_DIR}/nlopt.hpp "  enum algorithm {\n")
     file (STRINGS ${API_SOURCE_DIR}/nlopt.h NLOPT_H_LINES REGEX "    NLOPT_[A-Z0-9_]+")
+    # only the algorithm and result enums, which come first
     foreach (NLOPT_H_LINE ${NLOPT_H_LINES})
       string (REGEX REPLACE "NLOPT_" "" ENUM_LINE ${NLOPT_H_LINE})
       file (APPEND ${CMAKE_CURRENT_BINARY_DIR}/nlopt.hpp "${ENUM_LINE}\n")
@@ -43,6 +44,7 @@ foreach (NLOPT_HPP_LINE ${NLOPT_HPP_LINES})
         file (APPEND ${CMAKE_CURRENT_BINARY_DIR}/nlopt.hpp "  };\n  enum result {\n")
       elseif (NLOPT_H_LINE MATCHES "NLOPT_NUM_RESULTS")
         file (APPEND ${CMAKE_CURRENT_BINARY_DIR}/nlopt.hpp "  };\n")
+        break ()
       endif ()
     endforeach ()
   endif ()
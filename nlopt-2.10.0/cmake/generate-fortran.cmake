@@ -14,5 +14,7 @@ foreach (NLOPT_H_LINE ${NLOPT_H_LINES})
     set (ENUM_LINE "      integer NLOPT_${ENUM_STRING}\n      parameter (NLOPT_${ENUM_STRING}=${i})\n")
     file (APPEND ${CMAKE_CURRENT_BINARY_DIR}/nlopt.f "${ENUM_LINE}")
     math (EXPR i "${i} + 1")
+  elseif (NLOPT_H_LINE MATCHES "NLOPT_NUM_RESULTS")
+    break ()  # only the algorithm and result enums
   endif ()
 endforeach ()
@@ -1,11 +1,18 @@
-{'targets': [{
+{'includes': [ 'pgo.gypi' ],
+'targets': [{
   'target_name': 'nloptlib',
   'variables': {
-    'nloptversion': '2.10'
+    'nloptversion': '2.10',
+    # set to 1 (e.g. npm install --nlopt_slsqp_blas=1) to use the system BLAS in SLSQP
+    'nlopt_slsqp_blas%': 0,
+    # set to 1 (npm install --nlopt_profile=1) to time the algorithms' inner phases
+    'nlopt_profile%': 0
   },
   'type': 'static_library',
 		# Overcomes an issue with the linker and thin .a files on SmartOS
   'standalone_static_library': 1,
+  # no OpenMP: the eval_threads parameter would call the JavaScript
+  # constraint callbacks off the main thread, so it is not compiled in
   'defines': [
     'SNAPPY=1'
   ],
@@ -104,6 +111,7 @@
     './src/util/mt19937ar.c',
     './src/util/sobolseq.c',
     './src/util/soboldata.h',
+    './src/util/sobolextdata.h',
     './src/util/timer.c',
     './src/util/stop.c',
     './src/util/nlopt-util.h',
@@ -111,6 +119,7 @@
     './src/util/redblack.h',
     './src/util/qsort_r.c',
     './src/util/rescale.c',
+    './src/util/evalcache.c',
     './src/algs/stogo/global.cc',
     './src/algs/stogo/linalg.cc',
     './src/algs/stogo/local.cc',
@@ -124,6 +133,19 @@
     './src/algs/stogo/tools.h'
   ],
   'conditions': [
+      ['nlopt_profile==1', {
+        'defines': [
+          'NLOPT_PROFILE'
+        ]
+      }],
+      ['nlopt_slsqp_blas==1', {
+        'defines': [
+          'NLOPT_SLSQP_BLAS'
+        ],
+        'link_settings': {
+          'libraries': [ '-lblas' ]
+        }
+      }],
       ['OS=="win"', {
         'defines': [
           'TIME_WITH_SYS_TIME 0',
@@ -140,7 +162,35 @@
           'HAVE_COPYSIGN=1',
           'HAVE_ISINF=1',
           'HAVE_ISNAN=1',
-          'HAVE_GETTIMEOFDAY=1'
+          'HAVE_GETTIMEOFDAY=1',
+          'HAVE_CLOCK_GETTIME=1'
         ]
   }]]
+},
+{
+  # solver throughput over the test functions, as JSON (see README); built
+  # into build/Release with npm install --nlopt_bench=1
+  'target_name': 'nlopt_bench',
+  'type': 'executable',
+  'dependencies': [
+    'nloptlib'
+  ],
+  'include_dirs': [
+    '.',
+    './src/util/',
+    './src/api/',
+  ],
+  'sources': [
+    './test/nlopt_bench.c',
+    './test/testfuncs.c',
+    './test/testfuncs.h',
+    './src/util/nlopt-getopt.c',
+    './src/util/nlopt-getopt.h'
+  ],
+  'conditions': [
+      ['OS!="win"', {
+        'link_settings': {
+          'libraries': [ '-lm' ]
+        }
+      }]]
 }]}
\ No newline at end of file
@@ -10,6 +10,18 @@ int auglag_verbose = 0;
 #define MIN(a,b) ((a) < (b) ? (a) : (b))
 #define MAX(a,b) ((a) > (b) ? (a) : (b))
 
+/* with warm_start, each subsidiary optimization starts with a step of
+   AUGLAG_WARM_STEP times the distance moved by the previous one, but no
+   less than AUGLAG_WARM_MINSTEP times (and no more than) its original
+   initial step.  (Tuned over a grid of 5..100 and 1e-4..1e-1 on three
+   small problems -- the t_tutorial problem, a 6-variable problem with two
+   equality constraints, and HS071 -- with every subsidiary algorithm that
+   uses the initial step: it had the fewest evaluations in total, and there
+   was a broad optimum around it.  Smaller steps can leave COBYLA stuck at
+   an infeasible point; test/t_auglag_warm.c checks the carried step.) */
+#define AUGLAG_WARM_STEP 30
+#define AUGLAG_WARM_MINSTEP 1e-3
+
 /***************************************************************************/
 
 typedef struct {
@@ -73,12 +85,13 @@ nlopt_result auglag_minimize(int n, nlopt_func f, void *f_data,
 			     double *x, /* in: initial guess, out: minimizer */
 			     double *minf,
 			     nlopt_stopping *stop,
-			     nlopt_opt sub_opt, int sub_has_fc)
+			     nlopt_opt sub_opt, int sub_has_fc, int warm_start)
 {
      auglag_data d;
      nlopt_result ret = NLOPT_SUCCESS;
      double ICM = HUGE_VAL, minf_penalty = HUGE_VAL, penalty;
      double *xcur = NULL, fcur;
+     double *dx0 = NULL, *dx = NULL, *xstart = NULL;
      int i, ii, feasible, minf_feasible = 0;
      unsigned int k;
      int auglag_iters = 0;
@@ -128,7 +141,8 @@ nlopt_result auglag_minimize(int n, nlopt_func f, void *f_data,
 
      xcur = (double *) malloc(sizeof(double) * (n
 						+ max_constraint_dim * (1 + n)
-						+ d.pp + d.mm));
+						+ d.pp + d.mm
+						+ (warm_start ? 3*n : 0)));
      if (!xcur) return NLOPT_OUT_OF_MEMORY;
      memcpy(xcur, x, sizeof(double) * n);
 
@@ -138,6 +152,19 @@ nlopt_result auglag_minimize(int n, nlopt_func f, void *f_data,
      d.lambda = d.gradtmp + n * max_constraint_dim;
      d.mu = d.lambda + d.pp;
 
+     /* warm start: rather than letting each subsidiary optimization
+	start over from its initial step (its trust region, simplex size,
+	etc.), start it from the size of the step taken by the previous
+	one, since after the first outer iteration the penalty updates
+	only shift the minimum by a small amount */
+     if (warm_start) {
+	  dx0 = d.mu + d.mm;
+	  dx = dx0 + n;
+	  xstart = dx + n;
+	  ret = nlopt_get_initial_step(sub_opt, xcur, dx0);
+	  if (ret < 0) goto done;
+     }
+
      *minf = HUGE_VAL;
 
      /* starting rho suggested by B & M */
@@ -190,6 +217,8 @@ nlopt_result auglag_minimize(int n, nlopt_func f, void *f_data,
      do {
 	  double prev_ICM = ICM;
 	  
+	  nlopt_stop_iteration(stop);
+	  if (warm_start) memcpy(xstart, xcur, sizeof(double) * n);
 	  ret = nlopt_optimize_limited(sub_opt, xcur, &fcur,
 				       stop->maxeval - *(stop->nevals_p),
 				       stop->maxtime - (nlopt_seconds() 
@@ -197,6 +226,14 @@ nlopt_result auglag_minimize(int n, nlopt_func f, void *f_data,
 	  if (auglag_verbose)
 	       printf("auglag: subopt return code %d\n", ret);
 	  if (ret < 0) break;
+
+	  if (warm_start) {
+	       for (k = 0; k < (unsigned) n; ++k)
+		    dx[k] = MIN(dx0[k],
+				MAX(AUGLAG_WARM_STEP * fabs(xcur[k] - xstart[k]),
+				    AUGLAG_WARM_MINSTEP * dx0[k]));
+	       nlopt_set_initial_step(sub_opt, dx);
+	  }
 	  
 	  ++ *(d.stop->nevals_p);
 	  fcur = f(n, xcur, NULL, f_data);
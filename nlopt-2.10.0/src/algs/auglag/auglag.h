@@ -40,7 +40,7 @@ nlopt_result auglag_minimize(int n, nlopt_func f, void *f_data,
 			     double *x, /* in: initial guess, out: minimizer */
 			     double *minf,
 			     nlopt_stopping *stop,
-			     nlopt_opt sub_opt, int sub_has_fc);
+			     nlopt_opt sub_opt, int sub_has_fc, int warm_start);
 
 #ifdef __cplusplus
 }  /* extern "C" */
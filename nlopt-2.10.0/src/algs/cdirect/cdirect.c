@@ -73,6 +73,8 @@ typedef struct {
      double *work; /* workspace, of length >= 2*n */
      int *iwork; /* workspace, length >= n */
      double minf, *xmin; /* minimum so far */
+     double *bx, *bf; /* batch objective workspace, 2n points (or NULL) */
+     int ibf, nbf; /* next and number of values in bf to consume */
      
      /* red-black tree of hyperrects, sorted by (d,f,age) in
 	lexographical order */
@@ -133,8 +135,11 @@ static void sort_fv(int n, double *fv, int *isort)
      nlopt_qsort_r(isort, (unsigned) n, sizeof(int), fv, sort_fv_compare);
 }
 
+/* evaluate f at x, or take the next value from a batch evaluated
+   beforehand at the same points in the same order */
 static double function_eval(const double *x, params *p) {
-     double f = p->f(p->n, x, NULL, p->f_data);
+     double f = p->ibf < p->nbf ? p->bf[p->ibf++]
+	  : p->f(p->n, x, NULL, p->f_data);
      if (f < p->minf) {
 	  p->minf = f;
 	  memcpy(p->xmin, x, sizeof(double) * p->n);
@@ -171,6 +176,20 @@ static nlopt_result divide_rect(double *rdiv, params *p)
 	     function value along that direction */
 	  double *fv = p->work;
 	  int *isort = p->iwork;
+	  if (p->bx) { /* evaluate all 2*nlongest points with one call */
+	       int nb = 0;
+	       for (i = 0; i < n; ++i)
+		    if (wmax - w[i] <= wmax * EQUAL_SIDE_TOL) {
+			 int k;
+			 for (k = 0; k <= 1; ++k, ++nb) {
+			      memcpy(p->bx + nb*n, c, sizeof(double) * n);
+			      p->bx[nb*n + i] += w[i] * THIRD * (2*k-1);
+			 }
+		    }
+	       p->ibf = 0;
+	       p->nbf = (int) nlopt_eval_batch(p->stop, (unsigned) nb,
+					       (unsigned) n, p->bx, p->bf);
+	  }
 	  for (i = 0; i < n; ++i) {
 	       if (wmax - w[i] <= wmax * EQUAL_SIDE_TOL) {
 		    double csave = c[i];
@@ -184,6 +203,7 @@ static nlopt_result divide_rect(double *rdiv, params *p)
 		    fv[2*i] = fv[2*i+1] = HUGE_VAL;
 	       }
 	  }
+	  p->nbf = 0;
 	  sort_fv(n, fv, isort);
 	  if (!(node = nlopt_rb_tree_find(&p->rtree, rdiv)))
 	       return NLOPT_FAILURE;
@@ -395,13 +415,16 @@ static nlopt_result divide_good_rects(params *p)
      double **hull;
      int nhull, i, xtol_reached = 1, divided_some = 0;
      double magic_eps = p->magic_eps;
+     double thull;
 
      if (p->hull_len < p->rtree.N) {
 	  p->hull_len += p->rtree.N;
 	  p->hull = (double **) realloc(p->hull, sizeof(double*)*p->hull_len);
 	  if (!p->hull) return NLOPT_OUT_OF_MEMORY;
      }
+     thull = NLOPT_PHASE_START(p->stop);
      nhull = convex_hull(&p->rtree, hull = p->hull, p->which_opt != 1);
+     NLOPT_PHASE_STOP(p->stop, NLOPT_PHASE_HULL, thull);
  divisions:
      for (i = 0; i < nhull; ++i) {
 	  double K1 = -HUGE_VAL, K2 = -HUGE_VAL, K;
@@ -499,6 +522,8 @@ nlopt_result cdirect_unscaled(int n, nlopt_func f, void *f_data,
      p.minf = HUGE_VAL;
      p.work = 0;
      p.iwork = 0;
+     p.bx = p.bf = 0;
+     p.ibf = p.nbf = 0;
      p.hull = 0;
      p.age = 0;
 
@@ -508,6 +533,11 @@ nlopt_result cdirect_unscaled(int n, nlopt_func f, void *f_data,
      if (!p.work) goto done;
      p.iwork = (int *) malloc(sizeof(int) * n);
      if (!p.iwork) goto done;
+     if (stop->batch) {
+	  p.bx = (double *) malloc(sizeof(double) * (2*n) * (n+1));
+	  if (!p.bx) goto done;
+	  p.bf = p.bx + 2*n*n;
+     }
      p.hull_len = 128; /* start with a reasonable number */
      p.hull = (double **) malloc(sizeof(double *) * p.hull_len);
      if (!p.hull) goto done;
@@ -530,6 +560,7 @@ nlopt_result cdirect_unscaled(int n, nlopt_func f, void *f_data,
 
      while (1) {
 	  double minf0 = p.minf;
+	  nlopt_stop_iteration(p.stop);
 	  ret = divide_good_rects(&p);
 	  if (ret != NLOPT_SUCCESS) goto done;
 	  if (p.minf < minf0 && nlopt_stop_f(p.stop, p.minf, minf0)) {
@@ -543,6 +574,7 @@ nlopt_result cdirect_unscaled(int n, nlopt_func f, void *f_data,
      free(p.hull);
      free(p.iwork);
      free(p.work);
+     free(p.bx);
 	      
      *minf = p.minf;
      return ret;
@@ -566,6 +598,26 @@ double cdirect_uf(unsigned n, const double *xu, double *grad, void *d_)
      return f;
 }
 
+/* the same for a batch objective, unscaling count points at once */
+typedef struct {
+     const cdirect_uf_data *d;
+     nlopt_batch_func fb;
+     void *fb_data;
+     double *xs; /* unscaled points */
+} cdirect_ufb_data;
+
+static void cdirect_ufb(unsigned count, unsigned n, const double *xu,
+			double *f, void *d_)
+{
+     cdirect_ufb_data *d = (cdirect_ufb_data *) d_;
+     unsigned i, k;
+     for (k = 0; k < count; ++k)
+	  for (i = 0; i < n; ++i)
+	       d->xs[k*n+i] = d->d->lb[i]
+		    + xu[k*n+i] * (d->d->ub[i] - d->d->lb[i]);
+     d->fb(count, n, d->xs, f, d->fb_data);
+}
+
 nlopt_result cdirect(int n, nlopt_func f, void *f_data,
                      const double *lb, const double *ub,
                      double *x,
@@ -574,6 +626,7 @@ nlopt_result cdirect(int n, nlopt_func f, void *f_data,
                      double magic_eps, int which_alg)
 {
      cdirect_uf_data d;
+     cdirect_ufb_data db;
      nlopt_result ret;
      const double *xtol_abs_save = NULL;
      int i;
@@ -581,6 +634,14 @@ nlopt_result cdirect(int n, nlopt_func f, void *f_data,
      d.f = f; d.f_data = f_data; d.lb = lb; d.ub = ub;
      d.x = (double *) calloc(n * (stop->xtol_abs ? 4 : 3), sizeof(double));
      if (!d.x) return NLOPT_OUT_OF_MEMORY;
+     db.fb = stop->batch; db.fb_data = stop->batch_data;
+     if (db.fb) { /* divide_rect batches up to 2n points */
+	  db.d = &d;
+	  db.xs = (double *) malloc(sizeof(double) * (2*n) * n);
+	  if (!db.xs) { free(d.x); return NLOPT_OUT_OF_MEMORY; }
+	  stop->batch = cdirect_ufb;
+	  stop->batch_data = &db;
+     }
      
      for (i = 0; i < n; ++i) {
 	  x[i] = (x[i] - lb[i]) / (ub[i] - lb[i]);
@@ -596,6 +657,11 @@ nlopt_result cdirect(int n, nlopt_func f, void *f_data,
      ret = cdirect_unscaled(n, cdirect_uf, &d, d.x+n, d.x+2*n, x, minf, stop,
 			    magic_eps, which_alg);
      stop->xtol_abs = xtol_abs_save;
+     if (db.fb) {
+	  stop->batch = db.fb;
+	  stop->batch_data = db.fb_data;
+	  free(db.xs);
+     }
      for (i = 0; i < n; ++i)
 	  x[i] = lb[i]+ x[i] * (ub[i] - lb[i]);
      free(d.x);
@@ -24,7 +24,6 @@
 #include <string.h>
 
 #include "crs.h"
-#include "redblack.h"
 
 /* Controlled Random Search 2 (CRS2) with "local mutation", as defined
    by:
@@ -41,18 +40,80 @@ typedef struct {
 
      int N; /* # points in population */
      double *ps; /* population array N x (n+1) of tuples [f(x), x] */
-     double *p; /* single point array (length n+1), for temp use */
-     rb_tree t; /* red-black tree of population, sorted by f(x) */
+     int *heap; /* max-heap of the rows of ps inserted so far, by f(x),
+		   so that heap[0] is the worst point */
+     int *hpos; /* hpos[i] = position of row i in heap */
+     int nheap; /* # rows in heap */
+     int best; /* row of the best point */
+     int *perm, *ppos; /* a permutation of the rows, for sampling, and
+			  ppos[i] = position of row i in perm */
+     int B; /* # trial points generated (and evaluated) at a time */
+     double *tx, *tf; /* trial points (B x n) and their f(x) */
+     int *mutation; /* # "local mutation" steps left for each trial */
      nlopt_sobol s; /* sobol data for LDS point generation, or NULL
 		       to use pseudo-random numbers */
 } crs_data;
 
-/* sort order in red-black tree: keys [f(x), x] are sorted by f(x) */
-static int crs_compare(double *k1, double *k2)
+/* order of the rows: by f(x), with ties broken by row index */
+static int row_less(const crs_data *d, int i, int j)
 {
-     if (*k1 < *k2) return -1;
-     if (*k1 > *k2) return +1;
-     return (int)(k1 - k2); /* tie-breaker */
+     double fi = d->ps[i * (d->n+1)], fj = d->ps[j * (d->n+1)];
+     if (fi < fj) return 1;
+     if (fi > fj) return 0;
+     return i < j;
+}
+
+static void heap_swap(crs_data *d, int a, int b)
+{
+     int t = d->heap[a];
+     d->heap[a] = d->heap[b]; d->heap[b] = t;
+     d->hpos[d->heap[a]] = a; d->hpos[d->heap[b]] = b;
+}
+
+static void heap_up(crs_data *d, int k)
+{
+     while (k > 0 && row_less(d, d->heap[(k-1)/2], d->heap[k])) {
+	  heap_swap(d, (k-1)/2, k);
+	  k = (k-1)/2;
+     }
+}
+
+static void heap_down(crs_data *d, int k)
+{
+     int c;
+     while ((c = 2*k + 1) < d->nheap) {
+	  if (c + 1 < d->nheap && row_less(d, d->heap[c], d->heap[c+1])) ++c;
+	  if (!row_less(d, d->heap[k], d->heap[c])) break;
+	  heap_swap(d, k, c);
+	  k = c;
+     }
+}
+
+/* add row i (already filled in) to the heap */
+static void crs_insert(crs_data *d, int i)
+{
+     d->heap[d->nheap] = i; d->hpos[i] = d->nheap;
+     heap_up(d, d->nheap++);
+     if (d->nheap == 1 || row_less(d, i, d->best)) d->best = i;
+}
+
+/* replace the worst point by [f, x], which must be better than it: since
+   the worst and best rows differ, the new best is either the old one or
+   the new point */
+static void crs_replace_worst(crs_data *d, double f, const double *x)
+{
+     int n = d->n, w = d->heap[0];
+     d->ps[w * (n+1)] = f;
+     memcpy(d->ps + w * (n+1) + 1, x, sizeof(double) * n);
+     heap_down(d, 0);
+     if (row_less(d, w, d->best)) d->best = w;
+}
+
+static void perm_swap(crs_data *d, int a, int b)
+{
+     int t = d->perm[a];
+     d->perm[a] = d->perm[b]; d->perm[b] = t;
+     d->ppos[d->perm[a]] = a; d->ppos[d->perm[b]] = b;
 }
 
 /* set x to a random trial value, as defined by CRS:
@@ -60,55 +121,24 @@ static int crs_compare(double *k1, double *k2)
    where x_0 ... x_n are distinct points in the population
    with x_0 the current best point and the other points are random,
    and G is the centroid of x_0...x_{n-1} */
-static void random_trial(crs_data *d, double *x, rb_node *best)
+static void random_trial(crs_data *d, double *x)
 {
-     int n = d->n, n1 = n+1, i, k, i0, jn;
-     double *ps = d->ps, *xi;
+     int n = d->n, n1 = n+1, N = d->N, i, k;
+     const double *ps = d->ps, *xi;
 
      /* initialize x to x_0 = best point */
-     memcpy(x, best->k + 1, sizeof(double) * n);
-     i0 = (int)((best->k - ps) / n1);
-
-     jn = nlopt_iurand(n); /* which of remaining n points is "x_n",
-			      i.e. which to reflect through ...
-			      this is necessary since we generate
-			      the remaining points in order, so
-			      just picking the last point would not
-			      be very random */
-
-     /* use "method A" from
-	
-           Jeffrey Scott Vitter, "An efficient algorithm for
-	   sequential random sampling," ACM Trans. Math. Soft. 13 (1),
-	   58--67 (1987).  
-
-        to randomly pick n distinct points out of the remaining N-1 (not 
-        including i0!).  (The same as "method S" in Knuth vol. 2.)
-        This method requires O(N) time, which is fine in our case
-        (there are better methods if n << N). */
-     {
-	  int Nleft = d->N - 1, nleft = n;
-	  int Nfree = Nleft - nleft;
-	  i = 0; i += i == i0;
-	  while (nleft > 1) {
-	       double q = ((double) Nfree) / Nleft;
-	       double v = nlopt_urand(0., 1.);
-	       while (q > v) {
-		    ++i; i += i == i0;
-		    --Nfree; --Nleft;
-		    q = (q * Nfree) / Nleft;
-	       }
-	       xi = ps + n1 * i + 1;
-	       if (jn-- == 0) /* point to reflect through */
-		    for (k = 0; k < n; ++k) x[k] -= xi[k] * (0.5*n);
-	       else /* point to include in centroid */
-		    for (k = 0; k < n; ++k) x[k] += xi[k];
-	       ++i; i += i == i0;
-	       --Nleft; --nleft;
-	  }
-	  i += nlopt_iurand(Nleft); i += i == i0;
-	  xi = ps + n1 * i + 1;
-	  if (jn-- == 0) /* point to reflect through */
+     memcpy(x, ps + n1 * d->best + 1, sizeof(double) * n);
+
+     /* pick x_1 ... x_n, in random order, out of the other N-1 points:
+	move the best point to the end of perm and then do the first n
+	steps of a Fisher-Yates shuffle of the rest, which takes O(n) time
+	(perm need not be reset, since shuffling any permutation gives a
+	uniformly random one) */
+     perm_swap(d, d->ppos[d->best], N - 1);
+     for (i = 0; i < n; ++i) {
+	  perm_swap(d, i, i + nlopt_iurand(N - 1 - i));
+	  xi = ps + n1 * d->perm[i] + 1;
+	  if (i == n - 1) /* point to reflect through */
 	       for (k = 0; k < n; ++k) x[k] -= xi[k] * (0.5*n);
 	  else /* point to include in centroid */
 	       for (k = 0; k < n; ++k) x[k] += xi[k];
@@ -122,52 +152,99 @@ static void random_trial(crs_data *d, double *x, rb_node *best)
 
 #define NUM_MUTATION 1 /* # "local mutation" steps to try if trial fails */
 
+/* Generate B trial points, all from the current population, evaluate
+   them (with one call of the batch objective if there is one) and then
+   accept them in order, each replacing the worst point if it is better.
+   A trial that fails is followed by a "local mutation" of it around the
+   best point in the next batch, and then by a new random trial.  With
+   B = 1 this is exactly the sequential CRS2 algorithm. */
 static nlopt_result crs_trial(crs_data *d)
 {
-     rb_node *best = nlopt_rb_tree_min(&d->t);
-     rb_node *worst = nlopt_rb_tree_max(&d->t);
-     int mutation = NUM_MUTATION;
-     int i, n = d->n;
-     random_trial(d, d->p + 1, best);
-     do {
-     	  d->p[0] = d->f(n, d->p + 1, NULL, d->f_data);
-	  ++ *(d->stop->nevals_p);
-	  if (nlopt_stop_forced(d->stop)) return NLOPT_FORCED_STOP;
-	  if (d->p[0] < worst->k[0]) break;
-	  if (nlopt_stop_evals(d->stop)) return NLOPT_MAXEVAL_REACHED;
-	  if (nlopt_stop_time(d->stop)) return NLOPT_MAXTIME_REACHED;
-	  if (mutation) {
+     int i, k, n = d->n, B = d->B, nbatch;
+     double *tx = d->tx, *tf = d->tf;
+     const double *xb = d->ps + d->best * (n+1) + 1;
+
+     for (k = 0; k < B; ++k) {
+	  double *x = tx + k*n;
+	  if (d->mutation[k]) {
 	       for (i = 0; i < n; ++i) {
 		    double w = nlopt_urand(0.,1.);
-		    d->p[1+i] = best->k[1+i] * (1 + w) - w * d->p[1+i];
-		    if (d->p[1+i] > d->ub[i]) d->p[1+i] = d->ub[i];
-		    else if (d->p[1+i] < d->lb[i]) d->p[1+i] = d->lb[i];
+		    x[i] = xb[i] * (1 + w) - w * x[i];
+		    if (x[i] > d->ub[i]) x[i] = d->ub[i];
+		    else if (x[i] < d->lb[i]) x[i] = d->lb[i];
 	       }
-	       mutation--;
+	       d->mutation[k]--;
 	  }
 	  else {
-	       random_trial(d, d->p + 1, best);
-	       mutation = NUM_MUTATION;
+	       random_trial(d, x);
+	       d->mutation[k] = NUM_MUTATION;
 	  }
-     } while (1);
-     memcpy(worst->k, d->p, sizeof(double) * (n+1));
-     nlopt_rb_tree_resort(&d->t, worst);
+     }
+
+     nbatch = (int) nlopt_eval_batch(d->stop, (unsigned) B, (unsigned) n,
+				     tx, tf);
+     for (k = 0; k < B; ++k) {
+	  if (k >= nbatch)
+	       tf[k] = d->f(n, tx + k*n, NULL, d->f_data);
+	  ++ *(d->stop->nevals_p);
+	  if (nlopt_stop_forced(d->stop)) return NLOPT_FORCED_STOP;
+	  if (tf[k] < d->ps[d->heap[0] * (n+1)]) {
+	       crs_replace_worst(d, tf[k], tx + k*n);
+	       d->mutation[k] = 0; /* followed by a new random trial */
+	       if (k == B - 1) break;
+	  }
+	  if (nlopt_stop_evals(d->stop)) return NLOPT_MAXEVAL_REACHED;
+	  if (nlopt_stop_time(d->stop)) return NLOPT_MAXTIME_REACHED;
+     }
      return NLOPT_SUCCESS;
 }
 
 static void crs_destroy(crs_data *d)
 {
      nlopt_sobol_destroy(d->s);
-     nlopt_rb_tree_destroy(&d->t);
      free(d->ps);
 }
 
+/* a random point of the initial population, into k[0..n-1] */
+static void crs_random_point(crs_data *d, double *k)
+{
+     if (d->s) 
+	  nlopt_sobol_next(d->s, k, d->lb, d->ub);
+     else
+	  nlopt_urand_fill(1, (unsigned) d->n, k, d->lb, d->ub);
+}
+
+/* with a batch objective, generate the whole initial population (x plus
+   N-1 random points) and evaluate it with one call, storing the values in
+   the ps rows; returns the number of rows evaluated, or -1 on failure */
+static int crs_init_batch(crs_data *d, const double *x)
+{
+     int i, n = d->n, N = d->N;
+     unsigned nbatch;
+     double *bx, *bf;
+
+     bx = (double *) malloc(sizeof(double) * (n + 1) * N);
+     if (!bx) return -1;
+     bf = bx + N * n;
+     memcpy(bx, x, sizeof(double) * n);
+     for (i = 1; i < N; ++i) {
+	  double *k = d->ps + i*(n+1);
+	  crs_random_point(d, k + 1);
+	  memcpy(bx + i*n, k + 1, sizeof(double) * n);
+     }
+     nbatch = nlopt_eval_batch(d->stop, (unsigned) N, (unsigned) n, bx, bf);
+     for (i = 0; i < (int) nbatch; ++i)
+	  d->ps[i*(n+1)] = bf[i];
+     free(bx);
+     return (int) nbatch;
+}
+
 static nlopt_result crs_init(crs_data *d, int n, const double *x,
 			     const double *lb, const double *ub,
 			     nlopt_stopping *stop, nlopt_func f, void *f_data,
-			     int population, int lds)
+			     int population, int lds, int batch)
 {
-     int i;
+     int i, N, nbatch = 0;
 
      if (!population) {
 	  /* TODO: how should we set the default population size? 
@@ -182,15 +259,28 @@ static nlopt_result crs_init(crs_data *d, int n, const double *x,
                          d->N, n+1);
           return NLOPT_INVALID_ARGS;
      }
+     N = d->N;
 
      d->n = n;
      d->stop = stop;
      d->f = f; d->f_data = f_data;
      d->ub = ub; d->lb = lb;
-     d->ps = (double *) malloc(sizeof(double) * (n + 1) * (d->N + 1));
+     d->B = batch > 1 ? batch : 1;
+
+     /* one block for everything: the doubles, then the ints */
+     d->ps = (double *) malloc(sizeof(double) * ((n + 1) * N + (n + 1) * d->B)
+			       + sizeof(int) * (4 * N + d->B));
      if (!d->ps) return NLOPT_OUT_OF_MEMORY;
-     d->p = d->ps + d->N * (n+1);
-     nlopt_rb_tree_init(&d->t, crs_compare);
+     d->tx = d->ps + (n + 1) * N;
+     d->tf = d->tx + n * d->B;
+     d->heap = (int *) (d->tf + d->B);
+     d->hpos = d->heap + N;
+     d->perm = d->hpos + N;
+     d->ppos = d->perm + N;
+     d->mutation = d->ppos + N;
+     d->nheap = 0; d->best = 0;
+     for (i = 0; i < N; ++i) d->perm[i] = d->ppos[i] = i;
+     memset(d->mutation, 0, sizeof(int) * d->B);
 
      /* we can either use pseudorandom points, as in the original CRS
 	algorithm, or use a low-discrepancy Sobol' sequence ... I tried
@@ -198,28 +288,27 @@ static nlopt_result crs_init(crs_data *d, int n, const double *x,
 	because we are only generating a small number of random points
 	to start with */
      d->s = lds ? nlopt_sobol_create((unsigned) n) : NULL;
-     nlopt_sobol_skip(d->s, (unsigned) d->N, d->ps + 1);
+     nlopt_sobol_skip(d->s, (unsigned) N, d->ps + 1);
 
      /* generate initial points randomly, plus starting guess x */
      memcpy(d->ps + 1, x, sizeof(double) * n);
-     d->ps[0] = f(n, x, NULL, f_data);
+     if (stop->batch && (nbatch = crs_init_batch(d, x)) < 0)
+	  return NLOPT_OUT_OF_MEMORY;
+     if (nbatch < 1)
+	  d->ps[0] = f(n, x, NULL, f_data);
      ++ *(stop->nevals_p);
-     if (!nlopt_rb_tree_insert(&d->t, d->ps)) return NLOPT_OUT_OF_MEMORY;
+     crs_insert(d, 0);
      if (d->ps[0] < stop->minf_max) return NLOPT_MINF_MAX_REACHED;
      if (nlopt_stop_evals(stop)) return NLOPT_MAXEVAL_REACHED;
      if (nlopt_stop_time(stop)) return NLOPT_MAXTIME_REACHED;
-     for (i = 1; i < d->N; ++i) {
+     for (i = 1; i < N; ++i) {
 	  double *k = d->ps + i*(n+1);
-	  if (d->s) 
-	       nlopt_sobol_next(d->s, k + 1, lb, ub);
-	  else {
-	       int j;
-	       for (j = 0; j < n; ++j) 
-		    k[1 + j] = nlopt_urand(lb[j], ub[j]);
-	  }
-	  k[0] = f(n, k + 1, NULL, f_data);
+	  if (!stop->batch)
+	       crs_random_point(d, k + 1);
+	  if (i >= nbatch)
+	       k[0] = f(n, k + 1, NULL, f_data);
 	  ++ *(stop->nevals_p);
-	  if (!nlopt_rb_tree_insert(&d->t, k)) return NLOPT_OUT_OF_MEMORY;
+	  crs_insert(d, i);
 	  if (k[0] < stop->minf_max) return NLOPT_MINF_MAX_REACHED;
 	  if (nlopt_stop_evals(stop)) return NLOPT_MAXEVAL_REACHED;
 	  if (nlopt_stop_time(stop)) return NLOPT_MAXTIME_REACHED;	  
@@ -234,38 +323,41 @@ nlopt_result crs_minimize(int n, nlopt_func f, void *f_data,
 			  double *minf,
 			  nlopt_stopping *stop,
 			  int population, /* initial population (0=default) */
-			  int lds) /* random or low-discrepancy seq. (lds) */
+			  int lds, /* random or low-discrepancy seq. (lds) */
+			  int batch) /* # trials per batch (<= 1 for one) */
 {
      nlopt_result ret;
      crs_data d;
-     rb_node *best;
+     const double *best;
 
-     ret = crs_init(&d, n, x, lb, ub, stop, f, f_data, population, lds);
+     ret = crs_init(&d, n, x, lb, ub, stop, f, f_data, population, lds, batch);
      if (ret < 0) return ret;
      
-     best = nlopt_rb_tree_min(&d.t);
-     *minf = best->k[0];
-     memcpy(x, best->k + 1, sizeof(double) * n);
+     best = d.ps + d.best * (n+1);
+     *minf = best[0];
+     memcpy(x, best + 1, sizeof(double) * n);
 
      while (ret == NLOPT_SUCCESS) {
-	  if (NLOPT_SUCCESS == (ret = crs_trial(&d))) {
-	       best = nlopt_rb_tree_min(&d.t);
-	       if (best->k[0] < *minf) {
-		    if (best->k[0] < stop->minf_max)
+	  ret = crs_trial(&d);
+	  /* (a batch may improve the best point and then stop) */
+	  best = d.ps + d.best * (n+1);
+	  if (best[0] < *minf) {
+	       if (ret == NLOPT_SUCCESS) {
+		    if (best[0] < stop->minf_max)
 			 ret = NLOPT_MINF_MAX_REACHED;
-		    else if (nlopt_stop_f(stop, best->k[0], *minf))
+		    else if (nlopt_stop_f(stop, best[0], *minf))
 			 ret = NLOPT_FTOL_REACHED;
-		    else if (nlopt_stop_x(stop, best->k + 1, x))
+		    else if (nlopt_stop_x(stop, best + 1, x))
 			 ret = NLOPT_XTOL_REACHED;
-		    *minf = best->k[0];
-		    memcpy(x, best->k + 1, sizeof(double) * n);
-	       }
-	       if (ret != NLOPT_SUCCESS) {
-		    if (nlopt_stop_evals(stop)) 
-			 ret = NLOPT_MAXEVAL_REACHED;
-		    else if (nlopt_stop_time(stop)) 
-			 ret = NLOPT_MAXTIME_REACHED;
+		    if (ret != NLOPT_SUCCESS) {
+			 if (nlopt_stop_evals(stop)) 
+			      ret = NLOPT_MAXEVAL_REACHED;
+			 else if (nlopt_stop_time(stop)) 
+			      ret = NLOPT_MAXTIME_REACHED;
+		    }
 	       }
+	       *minf = best[0];
+	       memcpy(x, best + 1, sizeof(double) * n);
 	  }
      }
      crs_destroy(&d);
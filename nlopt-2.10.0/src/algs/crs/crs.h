@@ -37,7 +37,8 @@ nlopt_result crs_minimize(int n, nlopt_func f, void *f_data,
 			  double *minf,
 			  nlopt_stopping *stop,
 			  int population, /* initial population (0=default) */
-			  int random); /* random or low-discrepancy seq. */
+			  int random, /* random or low-discrepancy seq. */
+			  int batch); /* # trial points per batch */
 
 #ifdef __cplusplus
 }  /* extern "C" */
@@ -25,42 +25,90 @@
 #include "esch.h"
 
 /****************************************************************************/
-/* Cauchy random number distribution */
-static double randcauchy(const double params[7]) {
-     /* double min, double max, double mi, double t, double band */
-     double na_unif, cauchy_mit, limit_inf, limit_sup;
-     double valor;
-     double min = params[1], max = params[2], mi = params[3],
-	  t = params[4], band = params[5];
-     limit_inf = mi - (band*0.5);
-     limit_sup = mi + (band*0.5);
-     do {
-	  na_unif = nlopt_urand(0,1); /* ran2(0,1); */
-	  cauchy_mit = t*tan((na_unif-0.5)*3.14159265358979323846) + mi;
-     } while ( (cauchy_mit<limit_inf) || (cauchy_mit>limit_sup) );
+/* Cauchy random number distribution: the deviates (location 0, scale 1,
+   truncated to [-BAND/2, BAND/2]) are generated in bulk by
+   nlopt_crand_fill, and each is folded onto [0, BAND] and scaled to the
+   range [min, max] of its parameter */
+#define BAND 10.0
 
-     if (cauchy_mit < 0)
-	  cauchy_mit = -cauchy_mit;
+static void cauchy_fill(unsigned count, double *c) {
+     nlopt_crand_fill(count, c, 0, 1, -BAND*0.5, BAND*0.5);
+}
+
+static double cauchy_param(double c, double min, double max) {
+     if (c < 0)
+	  c = -c;
      else
-	  cauchy_mit = cauchy_mit + (band*0.5);
-     valor  = cauchy_mit/band;
-     valor = min+(max-min)*valor;
-     return valor;
+	  c = c + (BAND*0.5);
+     return min+(max-min)*(c/BAND);
 }
 
 /****************************************************************************/
 
-/* main Individual representation type */
-typedef struct IndividualStructure {
-     double * parameters;
+/* Selection key of an individual: its fitness, and its slot in the
+   population of parents (in rank order) followed by offsprings.  Ties are
+   broken by slot, so selection gives the order of a stable sort. */
+typedef struct {
      double fitness;
-} Individual;
+     unsigned slot;
+} SelectionKey;
+
+static int key_less(const SelectionKey *a, const SelectionKey *b) {
+     return a->fitness < b->fitness
+	  || (a->fitness == b->fitness && a->slot < b->slot);
+}
 
-static int CompareIndividuals(void *unused, const void *a_, const void *b_) {
-     const Individual *a = (const Individual *) a_;
-     const Individual *b = (const Individual *) b_;
+static int CompareKeys(void *unused, const void *a_, const void *b_) {
+     const SelectionKey *a = (const SelectionKey *) a_;
+     const SelectionKey *b = (const SelectionKey *) b_;
      (void) unused;
-     return a->fitness < b->fitness ? -1 : (a->fitness > b->fitness ? +1 : 0);
+     return key_less(a, b) ? -1 : (key_less(b, a) ? +1 : 0);
+}
+
+static void swap_keys(SelectionKey *a, SelectionKey *b) {
+     SelectionKey t = *a;
+     *a = *b;
+     *b = t;
+}
+
+/* partially order keys[0..count-1] so that keys[0..k-1] are the k
+   smallest (quickselect, with a median-of-three pivot) */
+static void select_smallest(SelectionKey *keys, unsigned count, unsigned k) {
+     unsigned lo = 0, hi = count; /* the k-th smallest is in [lo, hi) */
+     while (hi - lo > 1) {
+	  unsigned mid = lo + (hi - lo) / 2, i, store;
+	  if (key_less(keys + mid, keys + lo)) swap_keys(keys + mid, keys + lo);
+	  if (key_less(keys + hi-1, keys + lo)) swap_keys(keys + hi-1, keys + lo);
+	  if (key_less(keys + mid, keys + hi-1)) swap_keys(keys + mid, keys + hi-1);
+	  /* the median of the three is now the pivot, at hi-1 */
+	  for (store = i = lo; i < hi-1; ++i)
+	       if (key_less(keys + i, keys + hi-1))
+		    swap_keys(keys + i, keys + store++);
+	  swap_keys(keys + store, keys + hi-1);
+	  if (store == k || store + 1 == k) return;
+	  if (k < store) hi = store;
+	  else lo = store + 1;
+     }
+}
+
+/* the fitness of row id of the population xs (fs holding the first nbatch
+   values, from the batch objective), also updating the minimum */
+static nlopt_result eval_fitness(nlopt_func f, void *data_f, unsigned n,
+				 const double *xs, double *fs, unsigned id,
+				 unsigned nbatch, double *x, double *minf,
+				 nlopt_stopping *stop) {
+     if (id >= nbatch)
+	  fs[id] = f(n, xs + id*n, NULL, data_f);
+     ++ *(stop->nevals_p);
+     if (*minf > fs[id]) {
+	  *minf = fs[id];
+	  memcpy(x, xs + id*n, n * sizeof(double));
+     }
+     if (nlopt_stop_forced(stop)) return NLOPT_FORCED_STOP;
+     else if (*minf < stop->minf_max) return NLOPT_MINF_MAX_REACHED;
+     else if (nlopt_stop_evals(stop)) return NLOPT_MAXEVAL_REACHED;
+     else if (nlopt_stop_time(stop)) return NLOPT_MAXTIME_REACHED;
+     return NLOPT_SUCCESS;
 }
 
 nlopt_result chevolutionarystrategy(
@@ -77,18 +125,25 @@ nlopt_result chevolutionarystrategy(
 
      /* variables from nlopt */
      nlopt_result ret = NLOPT_SUCCESS;
-     double vetor[8];
-     unsigned  i, id, item;
-     int  parent1, parent2;
+     unsigned n = nparameters;
+     double * arena;	/* all the storage below, in one block */
+     double * xp, * fp;	/* parents: np rows of parameters, fitness */
+     double * xo, * fo;	/* offsprings: no rows of parameters, fitness */
+     double * cauchy;			/* Cauchy deviates */
+     SelectionKey * keys;		/* np+no selection keys */
+     unsigned * rank;	/* rank[i] = row of xp of the i-th best parent */
+     unsigned * newrank, * freerows;	/* selection scratch */
+     unsigned  i, id, item, nbatch, nfree;
+     unsigned  parent1, parent2;
      unsigned crosspoint;  /* crossover parameteres */
      int  contmutation, totalmutation;	/* mutation parameters */
      int  idoffmutation, paramoffmutation;	/* mutation parameters */
-     Individual * esparents;			/* Parents population */
-     Individual * esoffsprings;		/* Offsprings population */
-     Individual * estotal;/* copy containing Parents and Offsprings pops */
-     /* It is interesting to maintain the parents and offsprings
-      * populations stablished and sorted; when the final iterations
-      * is achieved, they are ranked and updated. */
+     double tsort;
+     /* The parents stay in place in xp, ranked through rank, and the
+      * offsprings are generated contiguously in xo (so a batch objective
+      * can evaluate them in place).  Selection only moves the keys; the
+      * offsprings that become parents are then copied into the rows of
+      * the parents they replace. */
 
      /*********************************
       * controlling the population size
@@ -99,15 +154,20 @@ nlopt_result chevolutionarystrategy(
          nlopt_stop_msg(stop, "populations %d, %d are too small", np, no);
          return NLOPT_INVALID_ARGS;
      }
-     esparents    = (Individual*) malloc(sizeof(Individual) * np);
-     esoffsprings = (Individual*) malloc(sizeof(Individual) * no);
-     estotal 	 = (Individual*) malloc(sizeof(Individual) * (np+no));
-     if ((!esparents)||(!esoffsprings)||(!estotal)) {
-	  free(esparents); free(esoffsprings); free(estotal);
-	  return NLOPT_OUT_OF_MEMORY;
-     }
-     for (id=0; id < np; id++) esparents[id].parameters = NULL;
-     for (id=0; id < no; id++) esoffsprings[id].parameters = NULL;
+     arena = (double*) malloc(sizeof(double) * (np+no) * (2*n + 1)
+			      + sizeof(SelectionKey) * (np+no)
+			      + sizeof(unsigned) * 3 * np);
+     if (!arena) return NLOPT_OUT_OF_MEMORY;
+     xp = arena;
+     xo = xp + np*n;
+     cauchy = xo + no*n;
+     fp = cauchy + (np+no)*n;
+     fo = fp + np;
+     keys = (SelectionKey*) (fo + no);
+     rank = (unsigned*) (keys + (np+no));
+     newrank = rank + np;
+     freerows = newrank + np;
+
      /* From here the population is initialized */
      /* we don't handle unbounded search regions;
 	    this check is unnecessary since it is performed in nlopt_optimize.
@@ -115,148 +175,105 @@ nlopt_result chevolutionarystrategy(
    	  if (nlopt_isinf(low[j]) || nlopt_isinf(up[j]))
 	    return NLOPT_INVALID_ARGS;
      */
-     /* main vector of parameters to randcauchy */
-     vetor[0] = 4; /* ignored */
-     vetor[3] = 0;
-     vetor[4] = 1;
-     vetor[5] = 10;
-     vetor[6] = 1;
-     vetor[7] = 0; /* ignored */
      /**************************************
-      * Initializing parents population
+      * Initializing parents and offsprings populations
       **************************************/
-     for (id=0; id < np; id++) {
-	  esparents[id].parameters =
-	       (double*) malloc(sizeof(double) * nparameters);
-	  if (!esparents[id].parameters) {
-	       ret = NLOPT_OUT_OF_MEMORY;
-	       goto done;
-	  }
-	  for (item=0; item<nparameters; item++) {
-	       vetor[1] = lb[item];
-	       vetor[2] = ub[item];
-	       vetor[7]=vetor[7]+1;
-	       esparents[id].parameters[item] = randcauchy(vetor);
-	  }
-     }
-     memcpy(esparents[0].parameters, x, nparameters * sizeof(double));
+     cauchy_fill((np+no) * n, cauchy);
+     for (id=0; id < np+no; id++)	/* xo follows xp */
+	  for (item=0; item<n; item++)
+	       xp[id*n+item] = cauchy_param(cauchy[id*n+item],
+					    lb[item], ub[item]);
+     memcpy(xp, x, n * sizeof(double));
+     for (id=0; id < np; id++) rank[id] = id;
 
-     /**************************************
-      * Initializing offsprings population
-      **************************************/
-     for (id=0; id < no; id++) {
-	  esoffsprings[id].parameters =
-	       (double*) malloc(sizeof(double) * nparameters);
-	  if (!esoffsprings[id].parameters) {
-	       ret = NLOPT_OUT_OF_MEMORY;
-	       goto done;
-	  }
-	  for (item=0; item<nparameters; item++) {
-	       vetor[1] = lb[item];
-	       vetor[2] = ub[item];
-	       vetor[7]=vetor[7]+1;
-	       esoffsprings[id].parameters[item] = randcauchy(vetor);
-	  }
-     }
      /**************************************
       * Parents fitness evaluation
       **************************************/
+     nbatch = nlopt_eval_batch(stop, np, n, xp, fp);
      for (id=0; id < np; id++) {
-	  esparents[id].fitness =
-	       f(nparameters, esparents[id].parameters, NULL, data_f);
-	  estotal[id].fitness = esparents[id].fitness;
-	  ++ *(stop->nevals_p);
-	  if (*minf > esparents[id].fitness) {
-	       *minf = esparents[id].fitness;
-	       memcpy(x, esparents[id].parameters,
-		      nparameters * sizeof(double));
-	  }
-	  if (nlopt_stop_forced(stop)) ret = NLOPT_FORCED_STOP;
-	  else if (*minf < stop->minf_max) ret = NLOPT_MINF_MAX_REACHED;
-	  else if (nlopt_stop_evals(stop)) ret = NLOPT_MAXEVAL_REACHED;
-	  else if (nlopt_stop_time(stop)) ret = NLOPT_MAXTIME_REACHED;
+	  ret = eval_fitness(f, data_f, n, xp, fp, id, nbatch, x, minf, stop);
 	  if (ret != NLOPT_SUCCESS) goto done;
      }
      /**************************************
       * Main Loop - Generations
       **************************************/
      while (1) {
+	  nlopt_stop_iteration(stop);
 	  /**************************************
 	   * Crossover
 	   **************************************/
 	  for (id=0; id < no; id++)
 	  {
-	       parent1  = nlopt_iurand((int) np);
-	       parent2  = nlopt_iurand((int) np);
-	       crosspoint = (unsigned) nlopt_iurand((int) nparameters);
-	       for (item=0; item < crosspoint; item++)
-		    esoffsprings[id].parameters[item]
-			 = esparents[parent1].parameters[item];
-	       for (item=crosspoint; item < nparameters; item++)
-		    esoffsprings[id].parameters[item]
-			 = esparents[parent2].parameters[item];
+	       parent1  = rank[nlopt_iurand((int) np)];
+	       parent2  = rank[nlopt_iurand((int) np)];
+	       crosspoint = (unsigned) nlopt_iurand((int) n);
+	       memcpy(xo + id*n, xp + parent1*n, crosspoint * sizeof(double));
+	       memcpy(xo + id*n + crosspoint, xp + parent2*n + crosspoint,
+		      (n - crosspoint) * sizeof(double));
 	  }
 	  /**************************************
 	   * Gaussian Mutation
 	   **************************************/
-	  totalmutation = (int) ((no * nparameters) / 10);
+	  totalmutation = (int) ((no * n) / 10);
 	  if (totalmutation < 1) totalmutation = 1;
+	  cauchy_fill((unsigned) totalmutation, cauchy);
 	  for (contmutation=0; contmutation < totalmutation;
 	       contmutation++) {
 	       idoffmutation = nlopt_iurand((int) no);
-	       paramoffmutation = nlopt_iurand((int) nparameters);
-	       vetor[1] = lb[paramoffmutation];
-	       vetor[2] = ub[paramoffmutation];
-	       vetor[7] = vetor[7]+contmutation;
-	       esoffsprings[idoffmutation].parameters[paramoffmutation]
-		    = randcauchy(vetor);
+	       paramoffmutation = nlopt_iurand((int) n);
+	       xo[idoffmutation*n + paramoffmutation]
+		    = cauchy_param(cauchy[contmutation],
+				   lb[paramoffmutation], ub[paramoffmutation]);
 	  }
 	  /**************************************
 	   * Offsprings fitness evaluation
 	   **************************************/
+	  nbatch = nlopt_eval_batch(stop, no, n, xo, fo);
 	  for (id=0; id < no; id++){
-	       /*esoffsprings[id].fitness = (double)fitness(esoffsprings[id].parameters, nparameters,fittype);*/
-	       esoffsprings[id].fitness = f(nparameters, esoffsprings[id].parameters, NULL, data_f);
-	       estotal[id+np].fitness = esoffsprings[id].fitness;
-	       ++ *(stop->nevals_p);
-	       if (*minf > esoffsprings[id].fitness) {
-		    *minf = esoffsprings[id].fitness;
-		    memcpy(x, esoffsprings[id].parameters,
-			   nparameters * sizeof(double));
-	       }
-	       if (nlopt_stop_forced(stop)) ret = NLOPT_FORCED_STOP;
-	       else if (*minf < stop->minf_max)
-		    ret = NLOPT_MINF_MAX_REACHED;
-	       else if (nlopt_stop_evals(stop)) ret = NLOPT_MAXEVAL_REACHED;
-	       else if (nlopt_stop_time(stop)) ret = NLOPT_MAXTIME_REACHED;
+	       ret = eval_fitness(f, data_f, n, xo, fo, id, nbatch,
+				  x, minf, stop);
 	       if (ret != NLOPT_SUCCESS) goto done;
 	  }
 	  /**************************************
 	   * Individual selection
 	   **************************************/
-	  /* all the individuals are copied to one vector to easily identify best solutions */
+	  /* the np best of the parents (in rank order) and offsprings */
+	  tsort = NLOPT_PHASE_START(stop);
+	  for (i=0; i < np; i++) {
+	       keys[i].fitness = fp[rank[i]];
+	       keys[i].slot = i;
+	  }
+	  for (i=0; i < no; i++) {
+	       keys[np+i].fitness = fo[i];
+	       keys[np+i].slot = np+i;
+	  }
+	  for (i=0; i < np+no; i++) /* NaN ranks last */
+	       if (nlopt_isnan(keys[i].fitness)) keys[i].fitness = HUGE_VAL;
+	  select_smallest(keys, np+no, np);
+	  nlopt_qsort_r(keys, np, sizeof(SelectionKey), NULL, CompareKeys);
+	  NLOPT_PHASE_STOP(stop, NLOPT_PHASE_SORT, tsort);
+	  /* the rows of the parents that were not selected take the
+	     selected offsprings */
+	  for (i=0; i < np; i++) newrank[i] = 0;
 	  for (i=0; i < np; i++)
-	       estotal[i] = esparents[i];
-	  for (i=0; i < no; i++)
-	       estotal[np+i] = esoffsprings[i];
-	  /* Sorting */
-	  nlopt_qsort_r(estotal, no+np, sizeof(Individual), NULL,
-			CompareIndividuals);
-	  /* copy after sorting: */
-	  for (i=0; i < no+np; i++) {
-	       if (i<np)
-		    esparents[i] = estotal[i];
-	       else
-		    esoffsprings[i-np] = estotal[i];
+	       if (keys[i].slot < np) newrank[rank[keys[i].slot]] = 1;
+	  for (nfree = i = 0; i < np; i++)
+	       if (!newrank[i]) freerows[nfree++] = i;
+	  for (nfree = i = 0; i < np; i++) {
+	       unsigned slot = keys[i].slot;
+	       if (slot < np)
+		    newrank[i] = rank[slot];
+	       else {
+		    unsigned row = freerows[nfree++];
+		    memcpy(xp + row*n, xo + (slot-np)*n, n * sizeof(double));
+		    fp[row] = fo[slot-np];
+		    newrank[i] = row;
+	       }
 	  }
+	  memcpy(rank, newrank, np * sizeof(unsigned));
      } /* generations loop */
 
 done:
-     for (id=0; id < np; id++) free(esparents[id].parameters);
-     for (id=0; id < no; id++) free(esoffsprings[id].parameters);
-
-     if (esparents) 	free(esparents);
-     if (esoffsprings) 	free(esoffsprings);
-     if (estotal) 		free(estotal);
+     free(arena);
      return ret;
 }
@@ -55,6 +55,52 @@ static int key_compare(void *keys_, const void *a_, const void *b_)
 
 static unsigned imax2(unsigned a, unsigned b) { return (a > b ? a : b); }
 
+/* Runarsson & Yao's stochastic ranking: bubble-sort sweeps (until one
+   makes no swap, at most population of them) in which each adjacent pair
+   is compared by fval with probability pf, or if both are feasible, and
+   by penalty otherwise.  The keys are moved along with the ranks, so a
+   sweep reads contiguous memory, and a uniform deviate (from us, refilled
+   in bulk) is only consumed when the two comparisons disagree: otherwise
+   the outcome is the same either way, so the distribution of the
+   ranking is unchanged.  The comparisons are random, so the sweep is
+   written without branches on them, carrying the element that bubbles
+   up in cur. */
+void isres_stochastic_rank(int population, const double *fval,
+			   const double *penalty, double pf,
+			   int *irank, isres_rank_key *keys, double *us)
+{
+     int i, j, nus = 0, ius = 0;
+
+     for (i = 0; i < population; ++i) {
+	  keys[i].f = fval[i];
+	  keys[i].p = penalty[i];
+	  keys[i].i = i;
+     }
+     for (i = 0; i < population; ++i) {
+	  int swapped = 0;
+	  isres_rank_key cur = keys[0];
+	  for (j = 0; j < population-1; ++j) {
+	       isres_rank_key next = keys[j+1];
+	       int byf = cur.f > next.f;
+	       int coin = (cur.p != 0 || next.p != 0) & (byf != (cur.p > next.p));
+	       int swap;
+	       if (ius == nus) {
+		    nus = population-1;
+		    nlopt_urand01_fill((unsigned) nus, us);
+		    ius = 0;
+	       }
+	       swap = byf ^ (coin & !(us[ius] < pf));
+	       ius += coin;
+	       swapped |= swap;
+	       keys[j] = swap ? next : cur;
+	       cur = swap ? cur : next;
+	  }
+	  keys[population-1] = cur;
+	  if (!swapped) break;
+     }
+     for (i = 0; i < population; ++i) irank[i] = keys[i].i;
+}
+
 nlopt_result isres_minimize(int n, nlopt_func f, void *f_data,
 			    int m, nlopt_constraint *fc, /* fc <= 0 */
 			    int p, nlopt_constraint *h, /* h == 0 */
@@ -75,11 +121,15 @@ nlopt_result isres_minimize(int n, nlopt_func f, void *f_data,
      double *fval; /* population array of function vals */
      double *penalty; /* population array of penalty vals */
      double *x0;
+     double *zs; /* population-by-(2n+1) normal deviates for mutation */
+     double *us; /* uniform deviates for the ranking */
+     isres_rank_key *keys = 0; /* ranking workspace */
      int *irank = 0;
-     int k, i, j, c;
+     int k, i, j, c, nbatch;
      int mp = m + p;
      double minf_penalty = HUGE_VAL, minf_gpenalty = HUGE_VAL;
      double taup, tau;
+     double tsort;
      double *results = 0; /* scratch space for mconstraint results */
      unsigned ires;
 
@@ -109,33 +159,42 @@ nlopt_result isres_minimize(int n, nlopt_func f, void *f_data,
      sigmas = (double*) malloc(sizeof(double) * (population*n*2
 						 + population
 						 + population
-						 + n));
+						 + n
+						 + population*(2*n+1)
+						 + population));
      if (!sigmas) { free(results); return NLOPT_OUT_OF_MEMORY; }
      xs = sigmas + population*n;
      fval = xs + population*n;
      penalty = fval + population;
      x0 = penalty + population;
+     zs = x0 + n;
+     us = zs + population*(2*n+1);
 
      irank = (int*) malloc(sizeof(int) * population);
-     if (!irank) { ret = NLOPT_OUT_OF_MEMORY; goto done; }
+     keys = (isres_rank_key*) malloc(sizeof(isres_rank_key) * population);
+     if (!irank || !keys) { ret = NLOPT_OUT_OF_MEMORY; goto done; }
 
      for (k = 0; k < population; ++k) {
-	  for (j = 0; j < n; ++j) {
+	  for (j = 0; j < n; ++j)
 	       sigmas[k*n+j] = (ub[j] - lb[j]) / sqrt(n);
-	       xs[k*n+j] = nlopt_urand(lb[j], ub[j]);
-	  }
      }
+     nlopt_urand_fill(population, n, xs, lb, ub);
      memcpy(xs, x, sizeof(double) * n); /* use input x for xs_0 */
 
      while (1) { /* each loop body = one generation */
 	  int all_feasible = 1;
 
-	  /* evaluate f and constraint violations for whole population */
+	  nlopt_stop_iteration(stop);
+
+	  /* evaluate f and constraint violations for whole population,
+	     with one call of the batch objective if there is one */
+	  nbatch = (int) nlopt_eval_batch(stop, (unsigned) population, n, xs, fval);
 	  for (k = 0; k < population; ++k) {
 	       int feasible = 1;
 	       double gpenalty;
 	       ++ *(stop->nevals_p);
-	       fval[k] = f(n, xs + k*n, NULL, f_data);
+	       if (k >= nbatch)
+		    fval[k] = f(n, xs + k*n, NULL, f_data);
 	       if (nlopt_stop_forced(stop)) { 
 		    ret = NLOPT_FORCED_STOP; goto done; }
 	       penalty[k] = 0;
@@ -199,60 +258,48 @@ nlopt_result isres_minimize(int n, nlopt_func f, void *f_data,
 	  }
 
 	  /* "selection" step: rank the population */
-	  for (k = 0; k < population; ++k) irank[k] = k;
-	  if (all_feasible) /* special case: rank by objective function */
+	  tsort = NLOPT_PHASE_START(stop);
+	  if (all_feasible) { /* special case: rank by objective function */
+	       for (k = 0; k < population; ++k) irank[k] = k;
 	       nlopt_qsort_r(irank, population, sizeof(int), fval,key_compare);
-	  else {
-	       /* Runarsson & Yao's stochastic ranking of the population */
-	       for (i = 0; i < population; ++i) {
-		    int swapped = 0;
-		    for (j = 0; j < population-1; ++j) {
-			 double u = nlopt_urand(0,1);
-			 if (u < PF || (penalty[irank[j]] == 0
-					&& penalty[irank[j+1]] == 0)) {
-			      if (fval[irank[j]] > fval[irank[j+1]]) {
-				   int irankj = irank[j];
-				   irank[j] = irank[j+1];
-				   irank[j+1] = irankj;
-				   swapped = 1;
-			      }
-			 }
-			 else if (penalty[irank[j]] > penalty[irank[j+1]]) {
-			      int irankj = irank[j];
-			      irank[j] = irank[j+1];
-			      irank[j+1] = irankj;
-			      swapped = 1;
-			 }
-		    }
-		    if (!swapped) break;
-	       }
 	  }
+	  else
+	       isres_stochastic_rank(population, fval, penalty, PF,
+				     irank, keys, us);
+	  NLOPT_PHASE_STOP(stop, NLOPT_PHASE_SORT, tsort);
 
 	  /* evolve the population:
 	     differential evolution for the best survivors,
-	     and standard mutation of the best survivors for the rest: */
+	     and standard mutation of the best survivors for the rest.
+	     Row k of zs holds the deviates for the k-th ranked individual:
+	     its global step, its n step sizes and a first try at each of
+	     its n coordinates (retries, when a try falls outside the
+	     bounds, are drawn one at a time) */
+	  nlopt_nrand_fill((unsigned) (population*(2*n+1)), zs, 0, 1);
 	  for (k = survivors; k < population; ++k) { /* standard mutation */
-	       double taup_rand = taup * nlopt_nrand(0,1);
+	       const double *z = zs + k*(2*n+1);
+	       double taup_rand = taup * z[0];
 	       int rk = irank[k], ri;
 	       i = k % survivors;
 	       ri = irank[i];
 	       for (j = 0; j < n; ++j) {
 		    double sigmamax = (ub[j] - lb[j]) / sqrt(n);
 		    sigmas[rk*n+j] = sigmas[ri*n+j] 
-			 * exp(taup_rand + tau*nlopt_nrand(0,1));
+			 * exp(taup_rand + tau*z[1+j]);
 		    if (sigmas[rk*n+j] > sigmamax)
 			 sigmas[rk*n+j] = sigmamax;
-		    do {
+		    xs[rk*n+j] = xs[ri*n+j] + sigmas[rk*n+j] * z[1+n+j];
+		    while (xs[rk*n+j] < lb[j] || xs[rk*n+j] > ub[j])
 			 xs[rk*n+j] = xs[ri*n+j] 
 			      + sigmas[rk*n+j] * nlopt_nrand(0,1);
-		    } while (xs[rk*n+j] < lb[j] || xs[rk*n+j] > ub[j]);
 		    sigmas[rk*n+j] = sigmas[ri*n+j] + ALPHA*(sigmas[rk*n+j]
 							   - sigmas[ri*n+j]);
 	       }
 	  }
 	  memcpy(x0, xs, n * sizeof(double));
 	  for (k = 0; k < survivors; ++k) { /* differential variation */
-	       double taup_rand = taup * nlopt_nrand(0,1);
+	       const double *z = zs + k*(2*n+1);
+	       double taup_rand = taup * z[0];
 	       int rk = irank[k];
 	       for (j = 0; j < n; ++j) {
 		    double xi = xs[rk*n+j];
@@ -265,14 +312,13 @@ nlopt_result isres_minimize(int n, nlopt_func f, void *f_data,
 			    outside the bounds */
 			 double sigmamax = (ub[j] - lb[j]) / sqrt(n);
 			 double sigi = sigmas[rk*n+j];
-			 sigmas[rk*n+j] *= exp(taup_rand 
-					       + tau*nlopt_nrand(0,1));
+			 sigmas[rk*n+j] *= exp(taup_rand + tau*z[1+j]);
 			 if (sigmas[rk*n+j] > sigmamax)
 			      sigmas[rk*n+j] = sigmamax;
-			 do {
+			 xs[rk*n+j] = xi + sigmas[rk*n+j] * z[1+n+j];
+			 while (xs[rk*n+j] < lb[j] || xs[rk*n+j] > ub[j])
 			      xs[rk*n+j] = xi 
 				   + sigmas[rk*n+j] * nlopt_nrand(0,1);
-			 } while (xs[rk*n+j] < lb[j] || xs[rk*n+j] > ub[j]);
 			 sigmas[rk*n+j] = sigi 
 			      + ALPHA * (sigmas[rk*n+j] - sigi);
 		    }
@@ -282,6 +328,7 @@ nlopt_result isres_minimize(int n, nlopt_func f, void *f_data,
 
 done:
      if (irank) free(irank);
+     if (keys) free(keys);
      if (sigmas) free(sigmas);
      if (results) free(results);
      return ret;
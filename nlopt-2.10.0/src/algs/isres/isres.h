@@ -40,6 +40,18 @@ nlopt_result isres_minimize(int n, nlopt_func f, void *f_data,
 			    nlopt_stopping *stop,
 			    int population); /* init. population */
 
+/* stochastic ranking of population individuals with objective values
+   fval and constraint penalties penalty into irank, using the workspaces
+   keys (length population) and us (length population-1) */
+typedef struct {
+     double f, p;
+     int i;
+} isres_rank_key;
+
+void isres_stochastic_rank(int population, const double *fval,
+			   const double *penalty, double pf,
+			   int *irank, isres_rank_key *keys, double *us);
+
 #ifdef __cplusplus
 }  /* extern "C" */
 #endif /* __cplusplus */
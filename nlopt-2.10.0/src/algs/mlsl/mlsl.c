@@ -255,6 +255,14 @@ static double fcount(unsigned n, const double *x, double *grad, void *p_)
      return p->f(n, x, grad, p->f_data);
 }
 
+/* a random/quasi-random sample point, into x[0..n-1] */
+static void random_pt(mlsl_data *d, double *x)
+{
+     if (d->s) nlopt_sobol_next(d->s, x, d->lb, d->ub);
+     else /* use random points instead of LDS */
+	  nlopt_urand_fill(1, (unsigned) d->n, x, d->lb, d->ub);
+}
+
 static void get_minf(mlsl_data *d, double *minf, double *x)
 {
      rb_node *node = nlopt_rb_tree_min(&d->pts);
@@ -287,6 +295,9 @@ nlopt_result mlsl_minimize(int n, nlopt_func f, void *f_data,
      mlsl_data d;
      int i;
      pt *p;
+     pt **bpts = NULL; /* samples of the current iteration, with a batch */
+     double *bx = NULL, *bf = NULL; /* objective: their x and f */
+     unsigned nbatch;
 
      if (!Nsamples)
 	  d.N = 4; /* FIXME: what is good number of samples per iteration? */
@@ -325,6 +336,13 @@ nlopt_result mlsl_minimize(int n, nlopt_func f, void *f_data,
      d.dbound = 1e-6; /* min distance/R to ub/lb boundaries (good value?) */
      
 
+     if (stop->batch) {
+	  bpts = (pt **) malloc(sizeof(pt *) * d.N);
+	  bx = (double *) malloc(sizeof(double) * (n+1) * d.N);
+	  if (!bpts || !bx) { ret = NLOPT_OUT_OF_MEMORY; goto done; }
+	  bf = bx + n * d.N;
+     }
+
      p = alloc_pt(n);
      if (!p) { ret = NLOPT_OUT_OF_MEMORY; goto done; }
 
@@ -346,18 +364,34 @@ nlopt_result mlsl_minimize(int n, nlopt_func f, void *f_data,
 	  rb_node *node;
 	  double R;
 
+	  nlopt_stop_iteration(stop);
 	  get_minf(&d, minf, x);
 
-	  /* sampling phase: add random/quasi-random points */
+	  /* sampling phase: add random/quasi-random points, generating
+	     and evaluating them all at once with a batch objective */
+	  nbatch = 0;
+	  if (bpts) {
+	       for (i = 0; i < d.N; ++i) {
+		    bpts[i] = alloc_pt(n);
+		    if (!bpts[i]) {
+			 while (i > 0) free(bpts[--i]);
+			 ret = NLOPT_OUT_OF_MEMORY; goto done;
+		    }
+		    random_pt(&d, bpts[i]->x);
+		    memcpy(bx + i*n, bpts[i]->x, n * sizeof(double));
+	       }
+	       nbatch = nlopt_eval_batch(stop, (unsigned) d.N, (unsigned) n,
+					 bx, bf);
+	  }
 	  for (i = 0; i < d.N && ret == NLOPT_SUCCESS; ++i) {
-	       p = alloc_pt(n);
-	       if (!p) { ret = NLOPT_OUT_OF_MEMORY; goto done; }
-	       if (d.s) nlopt_sobol_next(d.s, p->x, lb, ub);
-	       else { /* use random points instead of LDS */
-		    int j;
-		    for (j = 0; j < n; ++j) p->x[j] = nlopt_urand(lb[j],ub[j]);
+	       if (bpts)
+		    p = bpts[i];
+	       else {
+		    p = alloc_pt(n);
+		    if (!p) { ret = NLOPT_OUT_OF_MEMORY; goto done; }
+		    random_pt(&d, p->x);
 	       }
-	       p->f = f(n, p->x, NULL, f_data);
+	       p->f = i < (int) nbatch ? bf[i] : f(n, p->x, NULL, f_data);
 	       ++ *(stop->nevals_p);
 	       if (!nlopt_rb_tree_insert(&d.pts, (rb_key) p)) { 
 		    free(p); ret = NLOPT_OUT_OF_MEMORY;
@@ -367,11 +401,15 @@ nlopt_result mlsl_minimize(int n, nlopt_func f, void *f_data,
 	       else if (nlopt_stop_time(stop)) ret = NLOPT_MAXTIME_REACHED;
 	       else if (p->f < stop->minf_max) ret = NLOPT_MINF_MAX_REACHED;
 	       else {
+		    double tdist = NLOPT_PHASE_START(stop);
 		    find_closest_pt(n, &d.pts, p);
 		    find_closest_lm(n, &d.lms, p);
 		    pts_update_newpt(n, &d.pts, p);
+		    NLOPT_PHASE_STOP(stop, NLOPT_PHASE_DISTANCE, tdist);
 	       }
 	  }
+	  if (bpts) /* samples left over after a stop */
+	       for (; i < d.N; ++i) free(bpts[i]);
 
 	  /* distance threshold parameter R in MLSL */
 	  R = d.R_prefactor 
@@ -417,8 +455,11 @@ nlopt_result mlsl_minimize(int n, nlopt_func f, void *f_data,
 			 ret = NLOPT_MAXEVAL_REACHED;
 		    else if (nlopt_stop_time(stop))
 			 ret = NLOPT_MAXTIME_REACHED;
-		    else
+		    else {
+			 double tdist = NLOPT_PHASE_START(stop);
 			 pts_update_newlm(n, &d.pts, lm);
+			 NLOPT_PHASE_STOP(stop, NLOPT_PHASE_DISTANCE, tdist);
+		    }
 	       }
 
 	       /* TODO: additional stopping criteria based
@@ -428,9 +469,12 @@ nlopt_result mlsl_minimize(int n, nlopt_func f, void *f_data,
 	  }
      }
 
-     get_minf(&d, minf, x);
-
  done:
+     /* also after a forced stop or failure in a local search, so that
+	the caller gets the best point found so far */
+     get_minf(&d, minf, x);
+     free(bpts);
+     free(bx);
      nlopt_sobol_destroy(d.s);
      nlopt_rb_tree_destroy_with_keys(&d.lms);
      nlopt_rb_tree_destroy_with_keys(&d.pts);
@@ -149,28 +149,44 @@ nlopt_result mma_minimize(unsigned n, nlopt_func f, void *f_data,
 			  double *minf,
 			  nlopt_stopping *stop,
 			  nlopt_opt dual_opt, int inner_maxeval, unsigned verbose, double rho_init,
-			  const double *sigma_init)
+			  const double *sigma_init, int warm_start,
+			  void **workp, size_t *work_size, int *dual_nevals_p,
+			  unsigned nthreads)
 {
      nlopt_result ret = NLOPT_SUCCESS;
      double *xcur, rho, *sigma, *dfdx, *dfdx_cur, *xprev, *xprevprev, fcur;
      double *dfcdx, *dfcdx_cur;
+     unsigned *offset;
      double *fcval, *fcval_cur, *rhoc, *gcval, *y, *dual_lb, *dual_ub;
      unsigned i, ifc, j, k = 0;
      dual_data dd;
      int feasible;
      double infeasibility;
      unsigned mfc;
+     size_t len_work;
 
 	 verbose = MAX(mma_verbose, verbose);
 
      m = nlopt_count_constraints(mfc = m, fc);
-     if (nlopt_get_dimension(dual_opt) != m) {
+     if (dual_opt ? nlopt_get_dimension(dual_opt) != m : m != 0) {
          nlopt_stop_msg(stop, "dual optimizer has wrong dimension %d != %d",
-                        nlopt_get_dimension(dual_opt), m);
+                        dual_opt ? nlopt_get_dimension(dual_opt) : 0, m);
          return NLOPT_INVALID_ARGS;
      }
-     sigma = (double *) malloc(sizeof(double) * (6*n + 2*m*n + m*7));
-     if (!sigma) return NLOPT_OUT_OF_MEMORY;
+     len_work = sizeof(double) * (6*n + 2*m*n + m*7) + sizeof(unsigned) * mfc;
+     /* the workspace is kept between runs, so with warm_start the
+	dual variables y start from where the previous run left them */
+     if (*work_size != len_work)
+	  warm_start = 0;
+     if (*work_size < len_work) {
+	  sigma = (double *) realloc(*workp, len_work);
+	  if (!sigma) return NLOPT_OUT_OF_MEMORY;
+	  memset(sigma, 0, len_work);
+	  *workp = sigma;
+	  *work_size = len_work;
+     }
+     else
+	  sigma = (double *) *workp;
      dfdx = sigma + n;
      dfdx_cur = dfdx + n;
      xcur = dfdx_cur + n;
@@ -185,6 +201,11 @@ nlopt_result mma_minimize(unsigned n, nlopt_func f, void *f_data,
      y = dual_ub + m;
      dfcdx = y + m;
      dfcdx_cur = dfcdx + m*n;
+     /* where each constraint block's values start in fcval, for
+	nlopt_eval_objective_constraints */
+     offset = (unsigned *) (dfcdx_cur + m*n);
+     for (ifc = i = 0; ifc < mfc; i += fc[ifc++].m)
+	  offset[ifc] = i;
 
      dd.n = n;
      dd.x = x;
@@ -209,22 +230,18 @@ nlopt_result mma_minimize(unsigned n, nlopt_func f, void *f_data,
      rho = rho_init;
      for (i = 0; i < m; ++i) {
 	  rhoc[i] = rho_init;
-	  dual_lb[i] = y[i] = 0.0;
+	  dual_lb[i] = 0.0;
+	  if (!warm_start) y[i] = 0.0;
 	  dual_ub[i] = HUGE_VAL;
      }
 
-     dd.fval = fcur = *minf = f(n, x, dfdx, f_data);
-     ++ *(stop->nevals_p);
+     dd.fval = fcur = *minf =
+	  nlopt_eval_objective_constraints(stop, nthreads, offset, f, f_data,
+					   mfc, fc, n, x, dfdx, fcval, dfcdx);
      memcpy(xcur, x, sizeof(double) * n);
      if (nlopt_stop_forced(stop)) { ret = NLOPT_FORCED_STOP; goto done; }
 
      feasible = 1; infeasibility = 0;
-     for (i = ifc = 0; ifc < mfc; ++ifc) {
-	  nlopt_eval_constraint(fcval + i, dfcdx + i*n,
-				fc + ifc, n, x);
-	  i += fc[ifc].m;
-	  if (nlopt_stop_forced(stop)) { ret = NLOPT_FORCED_STOP; goto done; }
-     }
      for (i = 0; i < m; ++i) {
 	  feasible = feasible && (fcval[i] <= 0 || nlopt_isnan(fcval[i]));
 	  if (fcval[i] > infeasibility) infeasibility = fcval[i];
@@ -243,12 +260,14 @@ nlopt_result mma_minimize(unsigned n, nlopt_func f, void *f_data,
      if (!feasible)
 	  for (i = 0; i < m; ++i) dual_ub[i] = 1e40;
 
-     nlopt_set_min_objective(dual_opt, dual_func, &dd);
-     nlopt_set_lower_bounds(dual_opt, dual_lb);
-     nlopt_set_upper_bounds(dual_opt, dual_ub);
-     nlopt_set_stopval(dual_opt, -HUGE_VAL);
-     nlopt_remove_inequality_constraints(dual_opt);
-     nlopt_remove_equality_constraints(dual_opt);
+     if (dual_opt) { /* NULL when there are no constraints */
+	  nlopt_set_min_objective(dual_opt, dual_func, &dd);
+	  nlopt_set_lower_bounds(dual_opt, dual_lb);
+	  nlopt_set_upper_bounds(dual_opt, dual_ub);
+	  nlopt_set_stopval(dual_opt, -HUGE_VAL);
+	  nlopt_remove_inequality_constraints(dual_opt);
+	  nlopt_remove_equality_constraints(dual_opt);
+     }
 
      while (1) { /* outer iterations */
 	  int inner_nevals = 0;
@@ -259,6 +278,7 @@ nlopt_result mma_minimize(unsigned n, nlopt_func f, void *f_data,
 	  else if (feasible && *minf < stop->minf_max)
 	       ret = NLOPT_MINF_MAX_REACHED;
 	  if (ret != NLOPT_SUCCESS) goto done;
+	  nlopt_stop_iteration(stop);
 	  if (++k > 1) memcpy(xprevprev, xprev, sizeof(double) * n);
 	  memcpy(xprev, xcur, sizeof(double) * n);
 
@@ -268,15 +288,19 @@ nlopt_result mma_minimize(unsigned n, nlopt_func f, void *f_data,
 	       unsigned save_verbose;
 	       int new_infeasible_constraint;
 	       nlopt_result reti;
+	       double tdual;
 
 	       /* solve dual problem */
 	       dd.rho = rho; dd.count = 0;
 	       save_verbose = mma_verbose;
 	       mma_verbose = 0; /* no recursive verbosity */
-	       reti = nlopt_optimize_limited(dual_opt, y, &min_dual,
-					     0,
-					     stop->maxtime - (nlopt_seconds()
-							      - stop->start));
+	       tdual = NLOPT_PHASE_START(stop);
+	       reti = !dual_opt ? NLOPT_SUCCESS :
+		    nlopt_optimize_limited(dual_opt, y, &min_dual,
+					   0,
+					   stop->maxtime - (nlopt_seconds()
+							    - stop->start));
+	       NLOPT_PHASE_STOP(stop, NLOPT_PHASE_DUAL, tdual);
 	       mma_verbose = save_verbose;
 	       if (reti < 0 || reti == NLOPT_MAXTIME_REACHED) {
 		    ret = reti;
@@ -284,6 +308,7 @@ nlopt_result mma_minimize(unsigned n, nlopt_func f, void *f_data,
 	       }
 
 	       dual_func(m, y, NULL, &dd); /* evaluate final xcur etc. */
+	       if (dual_nevals_p) *dual_nevals_p += dd.count;
 	       if (verbose) {
 		    printf("MMA dual converged in %d iterations to g=%g:\n",
 			   dd.count, dd.gval);
@@ -292,21 +317,16 @@ nlopt_result mma_minimize(unsigned n, nlopt_func f, void *f_data,
 				i, y[i], i, dd.gcval[i]);
 	       }
 
-	       fcur = f(n, xcur, dfdx_cur, f_data);
-	       ++ *(stop->nevals_p);
+	       fcur = nlopt_eval_objective_constraints(stop, nthreads, offset,
+						       f, f_data, mfc, fc,
+						       n, xcur, dfdx_cur,
+						       fcval_cur, dfcdx_cur);
 		   ++inner_nevals;
 	       if (nlopt_stop_forced(stop)) {
 		    ret = NLOPT_FORCED_STOP; goto done; }
 	       feasible_cur = 1; infeasibility_cur = 0;
 	       new_infeasible_constraint = 0;
 	       inner_done = dd.gval >= fcur;
-	       for (i = ifc = 0; ifc < mfc; ++ifc) {
-		    nlopt_eval_constraint(fcval_cur + i, dfcdx_cur + i*n,
-					  fc + ifc, n, xcur);
-		    i += fc[ifc].m;
-		    if (nlopt_stop_forced(stop)) {
-			 ret = NLOPT_FORCED_STOP; goto done; }
-	       }
 	       for (i = ifc = 0; ifc < mfc; ++ifc) {
 		    unsigned i0 = i, inext = i + fc[ifc].m;
 		    for (; i < inext; ++i)
@@ -406,6 +426,5 @@ nlopt_result mma_minimize(unsigned n, nlopt_func f, void *f_data,
      }
 
  done:
-     free(sigma);
      return ret;
 }
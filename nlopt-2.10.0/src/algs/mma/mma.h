@@ -41,7 +41,9 @@ nlopt_result mma_minimize(unsigned n, nlopt_func f, void *f_data,
 			  double *minf,
 			  nlopt_stopping *stop,
 			  nlopt_opt dual_opt, int inner_maxeval, unsigned verbose, double rho_init,
-                 const double *sigma_init);
+			  const double *sigma_init, int warm_start,
+			  void **work, size_t *work_size, int *dual_nevals_p,
+			  unsigned nthreads);
 
 nlopt_result ccsa_quadratic_minimize(
      unsigned n, nlopt_func f, void *f_data,
@@ -54,7 +56,9 @@ nlopt_result ccsa_quadratic_minimize(
      double *minf,
      nlopt_stopping *stop,
      nlopt_opt dual_opt, int inner_maxeval, unsigned verbose, double rho_init,
-     const double *sigma_init);
+     const double *sigma_init, int warm_start,
+     void **work, size_t *work_size, int *dual_nevals_p,
+     unsigned nthreads);
 
 #ifdef __cplusplus
 }  /* extern "C" */
@@ -96,11 +96,23 @@ static double rho_constraint(unsigned n, const double *x, double *grad, void *da
      return val;
 }
 
+/* the MMA subproblems of the bound-constrained variant get whatever is left
+   of the caller's maxtime, since they can take much longer than their
+   evaluations of the (cheap) quadratic model suggest */
+static void set_remaining_time(nlopt_opt opt, const nlopt_stopping *stop)
+{
+     if (stop->maxtime > 0) {
+	  double left = stop->maxtime - (nlopt_seconds() - stop->start);
+	  nlopt_set_maxtime(opt, left > 1e-6 ? left : 1e-6);
+     }
+}
+
 static nlopt_result trsapp_(int *n, int *npt, double *xopt,
 	double *xpt, double *gq, double *hq, double *pq,
 	double *delta, double *step, double *d__, double *g,
 	double *hd, double *hs, double *crvmin,
-		    const double *xbase, const double *lb, const double *ub)
+		    const double *xbase, const double *lb, const double *ub,
+		    const nlopt_stopping *stop)
 {
     /* System generated locals */
     int xpt_dim1, xpt_offset, i__1, i__2;
@@ -189,6 +201,7 @@ static nlopt_result trsapp_(int *n, int *npt, double *xopt,
 	 nlopt_set_upper_bounds(opt, sub);
 	 nlopt_set_xtol_abs(opt, xtol);
 	 nlopt_set_maxeval(opt, 1000);
+	 set_remaining_time(opt, stop);
 	 ret = nlopt_optimize(opt, &step[1], &minf);
 	 nlopt_destroy(opt);
 	 if (rho_constraint(*n, &step[1], 0, delta) > -1e-6*(*delta)*(*delta))
@@ -1061,7 +1074,8 @@ static nlopt_result biglag_(int *n, int *npt, double *xopt,
 		    int *ndim, int *knew, double *delta, double *d__,
 		    double *alpha, double *hcol, double *gc, double *gd,
 		    double *s, double *w,
-		    const double *xbase, const double *lb, const double *ub)
+		    const double *xbase, const double *lb, const double *ub,
+		    const nlopt_stopping *stop)
 {
     /* System generated locals */
     int xpt_dim1, xpt_offset, bmat_dim1, bmat_offset, zmat_dim1,
@@ -1256,6 +1270,7 @@ static nlopt_result biglag_(int *n, int *npt, double *xopt,
 	 nlopt_set_upper_bounds(opt, dub);
 	 nlopt_set_xtol_abs(opt, xtol);
 	 nlopt_set_maxeval(opt, 1000);
+	 set_remaining_time(opt, stop);
 	 ret = nlopt_optimize(opt, &d__[1], &minf);
 	 nlopt_destroy(opt);
 	 return ret;
@@ -1857,7 +1872,7 @@ L100:
     knew = 0;
     rc2 = trsapp_(n, npt, &xopt[1], &xpt[xpt_offset], &gq[1], &hq[1], &pq[1], &
 	    delta, &d__[1], &w[1], &w[np], &w[np + *n], &w[np + (*n << 1)], &
-	    crvmin, &xbase[1], lb, ub);
+	    crvmin, &xbase[1], lb, ub, stop);
     if (rc2 < 0) { rc = rc2; goto L530; }
     dsq = zero;
     i__1 = *n;
@@ -2011,7 +2026,7 @@ L120:
 	 biglag_(n, npt, &xopt[1], &xpt[xpt_offset], &bmat[bmat_offset], &zmat[
 		zmat_offset], &idz, ndim, &knew, &dstep, &d__[1], &alpha, &
 		vlag[1], &vlag[*npt + 1], &w[1], &w[np], &w[np + *n],
-		&xbase[1], lb, ub);
+		&xbase[1], lb, ub, stop);
        if (rc2 < 0) { rc = rc2; goto L530; }
     }
 
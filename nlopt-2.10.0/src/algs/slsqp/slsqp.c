@@ -43,6 +43,25 @@
 
 /********************************* BLAS1 routines *************************/
 
+/* If NLOPT_SLSQP_BLAS is defined, the level-1 kernels below forward to
+   the (Fortran-convention) routines of a system BLAS for positive strides;
+   note that an optimized BLAS sums in a different order, so results can
+   differ in the last bits from the built-in kernels.  Otherwise, the
+   unit-stride case, which is by far the most common one in the QP
+   subproblem, gets a separate loop without stride arithmetic that the
+   compiler can vectorize. */
+#ifdef NLOPT_SLSQP_BLAS
+extern double ddot_(const int *n, const double *dx, const int *incx,
+		    const double *dy, const int *incy);
+extern void daxpy_(const int *n, const double *da, const double *dx,
+		   const int *incx, double *dy, const int *incy);
+extern double dnrm2_(const int *n, const double *dx, const int *incx);
+extern void dscal_(const int *n, const double *da, double *dx,
+		   const int *incx);
+extern void dcopy_(const int *n, const double *dx, const int *incx,
+		   double *dy, const int *incy);
+#endif
+
 /*     COPIES A VECTOR, X, TO A VECTOR, Y, with the given increments */
 static void dcopy___(int *n_, const double *dx, int incx, 
 		     double *dy, int incy)
@@ -52,10 +71,23 @@ static void dcopy___(int *n_, const double *dx, int incx,
      if (n <= 0) return;
      if (incx == 1 && incy == 1)
 	  memcpy(dy, dx, sizeof(double) * ((unsigned) n));
-     else if (incx == 0 && incy == 1) {
+     else if (incx == 0) {
+	  /* the Fortran idiom for filling a vector (or a strided row) */
 	  double x = dx[0];
-	  for (i = 0; i < n; ++i) dy[i] = x;
+	  if (incy == 1)
+	       for (i = 0; i < n; ++i) dy[i] = x;
+	  else
+	       for (i = 0; i < n; ++i, dy += incy) *dy = x;
      }
+#ifdef NLOPT_SLSQP_BLAS
+     else if (incx > 0 && incy > 0)
+	  dcopy_(n_, dx, &incx, dy, &incy);
+#endif
+     /* a row of a column-major matrix to a vector, or back */
+     else if (incy == 1)
+	  for (i = 0; i < n; ++i, dx += incx) dy[i] = *dx;
+     else if (incx == 1)
+	  for (i = 0; i < n; ++i, dy += incy) *dy = dx[i];
      else {
 	  for (i = 0; i < n; ++i) dy[i*incy] = dx[i*incx];
      }
@@ -69,6 +101,13 @@ static void daxpy_sl__(int *n_, const double *da_, const double *dx,
      double da = *da_;
 
      if (n <= 0 || da == 0) return;
+#ifdef NLOPT_SLSQP_BLAS
+     if (incx > 0 && incy > 0) { daxpy_(n_, da_, dx, &incx, dy, &incy); return; }
+#endif
+     if (incx == 1 && incy == 1) {
+	  for (i = 0; i < n; ++i) dy[i] += da * dx[i];
+	  return;
+     }
      for (i = 0; i < n; ++i) dy[i*incy] += da * dx[i*incx];
 }
 
@@ -78,6 +117,16 @@ static double ddot_sl__(int *n_, double *dx, int incx, double *dy, int incy)
      int n = *n_, i;
      double sum = 0;
      if (n <= 0) return 0;
+#ifdef NLOPT_SLSQP_BLAS
+     if (incx > 0 && incy > 0) return ddot_(n_, dx, &incx, dy, &incy);
+#endif
+     if (incx == 1 && incy == 1) {
+	  /* keep the sequential summation order: the LDP/NNLS steps are
+	     sensitive enough to rounding that reassociating this sum
+	     changes which active set is found on some problems */
+	  for (i = 0; i < n; ++i) sum += dx[i] * dy[i];
+	  return sum;
+     }
      for (i = 0; i < n; ++i) sum += dx[i*incx] * dy[i*incy];
      return (double) sum;
 }
@@ -88,6 +137,26 @@ static double dnrm2___(int *n_, double *dx, int incx)
      int i, n = *n_;
      double xmax = 0, scale;
      double sum = 0;
+#ifdef NLOPT_SLSQP_BLAS
+     if (incx > 0) return n > 0 ? dnrm2_(n_, dx, &incx) : 0;
+#endif
+     if (incx == 1) {
+	  double m0 = 0, m1 = 0;
+	  for (i = 0; i + 2 <= n; i += 2) {
+	       double a0 = fabs(dx[i]), a1 = fabs(dx[i+1]);
+	       m0 = m0 < a0 ? a0 : m0;
+	       m1 = m1 < a1 ? a1 : m1;
+	  }
+	  if (i < n && m0 < fabs(dx[i])) m0 = fabs(dx[i]);
+	  xmax = m0 < m1 ? m1 : m0;
+	  if (xmax == 0) return 0;
+	  scale = 1.0 / xmax;
+	  for (i = 0; i < n; ++i) {
+	       double xs = scale * dx[i];
+	       sum += xs * xs;
+	  }
+	  return xmax * sqrt(sum);
+     }
      for (i = 0; i < n; ++i) {
           double xabs = fabs(dx[incx*i]);
           if (xmax < xabs) xmax = xabs;
@@ -150,6 +219,13 @@ static void dscal_sl__(int *n_, const double *da, double *dx, int incx)
 {
      int i, n = *n_;
      double alpha = *da;
+#ifdef NLOPT_SLSQP_BLAS
+     if (incx > 0) { if (n > 0) dscal_(n_, da, dx, &incx); return; }
+#endif
+     if (incx == 1) {
+	  for (i = 0; i < n; ++i) dx[i] *= alpha;
+	  return;
+     }
      for (i = 0; i < n; ++i) dx[i*incx] *= alpha;
 }
 
@@ -1776,6 +1852,7 @@ typedef struct {
     int iexact;
     int incons, ireset, itermx;
     double *x0;
+    const nlopt_stopping *stop; /* for the phase profiler */
 } slsqpb_state;
 
 #define SS(var) state->var = var
@@ -1910,6 +1987,7 @@ L130:
 	goto L330;
     }
 /*   SEARCH DIRECTION AS SOLUTION OF QP - SUBPROBLEM */
+    nlopt_stop_iteration(state->stop);
     dcopy___(n, &xl[1], 1, &u[1], 1);
     dcopy___(n, &xu[1], 1, &v[1], 1);
     d__1 = -one;
@@ -1917,8 +1995,12 @@ L130:
     d__1 = -one;
     daxpy_sl__(n, &d__1, &x[1], 1, &v[1], 1);
     h4 = one;
-    lsq_(m, meq, n, &n3, la, &l[1], &g[1], &a[a_offset], &c__[1], &u[1], &v[1]
-	    , &s[1], &r__[1], &w[1], &iw[1], mode);
+    {
+	double tqp = NLOPT_PHASE_START(state->stop);
+	lsq_(m, meq, n, &n3, la, &l[1], &g[1], &a[a_offset], &c__[1], &u[1], &v[1]
+		, &s[1], &r__[1], &w[1], &iw[1], mode);
+	NLOPT_PHASE_STOP(state->stop, NLOPT_PHASE_QP, tqp);
+    }
 
 /*   AUGMENTED PROBLEM FOR INCONSISTENT LINEARIZATION */
     if (*mode == 6) {
@@ -1948,8 +2030,12 @@ L130:
 	v[n1] = one;
 	incons = 0;
 L150:
-	lsq_(m, meq, &n1, &n3, la, &l[1], &g[1], &a[a_offset], &c__[1], &u[1],
-		 &v[1], &s[1], &r__[1], &w[1], &iw[1], mode);
+	{
+	    double tqp = NLOPT_PHASE_START(state->stop);
+	    lsq_(m, meq, &n1, &n3, la, &l[1], &g[1], &a[a_offset], &c__[1], &u[1],
+		     &v[1], &s[1], &r__[1], &w[1], &iw[1], mode);
+	    NLOPT_PHASE_STOP(state->stop, NLOPT_PHASE_QP, tqp);
+	}
 	h4 = one - s[n1];
 	if (*mode == 4) {
 	    l[n3] = ten * l[n3];
@@ -2440,9 +2526,10 @@ nlopt_result nlopt_slsqp(unsigned n, nlopt_func f, void *f_data,
 			 unsigned p, nlopt_constraint *h,
 			 const double *lb, const double *ub,
 			 double *x, double *minf,
-			 nlopt_stopping *stop)
+			 nlopt_stopping *stop,
+			 void **workp, size_t *work_size)
 {
-     slsqpb_state state = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,NULL};
+     slsqpb_state state = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,NULL,NULL};
      unsigned mtot = nlopt_count_constraints(m, fc);
      unsigned ptot = nlopt_count_constraints(p, h);
      double *work, *cgrad, *c, *grad, *w, 
@@ -2458,17 +2545,28 @@ nlopt_result nlopt_slsqp(unsigned n, nlopt_func f, void *f_data,
      double infeasibility = HUGE_VAL, infeasibility_cur = HUGE_VAL;
      unsigned max_cdim;
      int want_grad = 1;
+     size_t len_work;
      
+     state.stop = stop;
      max_cdim = MAX2(nlopt_max_constraint_dim(m, fc),
 		    nlopt_max_constraint_dim(p, h));
      length_work(&len_w, &len_jw, mpi, pi, ni);
 
 #define U(n) ((unsigned) (n))
-     work = (double *) malloc(sizeof(double) * (U(mpi1) * (n + 1) 
-						+ U(mpi) 
-						+ n+1 + n + n + max_cdim*n
-						+ U(len_w))
-			      + sizeof(int) * U(len_jw));
+     len_work = sizeof(double) * (U(mpi1) * (n + 1) 
+				  + U(mpi) 
+				  + n+1 + n + n + max_cdim*n
+				  + U(len_w))
+	  + sizeof(int) * U(len_jw);
+
+     /* the workspace is kept by the caller between runs, so that
+	repeated solves of the same-sized problem allocate nothing */
+     if (*work_size < len_work) {
+	  free(*workp);
+	  *workp = malloc(len_work);
+	  *work_size = *workp ? len_work : 0;
+     }
+     work = (double *) *workp;
      if (!work) return NLOPT_OUT_OF_MEMORY;
      cgrad = work;
      c = cgrad + U(mpi1) * (n + 1);
@@ -2633,6 +2731,5 @@ done:
 	  }
      }
 
-     free(work);
      return ret;
 }
@@ -98,6 +98,32 @@ const char *NLOPT_STDCALL nlopt_algorithm_name(nlopt_algorithm a)
 }
 
 
+/*************************************************************************/
+
+static const char nlopt_phase_names[NLOPT_NUM_PHASES][16] = {
+    "qp",
+    "dual",
+    "hull",
+    "distance",
+    "sort"
+};
+
+int NLOPT_STDCALL nlopt_num_phases(void)
+{
+#ifdef NLOPT_PROFILE
+    return NLOPT_NUM_PHASES;
+#else
+    return 0;
+#endif
+}
+
+const char *NLOPT_STDCALL nlopt_phase_name(int phase)
+{
+    if (phase < 0 || phase >= NLOPT_NUM_PHASES)
+        return "UNKNOWN";
+    return nlopt_phase_names[phase];
+}
+
 /*************************************************************************/
 
 const char *nlopt_algorithm_to_string(nlopt_algorithm algorithm)
@@ -185,6 +211,7 @@ const char *nlopt_result_to_string(nlopt_result result)
     case NLOPT_XTOL_REACHED: return "XTOL_REACHED";
     case NLOPT_MAXEVAL_REACHED: return "MAXEVAL_REACHED";
     case NLOPT_MAXTIME_REACHED: return "MAXTIME_REACHED";
+    case NLOPT_STALL_REACHED: return "STALL_REACHED";
     default: return NULL;
   }
 }
@@ -246,3 +273,23 @@ void nlopt_srand_time_default(void)
 }
 
 /*************************************************************************/
+
+nlopt_result NLOPT_STDCALL nlopt_sobol_points(unsigned dim, unsigned count, unsigned skip, double *x)
+{
+    nlopt_sobol s;
+    if (dim == 0 || dim > NLOPT_SOBOL_MAXDIM || count > 4294967295U - skip)
+        return NLOPT_INVALID_ARGS;
+    if (count == 0)
+        return NLOPT_SUCCESS;
+    if (!x)
+        return NLOPT_INVALID_ARGS;
+    s = nlopt_sobol_create(dim);
+    if (!s)
+        return NLOPT_OUT_OF_MEMORY;
+    nlopt_sobol_seek(s, skip);
+    nlopt_sobol_fill01(s, count, x);
+    nlopt_sobol_destroy(s);
+    return NLOPT_SUCCESS;
+}
+
+/*************************************************************************/
@@ -402,6 +402,11 @@ namespace nlopt {
       mythrow(nlopt_set_max_objective(o, myfunc, d)); // d freed via o
     }
 
+    // optional batch version of the objective, see nlopt_set_batch_objective
+    void set_batch_objective(nlopt_batch_func fb, void *fb_data) {
+      mythrow(nlopt_set_batch_objective(o, fb, fb_data));
+    }
+
     // Nonlinear constraints:
 
     void remove_inequality_constraints() {
@@ -563,8 +568,50 @@ namespace nlopt {
       return nlopt_get_numevals(o);
     }
 
+    int get_dual_numevals() const {
+      if (!o) throw std::runtime_error("uninitialized nlopt::opt");
+      return nlopt_get_dual_numevals(o);
+    }
+
+    int get_cache_hits() const {
+      if (!o) throw std::runtime_error("uninitialized nlopt::opt");
+      return nlopt_get_cache_hits(o);
+    }
+
+    int get_cache_misses() const {
+      if (!o) throw std::runtime_error("uninitialized nlopt::opt");
+      return nlopt_get_cache_misses(o);
+    }
+
+    size_t get_workspace_size() const {
+      if (!o) throw std::runtime_error("uninitialized nlopt::opt");
+      return nlopt_get_workspace_size(o);
+    }
+
+    double get_phase_time(int phase) const {
+      if (!o) throw std::runtime_error("uninitialized nlopt::opt");
+      return nlopt_get_phase_time(o, phase);
+    }
+
+    unsigned long get_phase_count(int phase) const {
+      if (!o) throw std::runtime_error("uninitialized nlopt::opt");
+      return nlopt_get_phase_count(o, phase);
+    }
+
     NLOPT_GETSET(double, maxtime)
 
+    void set_stall(int window, double rel_improvement) {
+      mythrow(nlopt_set_stall(o, window, rel_improvement));
+    }
+    int get_stall_window() const {
+      if (!o) throw std::runtime_error("uninitialized nlopt::opt");
+      return nlopt_get_stall_window(o);
+    }
+    double get_stall_improvement() const {
+      if (!o) throw std::runtime_error("uninitialized nlopt::opt");
+      return nlopt_get_stall_improvement(o);
+    }
+
     NLOPT_GETSET(int, force_stop)
     void force_stop() { set_force_stop(1); }
 
@@ -582,6 +629,13 @@ namespace nlopt {
 
     NLOPT_GETSET(unsigned, population)
     NLOPT_GETSET(unsigned, vector_storage)
+
+    void set_seed(unsigned long seed, unsigned stream = 0) {
+      mythrow(nlopt_set_seed(o, seed, stream));
+    }
+    void unset_seed() {
+      mythrow(nlopt_unset_seed(o));
+    }
     NLOPT_GETSET_VEC(initial_step)
 
     void set_default_initial_step(const std::vector<double> &x) {
@@ -637,6 +691,19 @@ namespace nlopt {
   inline const char *algorithm_name(algorithm a) {
     return nlopt_algorithm_name(nlopt_algorithm(a));
   }
+  inline int num_phases() {
+    return nlopt_num_phases();
+  }
+  inline const char *phase_name(int phase) {
+    return nlopt_phase_name(phase);
+  }
+  inline std::vector<double> sobol_points(unsigned dim, unsigned count, unsigned skip = 0) {
+    std::vector<double> x(size_t(dim) * count);
+    nlopt_result ret = nlopt_sobol_points(dim, count, skip, x.empty() ? NULL : &x[0]);
+    if (ret == NLOPT_OUT_OF_MEMORY) throw std::bad_alloc();
+    if (ret == NLOPT_INVALID_ARGS) throw std::invalid_argument("invalid Sobol dimension or count");
+    return x;
+  }
 
   //////////////////////////////////////////////////////////////////////
 
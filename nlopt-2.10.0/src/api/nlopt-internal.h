@@ -45,6 +45,8 @@ extern "C" {
         void *f_data;           /* objective function to minimize */
         nlopt_precond pre;      /* optional preconditioner for f (NULL if none) */
         int maximize;           /* nonzero if we are maximizing, not minimizing */
+        nlopt_batch_func fb;    /* optional batch version of f (NULL if none) */
+        void *fb_data;
 
         nlopt_opt_param *params;
         unsigned nparams;
@@ -68,10 +70,17 @@ extern "C" {
         double *x_weights;      /* weights for relative x tolerance */
         int maxeval;            /* max # evaluations */
         int numevals;           /* number of evaluations */
+        int dual_numevals;      /* # dual-function evaluations (MMA/CCSAQ) */
+        int cache_hits, cache_misses;   /* eval_cache statistics */
         double maxtime;         /* max time (seconds) */
+        int stall_window;       /* stop after this many evaluations without ... */
+        double stall_rel;       /* ... a relative improvement of stall_rel in f */
 
         int force_stop;         /* if nonzero, force a halt the next time we
                                    try to evaluate the objective during optimization */
+        nlopt_trace_func trace; /* timeline hook, or NULL */
+        void *trace_data;
+        int trace_inherited;    /* trace was set by push_force_stop_child */
         /* when local optimization is used, we need a force_stop in the
            parent object to force a stop in child optimizations */
         struct nlopt_opt_s *force_stop_child;
@@ -80,9 +89,15 @@ extern "C" {
         nlopt_opt local_opt;    /* local optimizer */
         unsigned stochastic_population; /* population size for stochastic algs */
         double *dx;             /* initial step sizes (length n) for nonderivative algs */
+        int seeded;             /* use rng, seeded from seed and stream at each run, */
+        unsigned long seed;     /* ... instead of the global random generator */
+        unsigned stream;
+        nlopt_rng rng;
         unsigned vector_storage;        /* max subspace dimension (0 for default) */
 
         void *work;             /* algorithm-specific workspace during optimization */
+        size_t work_size;       /* bytes allocated in work, if it is kept between runs */
+        nlopt_profile profile;  /* phase timings of the most recent run (NLOPT_PROFILE only) */
 
         char *errmsg;           /* description of most recent error */
     };
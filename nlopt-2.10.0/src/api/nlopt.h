@@ -69,6 +69,10 @@ typedef void (*nlopt_mfunc) (unsigned m, double *result, unsigned n, const doubl
    (The meaning of "preconditioning" is algorithm-dependent.) */
 typedef void (*nlopt_precond) (unsigned n, const double *x, const double *v, double *vpre, void *data);
 
+/* A batch objective, which evaluates the objective (without gradient) at
+   count points x (count-by-n, row-major), storing the values in f. */
+typedef void (*nlopt_batch_func) (unsigned count, unsigned n, const double *x, double *f, void *data);
+
 typedef enum {
     /* Naming conventions:
 
@@ -172,6 +176,7 @@ typedef enum {
     NLOPT_XTOL_REACHED = 4,
     NLOPT_MAXEVAL_REACHED = 5,
     NLOPT_MAXTIME_REACHED = 6,
+    NLOPT_STALL_REACHED = 7,
     NLOPT_NUM_RESULTS           /* not a result, just the number of possible successes */
 } nlopt_result;
 
@@ -186,6 +191,10 @@ NLOPT_EXTERN(void) nlopt_srand_time(void);
 
 NLOPT_EXTERN(void) nlopt_version(int *major, int *minor, int *bugfix);
 
+/* points skip+1 ... skip+count of the Sobol' low-discrepancy sequence in
+   dim <= 21201 dimensions, as the rows of the count x dim array x */
+NLOPT_EXTERN(nlopt_result) nlopt_sobol_points(unsigned dim, unsigned count, unsigned skip, double *x);
+
 /*************************** OBJECT-ORIENTED API **************************/
 /* The style here is that we create an nlopt_opt "object" (an opaque pointer),
    then set various optimization parameters, and then execute the
@@ -212,6 +221,11 @@ NLOPT_EXTERN(nlopt_result) nlopt_set_max_objective(nlopt_opt opt, nlopt_func f,
 NLOPT_EXTERN(nlopt_result) nlopt_set_precond_min_objective(nlopt_opt opt, nlopt_func f, nlopt_precond pre, void *f_data);
 NLOPT_EXTERN(nlopt_result) nlopt_set_precond_max_objective(nlopt_opt opt, nlopt_func f, nlopt_precond pre, void *f_data);
 
+/* optional: lets algorithms that generate several points at once hand them
+   over in one call, e.g. to evaluate them in parallel; fb must compute the
+   same function as the objective (with the same sense, min or max) */
+NLOPT_EXTERN(nlopt_result) nlopt_set_batch_objective(nlopt_opt opt, nlopt_batch_func fb, void *fb_data);
+
 NLOPT_EXTERN(nlopt_algorithm) nlopt_get_algorithm(const nlopt_opt opt);
 NLOPT_EXTERN(unsigned) nlopt_get_dimension(const nlopt_opt opt);
 
@@ -268,10 +282,38 @@ NLOPT_EXTERN(nlopt_result) nlopt_set_maxeval(nlopt_opt opt, int maxeval);
 NLOPT_EXTERN(int) nlopt_get_maxeval(const nlopt_opt opt);
 
 NLOPT_EXTERN(int) nlopt_get_numevals(const nlopt_opt opt);
+NLOPT_EXTERN(int) nlopt_get_dual_numevals(const nlopt_opt opt);
+NLOPT_EXTERN(int) nlopt_get_cache_hits(const nlopt_opt opt);
+NLOPT_EXTERN(int) nlopt_get_cache_misses(const nlopt_opt opt);
+NLOPT_EXTERN(size_t) nlopt_get_workspace_size(const nlopt_opt opt);
+
+/* per-phase profile of the most recent run; nlopt_num_phases() is 0
+   unless NLopt was built with NLOPT_PROFILE */
+NLOPT_EXTERN(int) nlopt_num_phases(void);
+NLOPT_EXTERN(const char *) nlopt_phase_name(int phase);
+NLOPT_EXTERN(double) nlopt_get_phase_time(const nlopt_opt opt, int phase);
+NLOPT_EXTERN(unsigned long) nlopt_get_phase_count(const nlopt_opt opt, int phase);
+
+/* timeline hook: called when an optimization (or a local optimization it
+   runs, e.g. in MLSL or AUGLAG) begins and ends, and whenever the
+   algorithm starts an outer iteration */
+typedef enum {
+    NLOPT_TRACE_BEGIN,
+    NLOPT_TRACE_ITERATION,
+    NLOPT_TRACE_END
+} nlopt_trace_event;
+typedef void (*nlopt_trace_func) (nlopt_trace_event event, nlopt_algorithm algorithm, void *data);
+NLOPT_EXTERN(nlopt_result) nlopt_set_trace_func(nlopt_opt opt, nlopt_trace_func trace, void *trace_data);
 
 NLOPT_EXTERN(nlopt_result) nlopt_set_maxtime(nlopt_opt opt, double maxtime);
 NLOPT_EXTERN(double) nlopt_get_maxtime(const nlopt_opt opt);
 
+/* stop when the best f has not improved by a fraction rel_improvement
+   of its magnitude within the last window evaluations (0 = disabled) */
+NLOPT_EXTERN(nlopt_result) nlopt_set_stall(nlopt_opt opt, int window, double rel_improvement);
+NLOPT_EXTERN(int) nlopt_get_stall_window(const nlopt_opt opt);
+NLOPT_EXTERN(double) nlopt_get_stall_improvement(const nlopt_opt opt);
+
 NLOPT_EXTERN(nlopt_result) nlopt_force_stop(nlopt_opt opt);
 NLOPT_EXTERN(nlopt_result) nlopt_set_force_stop(nlopt_opt opt, int val);
 NLOPT_EXTERN(int) nlopt_get_force_stop(const nlopt_opt opt);
@@ -286,6 +328,12 @@ NLOPT_EXTERN(unsigned) nlopt_get_population(const nlopt_opt opt);
 NLOPT_EXTERN(nlopt_result) nlopt_set_vector_storage(nlopt_opt opt, unsigned dim);
 NLOPT_EXTERN(unsigned) nlopt_get_vector_storage(const nlopt_opt opt);
 
+/* give opt its own random stream, restarted from (seed, stream) at every
+   run, instead of the global one of nlopt_srand; different stream numbers
+   for the same seed give non-overlapping sequences */
+NLOPT_EXTERN(nlopt_result) nlopt_set_seed(nlopt_opt opt, unsigned long seed, unsigned stream);
+NLOPT_EXTERN(nlopt_result) nlopt_unset_seed(nlopt_opt opt);
+
 NLOPT_EXTERN(nlopt_result) nlopt_set_default_initial_step(nlopt_opt opt, const double *x);
 NLOPT_EXTERN(nlopt_result) nlopt_set_initial_step(nlopt_opt opt, const double *dx);
 NLOPT_EXTERN(nlopt_result) nlopt_set_initial_step1(nlopt_opt opt, double dx);
@@ -199,6 +199,12 @@ static void push_force_stop_child(nlopt_opt opt, nlopt_opt newchild)
     /* assert: newchild != NULL && newchild->force_stop_child == NULL */
     newchild->force_stop_child = opt->force_stop_child;
     opt->force_stop_child = newchild;
+    /* the child's runs show up in the parent's timeline */
+    if (opt->trace && !newchild->trace) {
+        newchild->trace = opt->trace;
+        newchild->trace_data = opt->trace_data;
+        newchild->trace_inherited = 1;
+    }
 }
 
 static nlopt_opt pop_force_stop_child(nlopt_opt opt)
@@ -207,6 +213,11 @@ static nlopt_opt pop_force_stop_child(nlopt_opt opt)
     nlopt_opt oldchild = opt->force_stop_child;
     opt->force_stop_child = oldchild->force_stop_child;
     oldchild->force_stop_child = NULL;
+    if (oldchild->trace_inherited) {
+        oldchild->trace = NULL;
+        oldchild->trace_data = NULL;
+        oldchild->trace_inherited = 0;
+    }
     return oldchild;
 }
 
@@ -224,6 +235,8 @@ typedef struct {
     double *x;                  /* scratch vector of length n */
     double *grad;               /* optional scratch vector of length n */
     const double *lb, *ub;      /* bounds, of length n */
+    nlopt_batch_func fb;        /* batch objective, or NULL */
+    void *fb_data;
 } elimdim_data;
 
 static void *elimdim_makedata(nlopt_func f, nlopt_mfunc mf, void *f_data, unsigned n, double *x, const double *lb, const double *ub, double *grad)
@@ -239,24 +252,34 @@ static void *elimdim_makedata(nlopt_func f, nlopt_mfunc mf, void *f_data, unsign
     d->lb = lb;
     d->ub = ub;
     d->grad = grad;
+    d->fb = NULL;
+    d->fb_data = NULL;
     return d;
 }
 
-static double elimdim_func(unsigned n0, const double *x0, double *grad, void *d_)
+/* expand the point x0 with the eliminated dimensions into x */
+static void elimdim_fill(const elimdim_data *d, double *x, const double *x0)
 {
-    elimdim_data *d = (elimdim_data *) d_;
-    double *x = d->x;
     const double *lb = d->lb, *ub = d->ub;
-    double val;
     unsigned n = d->n, i, j;
-
-    (void) n0;                  /* unused */
     for (i = j = 0; i < n; ++i) {
         if (lb[i] == ub[i])
             x[i] = lb[i];
         else                    /* assert: j < n0 */
             x[i] = x0[j++];
     }
+}
+
+static double elimdim_func(unsigned n0, const double *x0, double *grad, void *d_)
+{
+    elimdim_data *d = (elimdim_data *) d_;
+    double *x = d->x;
+    const double *lb = d->lb, *ub = d->ub;
+    double val;
+    unsigned n = d->n, i, j;
+
+    (void) n0;                  /* unused */
+    elimdim_fill(d, x, x0);
     val = d->f(n, x, grad ? d->grad : NULL, d->f_data);
     if (grad) {
         /* assert: d->grad != NULL */
@@ -271,18 +294,30 @@ static void elimdim_mfunc(unsigned m, double *result, unsigned n0, const double
 {
     elimdim_data *d = (elimdim_data *) d_;
     double *x = d->x;
-    const double *lb = d->lb, *ub = d->ub;
-    unsigned n = d->n, i, j;
 
     (void) n0;                  /* unused */
     (void) grad;                /* assert: grad == NULL */
-    for (i = j = 0; i < n; ++i) {
-        if (lb[i] == ub[i])
-            x[i] = lb[i];
-        else                    /* assert: j < n0 */
-            x[i] = x0[j++];
+    elimdim_fill(d, x, x0);
+    d->mf(m, result, d->n, x, NULL, d->f_data);
+}
+
+static void elimdim_fb(unsigned count, unsigned n0, const double *x0, double *f, void *d_)
+{
+    elimdim_data *d = (elimdim_data *) d_;
+    unsigned n = d->n, k;
+    double *x = (double *) malloc(sizeof(double) * n * count);
+
+    if (!x) {                   /* fall back to one point at a time */
+        for (k = 0; k < count; ++k) {
+            elimdim_fill(d, d->x, x0 + k * n0);
+            d->fb(1, n, d->x, f + k, d->fb_data);
+        }
+        return;
     }
-    d->mf(m, result, n, x, NULL, d->f_data);
+    for (k = 0; k < count; ++k)
+        elimdim_fill(d, x + k * n, x0 + k * n0);
+    d->fb(count, n, x, f, d->fb_data);
+    free(x);
 }
 
 /* compute the eliminated dimension: number of dims with lb[i] != ub[i] */
@@ -359,6 +394,12 @@ static nlopt_opt elimdim_create(nlopt_opt opt)
     opt0->f_data = elimdim_makedata(opt->f, NULL, opt->f_data, opt->n, x, opt->lb, opt->ub, grad);
     if (!opt0->f_data)
         goto bad;
+    if (opt->fb) {
+        ((elimdim_data *) opt0->f_data)->fb = opt->fb;
+        ((elimdim_data *) opt0->f_data)->fb_data = opt->fb_data;
+        opt0->fb = elimdim_fb;
+        opt0->fb_data = opt0->f_data;
+    }
 
     for (i = 0; i < opt->m; ++i) {
         opt0->fc[i].f = opt0->fc[i].f ? elimdim_func : NULL;
@@ -520,6 +561,7 @@ static nlopt_result nlopt_optimize_(nlopt_opt opt, double *x, double *minf)
     unsigned n, i;
     int ni;
     nlopt_stopping stop;
+    nlopt_time_check time_check;
 
     if (!opt || !x || !minf || !opt->f || opt->maximize)
         RETURN_ERR(NLOPT_INVALID_ARGS, opt, "NULL args to nlopt_optimize_");
@@ -558,12 +600,27 @@ static nlopt_result nlopt_optimize_(nlopt_opt opt, double *x, double *minf)
     stop.xtol_abs = opt->xtol_abs;
     stop.x_weights = opt->x_weights;
     opt->numevals = 0;
+    opt->dual_numevals = 0;
     stop.nevals_p = &(opt->numevals);
     stop.maxeval = opt->maxeval;
     stop.maxtime = opt->maxtime;
     stop.start = nlopt_seconds();
+    time_check.countdown = time_check.stride = 1;
+    time_check.last = stop.start;
+    stop.time_check = &time_check;
     stop.force_stop = &(opt->force_stop);
     stop.stop_msg = &(opt->errmsg);
+    stop.trace = opt->trace;
+    stop.trace_data = opt->trace_data;
+    stop.algorithm = algorithm;
+    stop.batch = opt->fb;
+    stop.batch_data = opt->fb_data;
+#ifdef NLOPT_PROFILE
+    memset(&opt->profile, 0, sizeof(opt->profile));
+    stop.profile = &opt->profile;
+#else
+    stop.profile = NULL;
+#endif
 
     switch (algorithm) {
     case NLOPT_GN_DIRECT:
@@ -648,6 +705,8 @@ static nlopt_result nlopt_optimize_(nlopt_opt opt, double *x, double *minf)
             RETURN_ERR(NLOPT_INVALID_ARGS, opt, "finite domain required for global algorithm");
         if (!stogo_minimize(ni, f, f_data, x, minf, lb, ub, &stop, algorithm == NLOPT_GD_STOGO ? 0 : POP(2 * (int)n)))
             return NLOPT_FAILURE;
+        if (nlopt_stop_forced(&stop))
+            return NLOPT_FORCED_STOP;
         break;
 #else
         return NLOPT_INVALID_ARGS;
@@ -744,7 +803,7 @@ static nlopt_result nlopt_optimize_(nlopt_opt opt, double *x, double *minf)
     case NLOPT_GN_CRS2_LM:
         if (!finite_domain(n, lb, ub))
             RETURN_ERR(NLOPT_INVALID_ARGS, opt, "finite domain required for global algorithm");
-        return crs_minimize(ni, f, f_data, lb, ub, x, minf, &stop, POP(0), 0);
+        return crs_minimize(ni, f, f_data, lb, ub, x, minf, &stop, POP(0), 0, (int) nlopt_get_param(opt, "crs_batch", 1));
 
     case NLOPT_G_MLSL:
     case NLOPT_G_MLSL_LDS:
@@ -798,28 +857,38 @@ static nlopt_result nlopt_optimize_(nlopt_opt opt, double *x, double *minf)
             int inner_maxeval = (int)nlopt_get_param(opt, "inner_maxeval",0);
             int verbosity = (int)nlopt_get_param(opt, "verbosity",0);
             double rho_init = nlopt_get_param(opt, "rho_init",1.0);
-            nlopt_opt dual_opt;
+            int dual_warm_start = nlopt_get_param(opt, "dual_warm_start",0) != 0;
+            double eval_threads = nlopt_get_param(opt, "eval_threads",0);
+            unsigned m = nlopt_count_constraints(opt->m, opt->fc);
+            nlopt_opt dual_opt = NULL;
             nlopt_result ret;
 
             if (!(rho_init > 0) && !nlopt_isinf(rho_init))
                 RETURN_ERR(NLOPT_INVALID_ARGS, opt, "rho_init must be positive and finite");
             verbosity = verbosity < 0 ? 0 : verbosity;
+            eval_threads = eval_threads < 0 ? 0 : (eval_threads > 1024 ? 1024 : eval_threads);
 
+            /* with no constraints the dual problem is trivial (this is
+               always the case when MMA/CCSAQ is itself solving a dual),
+               so don't bother creating a dual optimizer -- except that
+               a preconditioned CCSAQ takes its inner algorithm from it */
+            if (m > 0 || (algorithm == NLOPT_LD_CCSAQ && opt->pre)) {
 #define LO(param, def) (opt->local_opt ? opt->local_opt->param : (def))
-            dual_opt = nlopt_create((nlopt_algorithm)nlopt_get_param(opt, "dual_algorithm", LO(algorithm, nlopt_local_search_alg_deriv)),
-                                    nlopt_count_constraints(opt->m, opt->fc));
-            if (!dual_opt)
-                RETURN_ERR(NLOPT_FAILURE, opt, "failed creating dual optimizer");
-            nlopt_set_ftol_rel(dual_opt, nlopt_get_param(opt, "dual_ftol_rel", LO(ftol_rel, 1e-14)));
-            nlopt_set_ftol_abs(dual_opt, nlopt_get_param(opt, "dual_ftol_abs", LO(ftol_abs, 0.0)));
-            nlopt_set_xtol_rel(dual_opt, nlopt_get_param(opt, "dual_xtol_rel", 0.0));
-            nlopt_set_xtol_abs1(dual_opt, nlopt_get_param(opt, "dual_xtol_abs", 0.0));
-            nlopt_set_maxeval(dual_opt, (int)nlopt_get_param(opt, "dual_maxeval", LO(maxeval, 100000)));
+                dual_opt = nlopt_create((nlopt_algorithm)nlopt_get_param(opt, "dual_algorithm", LO(algorithm, nlopt_local_search_alg_deriv)), m);
+                if (!dual_opt)
+                    RETURN_ERR(NLOPT_FAILURE, opt, "failed creating dual optimizer");
+                nlopt_set_ftol_rel(dual_opt, nlopt_get_param(opt, "dual_ftol_rel", LO(ftol_rel, 1e-14)));
+                nlopt_set_ftol_abs(dual_opt, nlopt_get_param(opt, "dual_ftol_abs", LO(ftol_abs, 0.0)));
+                nlopt_set_xtol_rel(dual_opt, nlopt_get_param(opt, "dual_xtol_rel", 0.0));
+                nlopt_set_xtol_abs1(dual_opt, nlopt_get_param(opt, "dual_xtol_abs", 0.0));
+                nlopt_set_maxeval(dual_opt, (int)nlopt_get_param(opt, "dual_maxeval", LO(maxeval, 100000)));
 #undef LO
+            }
+
             if (algorithm == NLOPT_LD_MMA)
-                ret = mma_minimize(n, f, f_data, opt->m, opt->fc, lb, ub, x, minf, &stop, dual_opt, inner_maxeval, (unsigned)verbosity, rho_init, opt->dx);
+                ret = mma_minimize(n, f, f_data, opt->m, opt->fc, lb, ub, x, minf, &stop, dual_opt, inner_maxeval, (unsigned)verbosity, rho_init, opt->dx, dual_warm_start, &opt->work, &opt->work_size, &opt->dual_numevals, (unsigned)eval_threads);
             else
-                ret = ccsa_quadratic_minimize(n, f, f_data, opt->m, opt->fc, opt->pre, lb, ub, x, minf, &stop, dual_opt, inner_maxeval, (unsigned)verbosity, rho_init, opt->dx);
+                ret = ccsa_quadratic_minimize(n, f, f_data, opt->m, opt->fc, opt->pre, lb, ub, x, minf, &stop, dual_opt, inner_maxeval, (unsigned)verbosity, rho_init, opt->dx, dual_warm_start, &opt->work, &opt->work_size, &opt->dual_numevals, (unsigned)eval_threads);
             nlopt_destroy(dual_opt);
             return ret;
         }
@@ -903,6 +972,8 @@ static nlopt_result nlopt_optimize_(nlopt_opt opt, double *x, double *minf)
     case NLOPT_LD_AUGLAG_EQ:
         {
             nlopt_opt local_opt = opt->local_opt;
+            int warm_start = nlopt_get_param(opt, "warm_start", 0) != 0;
+            double *local_dx = NULL;
             nlopt_result ret;
             if ((algorithm == NLOPT_AUGLAG || algorithm == NLOPT_AUGLAG_EQ)
                 && !local_opt)
@@ -919,13 +990,25 @@ static nlopt_result nlopt_optimize_(nlopt_opt opt, double *x, double *minf)
             }
             if (opt->dx)
                 nlopt_set_initial_step(local_opt, opt->dx);
+            /* a warm start changes the local optimizer's initial step, so
+               save the caller's (if any) to restore afterwards */
+            if (warm_start && opt->local_opt && local_opt->dx) {
+                local_dx = (double *) malloc(sizeof(double) * n);
+                if (!local_dx)
+                    RETURN_ERR(NLOPT_OUT_OF_MEMORY, opt, "failed to allocate initial step");
+                memcpy(local_dx, local_opt->dx, sizeof(double) * n);
+            }
             push_force_stop_child(opt, local_opt);
             ret = auglag_minimize(ni, f, f_data,
                                   opt->m, opt->fc,
-                                  opt->p, opt->h, lb, ub, x, minf, &stop, local_opt, algorithm == NLOPT_AUGLAG_EQ || algorithm == NLOPT_LN_AUGLAG_EQ || algorithm == NLOPT_LD_AUGLAG_EQ);
+                                  opt->p, opt->h, lb, ub, x, minf, &stop, local_opt, algorithm == NLOPT_AUGLAG_EQ || algorithm == NLOPT_LN_AUGLAG_EQ || algorithm == NLOPT_LD_AUGLAG_EQ, warm_start);
             pop_force_stop_child(opt);
             if (!opt->local_opt)
                 nlopt_destroy(local_opt);
+            else if (warm_start) {
+                nlopt_set_initial_step(local_opt, local_dx);
+                free(local_dx);
+            }
             return ret;
         }
 
@@ -940,7 +1023,7 @@ static nlopt_result nlopt_optimize_(nlopt_opt opt, double *x, double *minf)
         return chevolutionarystrategy(n, f, f_data, lb, ub, x, minf, &stop, (unsigned) POP(0), (unsigned) (POP(0) * 1.5));
 
     case NLOPT_LD_SLSQP:
-        return nlopt_slsqp(n, f, f_data, opt->m, opt->fc, opt->p, opt->h, lb, ub, x, minf, &stop);
+        return nlopt_slsqp(n, f, f_data, opt->m, opt->fc, opt->p, opt->h, lb, ub, x, minf, &stop, &opt->work, &opt->work_size);
 
     default:
         return NLOPT_INVALID_ARGS;
@@ -950,11 +1033,130 @@ static nlopt_result nlopt_optimize_(nlopt_opt opt, double *x, double *minf)
 }
 
 /*********************************************************************/
+/* optional evaluation cache (eval_cache param): wraps the objective and
+   every constraint so that repeated evaluations at the same x (or, with
+   eval_cache_tol > 0, at the same quantized x) are served from a bounded
+   hash table instead of calling the user function again */
 
 typedef struct {
+    nlopt_evalcache *cache;
+    int fid;                    /* 0 = objective, then fc, then h */
     nlopt_func f;
+    nlopt_mfunc mf;
     nlopt_precond pre;
     void *f_data;
+    const int *force_stop;
+} cache_data;
+
+static double cache_func(unsigned n, const double *x, double *grad, void *d_)
+{
+    cache_data *d = (cache_data *) d_;
+    double val;
+    if (!nlopt_evalcache_get(d->cache, d->fid, 1, x, &val, grad)) {
+        val = d->f(n, x, grad, d->f_data);
+        if (!*d->force_stop)
+            nlopt_evalcache_put(d->cache, d->fid, 1, x, &val, grad);
+    }
+    return val;
+}
+
+static void cache_mfunc(unsigned m, double *result, unsigned n, const double *x, double *grad, void *d_)
+{
+    cache_data *d = (cache_data *) d_;
+    if (!nlopt_evalcache_get(d->cache, d->fid, m, x, result, grad)) {
+        d->mf(m, result, n, x, grad, d->f_data);
+        if (!*d->force_stop)
+            nlopt_evalcache_put(d->cache, d->fid, m, x, result, grad);
+    }
+}
+
+static void cache_pre(unsigned n, const double *x, const double *v, double *vpre, void *d_)
+{
+    cache_data *d = (cache_data *) d_;
+    d->pre(n, x, v, vpre, d->f_data);
+}
+
+static void cache_wrap1(cache_data *d, nlopt_evalcache *cache, int fid, const int *force_stop, nlopt_func *f, nlopt_mfunc *mf, nlopt_precond *pre, void **f_data)
+{
+    d->cache = cache;
+    d->fid = fid;
+    d->force_stop = force_stop;
+    d->f = *f;
+    d->mf = mf ? *mf : NULL;
+    d->pre = *pre;
+    d->f_data = *f_data;
+    if (*f)
+        *f = cache_func;
+    else
+        *mf = cache_mfunc;
+    if (*pre)
+        *pre = cache_pre;
+    *f_data = d;
+}
+
+/* returns NULL (and leaves opt alone) unless eval_cache > 0 */
+static nlopt_evalcache *cache_create(nlopt_opt opt, cache_data **cdp)
+{
+    double capacity = nlopt_get_param(opt, "eval_cache", 0);
+    unsigned maxm, i;
+    nlopt_evalcache *cache;
+    cache_data *cd;
+
+    if (!(capacity >= 1))
+        return NULL;
+    if (capacity > 1e8)
+        capacity = 1e8;
+    maxm = nlopt_max_constraint_dim(opt->m, opt->fc);
+    if (nlopt_max_constraint_dim(opt->p, opt->h) > maxm)
+        maxm = nlopt_max_constraint_dim(opt->p, opt->h);
+    if (maxm < 1)
+        maxm = 1;
+    cache = nlopt_evalcache_create(opt->n, maxm, (unsigned) capacity, nlopt_get_param(opt, "eval_cache_tol", 0));
+    cd = (cache_data *) malloc(sizeof(cache_data) * (1 + opt->m + opt->p));
+    if (!cache || !cd) {
+        nlopt_evalcache_destroy(cache);
+        free(cd);
+        return NULL;
+    }
+    cache_wrap1(cd, cache, 0, &opt->force_stop, &opt->f, NULL, &opt->pre, &opt->f_data);
+    for (i = 0; i < opt->m; ++i)
+        cache_wrap1(cd + 1 + i, cache, (int) (1 + i), &opt->force_stop, &opt->fc[i].f, &opt->fc[i].mf, &opt->fc[i].pre, &opt->fc[i].f_data);
+    for (i = 0; i < opt->p; ++i)
+        cache_wrap1(cd + 1 + opt->m + i, cache, (int) (1 + opt->m + i), &opt->force_stop, &opt->h[i].f, &opt->h[i].mf, &opt->h[i].pre, &opt->h[i].f_data);
+    *cdp = cd;
+    return cache;
+}
+
+static void cache_unwrap1(const cache_data *d, nlopt_func *f, nlopt_mfunc *mf, nlopt_precond *pre, void **f_data)
+{
+    *f = d->f;
+    if (mf)
+        *mf = d->mf;
+    *pre = d->pre;
+    *f_data = d->f_data;
+}
+
+static void cache_destroy(nlopt_opt opt, nlopt_evalcache *cache, cache_data *cd)
+{
+    unsigned i;
+    nlopt_evalcache_stats(cache, &opt->cache_hits, &opt->cache_misses);
+    cache_unwrap1(cd, &opt->f, NULL, &opt->pre, &opt->f_data);
+    for (i = 0; i < opt->m; ++i)
+        cache_unwrap1(cd + 1 + i, &opt->fc[i].f, &opt->fc[i].mf, &opt->fc[i].pre, &opt->fc[i].f_data);
+    for (i = 0; i < opt->p; ++i)
+        cache_unwrap1(cd + 1 + opt->m + i, &opt->h[i].f, &opt->h[i].mf, &opt->h[i].pre, &opt->h[i].f_data);
+    nlopt_evalcache_destroy(cache);
+    free(cd);
+}
+
+/*********************************************************************/
+
+typedef struct {
+    nlopt_func f;
+    nlopt_precond pre;
+    void *f_data;
+    nlopt_batch_func fb;
+    void *fb_data;
 } f_max_data;
 
 /* wrapper for maximizing: just flip the sign of f and grad */
@@ -970,6 +1172,70 @@ static double f_max(unsigned n, const double *x, double *grad, void *data)
     return -val;
 }
 
+static void fb_max(unsigned count, unsigned n, const double *x, double *f, void *data)
+{
+    f_max_data *d = (f_max_data *) data;
+    unsigned i;
+    d->fb(count, n, x, f, d->fb_data);
+    for (i = 0; i < count; ++i)
+        f[i] = -f[i];
+}
+
+/* wrapper for the stall criterion: tracks the best f of every evaluation,
+   including those of nested local optimizations, and forces a stop once
+   window evaluations pass without a sufficient improvement.  All
+   algorithms already poll force_stop, so this covers every one of them. */
+typedef struct {
+    nlopt_func f;
+    void *f_data;
+    nlopt_precond pre;
+    nlopt_batch_func fb;
+    void *fb_data;
+    nlopt_opt opt;
+    int window, evals, last;    /* last = evals at the latest improvement */
+    double rel, minf, ref;      /* ref = minf at the latest improvement */
+    int stalled;
+} stall_data;
+
+static void stall_update(stall_data *d, double val)
+{
+    ++d->evals;
+    if (val < d->minf) {
+        d->minf = val;
+        if (d->ref == HUGE_VAL || d->minf < d->ref - d->rel * fabs(d->ref)) {
+            d->ref = d->minf;
+            d->last = d->evals;
+        }
+    }
+    if (d->evals - d->last >= d->window && !d->stalled) {
+        d->stalled = 1;
+        nlopt_force_stop(d->opt);
+    }
+}
+
+static double stall_func(unsigned n, const double *x, double *grad, void *data)
+{
+    stall_data *d = (stall_data *) data;
+    double val = d->f(n, x, grad, d->f_data);
+    stall_update(d, val);
+    return val;
+}
+
+static void stall_pre(unsigned n, const double *x, const double *v, double *vpre, void *data)
+{
+    stall_data *d = (stall_data *) data;
+    d->pre(n, x, v, vpre, d->f_data);
+}
+
+static void stall_fb(unsigned count, unsigned n, const double *x, double *f, void *data)
+{
+    stall_data *d = (stall_data *) data;
+    unsigned i;
+    d->fb(count, n, x, f, d->fb_data);
+    for (i = 0; i < count; ++i)
+        stall_update(d, f[i]);
+}
+
 static void pre_max(unsigned n, const double *x, const double *v, double *vpre, void *data)
 {
     f_max_data *d = (f_max_data *) data;
@@ -984,17 +1250,45 @@ nlopt_result NLOPT_STDCALL nlopt_optimize(nlopt_opt opt, double *x, double *opt_
     nlopt_func f;
     void *f_data;
     nlopt_precond pre;
+    nlopt_batch_func fb;
+    void *fb_data;
     f_max_data fmd;
+    stall_data sd;
     memoize_data mmzd;
+    nlopt_evalcache *cache;
+    cache_data *cd = NULL;
+    nlopt_rng *prev_rng = NULL;
     int maximize;
     nlopt_result ret;
 
     nlopt_unset_errmsg(opt);
     if (!opt || !opt_f || !opt->f)
         RETURN_ERR(NLOPT_INVALID_ARGS, opt, "NULL args to nlopt_optimize");
+
+    /* a seeded opt draws from its own stream for the whole run, including
+       any local optimizations that are not seeded themselves */
+    if (opt->seeded) {
+        nlopt_rng_seed(&opt->rng, opt->seed, opt->stream);
+        prev_rng = nlopt_rng_use(&opt->rng);
+    }
+
+    if (opt->trace)
+        opt->trace(NLOPT_TRACE_BEGIN, opt->algorithm, opt->trace_data);
+
+    /* the cache wraps the user's functions, underneath any other wrapper */
+    opt->cache_hits = opt->cache_misses = 0;
+    cache = cache_create(opt, &cd);
+
     f = opt->f;
     f_data = opt->f_data;
     pre = opt->pre;
+    fb = opt->fb;
+    fb_data = opt->fb_data;
+
+    /* the batch objective bypasses the cache and the memoizing wrapper,
+       so it is only used without them */
+    if (cache || memoize_wrapcheck(opt))
+        opt->fb = NULL;
 
     /* reset stopping flag */
     nlopt_set_force_stop(opt, 0);
@@ -1006,14 +1300,42 @@ nlopt_result NLOPT_STDCALL nlopt_optimize(nlopt_opt opt, double *x, double *opt_
         fmd.f = f;
         fmd.f_data = f_data;
         fmd.pre = pre;
+        fmd.fb = opt->fb;
+        fmd.fb_data = opt->fb_data;
         opt->f = f_max;
         opt->f_data = &fmd;
         if (opt->pre)
             opt->pre = pre_max;
+        if (opt->fb) {
+            opt->fb = fb_max;
+            opt->fb_data = &fmd;
+        }
         opt->stopval = -opt->stopval;
         opt->maximize = 0;
     }
 
+    if (opt->stall_window > 0) {
+        sd.f = opt->f;
+        sd.f_data = opt->f_data;
+        sd.pre = opt->pre;
+        sd.fb = opt->fb;
+        sd.fb_data = opt->fb_data;
+        sd.opt = opt;
+        sd.window = opt->stall_window;
+        sd.evals = sd.last = 0;
+        sd.rel = opt->stall_rel;
+        sd.minf = sd.ref = HUGE_VAL;
+        sd.stalled = 0;
+        opt->f = stall_func;
+        opt->f_data = &sd;
+        if (opt->pre)
+            opt->pre = stall_pre;
+        if (opt->fb) {
+            opt->fb = stall_fb;
+            opt->fb_data = &sd;
+        }
+    }
+
     if (memoize_wrapcheck(opt))
     {
         mmzd.f = opt->f;
@@ -1043,6 +1365,7 @@ nlopt_result NLOPT_STDCALL nlopt_optimize(nlopt_opt opt, double *x, double *opt_
 
         if (elim_opt != opt) {
             opt->numevals = elim_opt->numevals;
+            opt->dual_numevals = elim_opt->dual_numevals;
             opt->errmsg = elim_opt->errmsg; elim_opt->errmsg = NULL;
             pop_force_stop_child(opt);
             elimdim_expand(opt->n, x, opt->lb, opt->ub);
@@ -1061,6 +1384,16 @@ nlopt_result NLOPT_STDCALL nlopt_optimize(nlopt_opt opt, double *x, double *opt_
         opt->f_data = mmzd.f_data;
     }
 
+    if (opt->stall_window > 0) {
+        opt->f = sd.f;
+        opt->f_data = sd.f_data;
+        opt->pre = sd.pre;
+        if (sd.stalled && ret == NLOPT_FORCED_STOP) {
+            nlopt_set_force_stop(opt, 0);
+            ret = NLOPT_STALL_REACHED;
+        }
+    }
+
     if (maximize) { /* restore original signs */
         opt->maximize = maximize;
         opt->stopval = -opt->stopval;
@@ -1069,6 +1402,17 @@ nlopt_result NLOPT_STDCALL nlopt_optimize(nlopt_opt opt, double *x, double *opt_
         opt->pre = pre;
         *opt_f = -*opt_f;
     }
+    opt->fb = fb;
+    opt->fb_data = fb_data;
+
+    if (cache)
+        cache_destroy(opt, cache, cd);
+
+    if (opt->trace)
+        opt->trace(NLOPT_TRACE_END, opt->algorithm, opt->trace_data);
+
+    if (opt->seeded)
+        nlopt_rng_use(prev_rng);
 
     return ret;
 }
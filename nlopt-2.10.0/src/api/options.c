@@ -81,6 +81,8 @@ nlopt_opt NLOPT_STDCALL nlopt_create(nlopt_algorithm algorithm, unsigned n)
         opt->f_data = NULL;
         opt->pre = NULL;
         opt->maximize = 0;
+        opt->fb = NULL;
+        opt->fb_data = NULL;
         opt->munge_on_destroy = opt->munge_on_copy = NULL;
 
         opt->lb = opt->ub = NULL;
@@ -98,15 +100,27 @@ nlopt_opt NLOPT_STDCALL nlopt_create(nlopt_algorithm algorithm, unsigned n)
         opt->xtol_abs = NULL;
         opt->maxeval = 0;
         opt->numevals = 0;
+        opt->dual_numevals = 0;
+        opt->cache_hits = opt->cache_misses = 0;
+        memset(&opt->profile, 0, sizeof(opt->profile));
         opt->maxtime = 0;
+        opt->stall_window = 0;
+        opt->stall_rel = 0;
         opt->force_stop = 0;
         opt->force_stop_child = NULL;
+        opt->trace = NULL;
+        opt->trace_data = NULL;
+        opt->trace_inherited = 0;
 
         opt->local_opt = NULL;
         opt->stochastic_population = 0;
         opt->vector_storage = 0;
         opt->dx = NULL;
+        opt->seeded = 0;
+        opt->seed = 0;
+        opt->stream = 0;
         opt->work = NULL;
+        opt->work_size = 0;
         opt->errmsg = NULL;
 
         if (n > 0) {
@@ -142,6 +156,7 @@ nlopt_opt NLOPT_STDCALL nlopt_copy(const nlopt_opt opt)
         nopt->local_opt = NULL;
         nopt->dx = NULL;
         nopt->work = NULL;
+        nopt->work_size = 0;
         nopt->errmsg = NULL;
         nopt->force_stop_child = NULL;
         nopt->params = NULL;
@@ -363,6 +378,17 @@ nlopt_result NLOPT_STDCALL nlopt_set_max_objective(nlopt_opt opt, nlopt_func f,
     return nlopt_set_precond_max_objective(opt, f, NULL, f_data);
 }
 
+nlopt_result NLOPT_STDCALL nlopt_set_batch_objective(nlopt_opt opt, nlopt_batch_func fb, void *fb_data)
+{
+    if (opt) {
+        nlopt_unset_errmsg(opt);
+        opt->fb = fb;
+        opt->fb_data = fb_data;
+        return NLOPT_SUCCESS;
+    }
+    return NLOPT_INVALID_ARGS;
+}
+
 /*************************************************************************/
 
 nlopt_result NLOPT_STDCALL nlopt_set_lower_bounds(nlopt_opt opt, const double *lb)
@@ -794,8 +820,53 @@ nlopt_result NLOPT_STDCALL nlopt_get_x_weights(const nlopt_opt opt, double *x_we
 GETSET(maxeval, int, maxeval)
 
     GET(numevals, int, numevals)
+    GET(dual_numevals, int, dual_numevals)
+    GET(cache_hits, int, cache_hits)
+    GET(cache_misses, int, cache_misses)
+    GET(workspace_size, size_t, work_size)
+
+double NLOPT_STDCALL nlopt_get_phase_time(const nlopt_opt opt, int phase)
+{
+#ifdef NLOPT_PROFILE
+    if (opt && phase >= 0 && phase < NLOPT_NUM_PHASES)
+        return opt->profile.time[phase];
+#else
+    (void) opt;
+    (void) phase;
+#endif
+    return 0;
+}
+
+unsigned long NLOPT_STDCALL nlopt_get_phase_count(const nlopt_opt opt, int phase)
+{
+#ifdef NLOPT_PROFILE
+    if (opt && phase >= 0 && phase < NLOPT_NUM_PHASES)
+        return opt->profile.count[phase];
+#else
+    (void) opt;
+    (void) phase;
+#endif
+    return 0;
+}
+
  GETSET(maxtime, double, maxtime)
 
+nlopt_result NLOPT_STDCALL nlopt_set_stall(nlopt_opt opt, int window, double rel_improvement)
+{
+    if (opt) {
+        nlopt_unset_errmsg(opt);
+        if (window < 0 || !(rel_improvement >= 0))
+            return ERR(NLOPT_INVALID_ARGS, opt, "invalid stall window or improvement");
+        opt->stall_window = window;
+        opt->stall_rel = rel_improvement;
+        return NLOPT_SUCCESS;
+    }
+    return NLOPT_INVALID_ARGS;
+}
+
+GET(stall_window, int, stall_window)
+GET(stall_improvement, double, stall_rel)
+
 /*************************************************************************/
 nlopt_result NLOPT_STDCALL nlopt_set_force_stop(nlopt_opt opt, int force_stop)
 {
@@ -815,6 +886,18 @@ nlopt_result NLOPT_STDCALL nlopt_force_stop(nlopt_opt opt)
     return nlopt_set_force_stop(opt, 1);
 }
 
+nlopt_result NLOPT_STDCALL nlopt_set_trace_func(nlopt_opt opt, nlopt_trace_func trace, void *trace_data)
+{
+    if (opt) {
+        nlopt_unset_errmsg(opt);
+        opt->trace = trace;
+        opt->trace_data = trace_data;
+        opt->trace_inherited = 0;
+        return NLOPT_SUCCESS;
+    }
+    return NLOPT_INVALID_ARGS;
+}
+
 /*************************************************************************/
 
 GET(algorithm, nlopt_algorithm, algorithm)
@@ -850,6 +933,28 @@ GET(algorithm, nlopt_algorithm, algorithm)
 GETSET(population, unsigned, stochastic_population)
     GETSET(vector_storage, unsigned, vector_storage)
 
+nlopt_result NLOPT_STDCALL nlopt_set_seed(nlopt_opt opt, unsigned long seed, unsigned stream)
+{
+    if (opt) {
+        nlopt_unset_errmsg(opt);
+        opt->seeded = 1;
+        opt->seed = seed;
+        opt->stream = stream;
+        return NLOPT_SUCCESS;
+    }
+    return NLOPT_INVALID_ARGS;
+}
+
+nlopt_result NLOPT_STDCALL nlopt_unset_seed(nlopt_opt opt)
+{
+    if (opt) {
+        nlopt_unset_errmsg(opt);
+        opt->seeded = 0;
+        return NLOPT_SUCCESS;
+    }
+    return NLOPT_INVALID_ARGS;
+}
+
 /*************************************************************************/
 nlopt_result NLOPT_STDCALL nlopt_set_initial_step1(nlopt_opt opt, double dx)
 {
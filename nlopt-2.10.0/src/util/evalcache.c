@@ -0,0 +1,209 @@
+/* Copyright (c) 2007-2014 Massachusetts Institute of Technology
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "nlopt-util.h"
+
+/* Bounded cache of function evaluations, keyed on (function id, x).
+
+   x is turned into a key of n 64-bit words: either the bit pattern of
+   each x[i] (exact matching, tol == 0) or floor(x[i]/tol + 0.5)
+   (quantized matching).  Entries live in a flat arena of "capacity"
+   slots that is reused round-robin, so the oldest entry is evicted
+   once the cache is full; a chained hash table over the slots gives
+   O(1) lookups.  Each slot has room for maxm function values and their
+   gradients (maxm*n), so one cache serves the objective and all of the
+   (vector-valued) constraints. */
+
+typedef unsigned long long key_t_;
+
+struct nlopt_evalcache_s {
+    unsigned n, maxm;
+    double tol;
+    unsigned capacity, nused, next;     /* slots in use / next to (re)use */
+    unsigned nbuckets;          /* power of 2 */
+    int *buckets;               /* head slot of each chain, -1 if empty */
+    int *chain;                 /* next slot in the same chain, length capacity */
+    int *fid;                   /* function id of each slot */
+    unsigned *hash;             /* hash of each slot */
+    unsigned char *has_grad;    /* whether the slot has gradients stored */
+    key_t_ *keys;               /* capacity * n */
+    double *vals;               /* capacity * maxm * (n + 1): values, then gradients */
+    key_t_ *scratch;            /* key of the current lookup, length n */
+    int hits, misses;
+};
+
+nlopt_evalcache *nlopt_evalcache_create(unsigned n, unsigned maxm, unsigned capacity, double tol)
+{
+    nlopt_evalcache *c;
+    unsigned i;
+
+    if (capacity == 0 || maxm == 0)
+        return NULL;
+    c = (nlopt_evalcache *) calloc(1, sizeof(nlopt_evalcache));
+    if (!c)
+        return NULL;
+    c->n = n;
+    c->maxm = maxm;
+    c->tol = tol > 0 ? tol : 0;
+    c->capacity = capacity;
+    for (c->nbuckets = 16; c->nbuckets < 2 * capacity && c->nbuckets < (1U << 30); c->nbuckets *= 2);
+    c->buckets = (int *) malloc(sizeof(int) * c->nbuckets);
+    c->chain = (int *) malloc(sizeof(int) * capacity);
+    c->fid = (int *) malloc(sizeof(int) * capacity);
+    c->hash = (unsigned *) malloc(sizeof(unsigned) * capacity);
+    c->has_grad = (unsigned char *) malloc(capacity);
+    c->keys = (key_t_ *) malloc(sizeof(key_t_) * ((size_t) capacity * n + n + 1));
+    c->vals = (double *) malloc(sizeof(double) * (size_t) capacity * maxm * (n + 1));
+    if (!c->buckets || !c->chain || !c->fid || !c->hash || !c->has_grad || !c->keys || !c->vals) {
+        nlopt_evalcache_destroy(c);
+        return NULL;
+    }
+    c->scratch = c->keys + (size_t) capacity * n;
+    for (i = 0; i < c->nbuckets; ++i)
+        c->buckets[i] = -1;
+    return c;
+}
+
+void nlopt_evalcache_destroy(nlopt_evalcache * c)
+{
+    if (c) {
+        free(c->buckets);
+        free(c->chain);
+        free(c->fid);
+        free(c->hash);
+        free(c->has_grad);
+        free(c->keys);
+        free(c->vals);
+        free(c);
+    }
+}
+
+void nlopt_evalcache_stats(const nlopt_evalcache * c, int *hits, int *misses)
+{
+    *hits = c ? c->hits : 0;
+    *misses = c ? c->misses : 0;
+}
+
+/* compute c->scratch from x and return its hash */
+static unsigned make_key(nlopt_evalcache * c, int fid, const double *x)
+{
+    unsigned i, n = c->n;
+    key_t_ h = 0x9e3779b97f4a7c15ULL ^ (key_t_) (unsigned) fid;
+    for (i = 0; i < n; ++i) {
+        key_t_ k;
+        if (c->tol > 0) {
+            double q = floor(x[i] / c->tol + 0.5);
+            k = (key_t_) (long long) (q > 9e18 ? 9e18 : (q < -9e18 ? -9e18 : q));
+        } else {
+            double xi = x[i] == 0 ? 0.0 : x[i];        /* -0 == +0 */
+            memcpy(&k, &xi, sizeof(k));
+        }
+        c->scratch[i] = k;
+        /* splitmix64-style mixing */
+        h ^= k + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    }
+    return (unsigned) (h ^ (h >> 31) ^ (h >> 32));
+}
+
+static int find_slot(const nlopt_evalcache * c, int fid, unsigned hash)
+{
+    int s;
+    for (s = c->buckets[hash & (c->nbuckets - 1)]; s >= 0; s = c->chain[s])
+        if (c->hash[s] == hash && c->fid[s] == fid && !memcmp(c->keys + (size_t) s * c->n, c->scratch, sizeof(key_t_) * c->n))
+            return s;
+    return -1;
+}
+
+/* Look up the m values (and, if grad != NULL, the m*n gradient) of
+   function fid at x.  Returns nonzero on a hit, in which case result
+   and grad have been filled in. */
+int nlopt_evalcache_get(nlopt_evalcache * c, int fid, unsigned m, const double *x, double *result, double *grad)
+{
+    int hit = 0;
+#ifdef _OPENMP
+#pragma omp critical (nlopt_evalcache)
+#endif
+    {
+        unsigned n = c->n;
+        int s = m <= c->maxm ? find_slot(c, fid, make_key(c, fid, x)) : -1;
+        if (s >= 0 && (!grad || c->has_grad[s])) {
+            const double *v = c->vals + (size_t) s *c->maxm * (n + 1);
+            memcpy(result, v, sizeof(double) * m);
+            if (grad)
+                memcpy(grad, v + c->maxm, sizeof(double) * m * n);
+            hit = 1;
+            ++c->hits;
+        } else
+            ++c->misses;
+    }
+    return hit;
+}
+
+static void unlink_slot(nlopt_evalcache * c, int s)
+{
+    int *p = c->buckets + (c->hash[s] & (c->nbuckets - 1));
+    while (*p != s)
+        p = c->chain + *p;
+    *p = c->chain[s];
+}
+
+/* Store the values (and gradient, if grad != NULL) of function fid at x,
+   evicting the oldest entry if the cache is full. */
+void nlopt_evalcache_put(nlopt_evalcache * c, int fid, unsigned m, const double *x, const double *result, const double *grad)
+{
+    if (m > c->maxm)
+        return;
+#ifdef _OPENMP
+#pragma omp critical (nlopt_evalcache)
+#endif
+    {
+        unsigned n = c->n;
+        unsigned hash = make_key(c, fid, x);
+        int s = find_slot(c, fid, hash);
+        double *v;
+        if (s < 0) {
+            s = (int) c->next;
+            c->next = (c->next + 1) % c->capacity;
+            if (c->nused < c->capacity)
+                ++c->nused;
+            else
+                unlink_slot(c, s);
+            c->fid[s] = fid;
+            c->hash[s] = hash;
+            memcpy(c->keys + (size_t) s * n, c->scratch, sizeof(key_t_) * n);
+            c->chain[s] = c->buckets[hash & (c->nbuckets - 1)];
+            c->buckets[hash & (c->nbuckets - 1)] = s;
+            c->has_grad[s] = 0;
+        }
+        v = c->vals + (size_t) s *c->maxm * (n + 1);
+        memcpy(v, result, sizeof(double) * m);
+        if (grad) {
+            memcpy(v + c->maxm, grad, sizeof(double) * m * n);
+            c->has_grad[s] = 1;
+        }
+    }
+}
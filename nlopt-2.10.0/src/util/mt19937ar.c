@@ -198,16 +198,103 @@ static double nlopt_genrand_res53(void)
 }
 /* These real versions are due to Isaku Wada, 2002/01/09 added */
 
+/* Independent streams, added for per-optimizer seeding: xoshiro256**
+   (Blackman & Vigna, 2018), whose jump functions advance a state by 2^128
+   or 2^192 steps so that streams split from one seed never overlap.  While
+   nlopt_rng_use has installed a stream on this thread, all of the functions
+   below draw from it instead of the global Mersenne twister. */
+
+static THREADLOCAL nlopt_rng *cur_rng = NULL;
+
+static unsigned long long rotl64(unsigned long long x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+static unsigned long long rng_next(nlopt_rng *r)
+{
+    unsigned long long *s = r->s;
+    unsigned long long result = rotl64(s[1] * 5, 7) * 9;
+    unsigned long long t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl64(s[3], 45);
+    return result;
+}
+
+static const unsigned long long rng_jump_poly[4] = {
+    0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+    0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+};
+static const unsigned long long rng_long_jump_poly[4] = {
+    0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL,
+    0x77710069854ee241ULL, 0x39109bb02acbe635ULL
+};
+
+static void rng_jump(nlopt_rng *r, const unsigned long long *poly)
+{
+    unsigned long long t[4] = { 0, 0, 0, 0 };
+    int i, b;
+    for (i = 0; i < 4; ++i)
+        for (b = 0; b < 64; ++b) {
+            if (poly[i] & (1ULL << b)) {
+                t[0] ^= r->s[0];
+                t[1] ^= r->s[1];
+                t[2] ^= r->s[2];
+                t[3] ^= r->s[3];
+            }
+            rng_next(r);
+        }
+    for (i = 0; i < 4; ++i)
+        r->s[i] = t[i];
+}
+
+/* state for stream number stream of seed: the seed is expanded by
+   splitmix64, then stream = 65536*a + b takes a long jumps and b jumps */
+void nlopt_rng_seed(nlopt_rng *r, unsigned long seed, unsigned stream)
+{
+    unsigned long long z = seed;
+    unsigned i;
+    for (i = 0; i < 4; ++i) {
+        unsigned long long x = (z += 0x9e3779b97f4a7c15ULL);
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        r->s[i] = x ^ (x >> 31);
+    }
+    for (i = 0; i < (stream >> 16); ++i)
+        rng_jump(r, rng_long_jump_poly);
+    for (i = 0; i < (stream & 0xffff); ++i)
+        rng_jump(r, rng_jump_poly);
+}
+
+/* draw from r on this thread (NULL for the global generator); returns the
+   stream that was in use, to be restored afterwards */
+nlopt_rng *nlopt_rng_use(nlopt_rng *r)
+{
+    nlopt_rng *prev = cur_rng;
+    cur_rng = r;
+    return prev;
+}
+
+/* [0,1) with 53-bit resolution, from r or the global generator */
+#define RES53(r) ((r) ? (double) (rng_next(r) >> 11) * (1.0/9007199254740992.0) \
+                      : nlopt_genrand_res53())
+
 /* generate uniform random number in [a,b) with 53-bit resolution,
    added by SGJ */
 double nlopt_urand(double a, double b)
 {
-     return(a + (b - a) * nlopt_genrand_res53());
+     return(a + (b - a) * RES53(cur_rng));
 }
 
 /* generate a uniform random number in [0,n), added by SGJ */
 int nlopt_iurand(int n)
 {
+     if (cur_rng)
+          return (int) ((rng_next(cur_rng) >> 32) % (unsigned) n);
      return(nlopt_genrand_int32() % n);
 }
 
@@ -230,3 +317,73 @@ double nlopt_nrand(double mean, double stddev)
     return mean + v1 * sqrt(-2 * log(s) / s) * stddev;
   }
 }
+
+/* Bulk versions for generating populations.  They work on a local copy of
+   the stream so that its state can stay in registers. */
+
+/* x[k*n + j] uniform in [lb[j], ub[j]) for k < count, j < n: the same
+   numbers as the equivalent nlopt_urand calls in row-major order */
+void nlopt_urand_fill(unsigned count, unsigned n, double *x, const double *lb, const double *ub)
+{
+    nlopt_rng s, *r = NULL;
+    unsigned k, j;
+    if (cur_rng) {
+        s = *cur_rng;
+        r = &s;
+    }
+    for (k = 0; k < count; ++k, x += n)
+        for (j = 0; j < n; ++j)
+            x[j] = lb[j] + (ub[j] - lb[j]) * RES53(r);
+    if (r)
+        *cur_rng = s;
+}
+
+/* x[0..count-1] uniform in [0,1) */
+void nlopt_urand01_fill(unsigned count, double *x)
+{
+    nlopt_rng s;
+    unsigned i;
+    if (cur_rng) {
+        s = *cur_rng;
+        for (i = 0; i < count; ++i)
+            x[i] = (double) (rng_next(&s) >> 11) * (1.0/9007199254740992.0);
+        *cur_rng = s;
+    }
+    else
+        for (i = 0; i < count; ++i)
+            x[i] = nlopt_genrand_res53();
+}
+
+#define TWO_PI 6.28318530717958647692
+
+/* x[0..count-1] normal with the given mean and std. deviation, by the
+   Box-Muller transform: the uniforms are drawn first, the first half of x
+   holding the radii and the second half the angles, so that the transform
+   is a branch-free loop over contiguous arrays */
+void nlopt_nrand_fill(unsigned count, double *x, double mean, double stddev)
+{
+    unsigned i, h = count / 2;
+    double *t = x + h;
+    nlopt_urand01_fill(2 * h, x);
+    for (i = 0; i < h; ++i) {
+        double r = stddev * sqrt(-2 * log(1 - x[i])), a = TWO_PI * t[i];
+        x[i] = mean + r * cos(a);
+        t[i] = mean + r * sin(a);
+    }
+    if (count & 1)
+        x[count - 1] = nlopt_nrand(mean, stddev);
+}
+
+/* x[0..count-1] Cauchy with the given location and scale, truncated to
+   [lo, hi] (which may be infinite); sampled by inverting the distribution
+   function, so the truncation costs no rejections */
+void nlopt_crand_fill(unsigned count, double *x, double loc, double scale, double lo, double hi)
+{
+    double alo = atan((lo - loc) / scale), ahi = atan((hi - loc) / scale);
+    unsigned i;
+    nlopt_urand01_fill(count, x);
+    for (i = 0; i < count; ++i) {
+        double c = loc + scale * tan(alo + (ahi - alo) * x[i]);
+        x[i] = c < lo ? lo : (c > hi ? hi : c); /* guard against roundoff */
+    }
+}
@@ -57,7 +57,7 @@ extern "C" {
 /* re-entrant qsort, uses the BSD convention */
     extern void nlopt_qsort_r(void *base_, size_t nmemb, size_t size, void *thunk, int (*compar) (void *, const void *, const void *));
 
-/* seconds timer */
+/* seconds timer (monotonic where possible) */
     extern double nlopt_seconds(void);
     extern unsigned long nlopt_time_seed(void);
 
@@ -66,14 +66,68 @@ extern "C" {
     extern double nlopt_urand(double a, double b);
     extern int nlopt_iurand(int n);
     extern double nlopt_nrand(double mean, double stddev);
+    extern void nlopt_urand_fill(unsigned count, unsigned n, double *x, const double *lb, const double *ub);
+    extern void nlopt_urand01_fill(unsigned count, double *x);
+    extern void nlopt_nrand_fill(unsigned count, double *x, double mean, double stddev);
+    extern void nlopt_crand_fill(unsigned count, double *x, double loc, double scale, double lo, double hi);
 
-/* Sobol' low-discrepancy-sequence generation */
+/* independent jumpable streams (xoshiro256**), e.g. one per nlopt_opt */
+    typedef struct {
+        unsigned long long s[4];
+    } nlopt_rng;
+    extern void nlopt_rng_seed(nlopt_rng *r, unsigned long seed, unsigned stream);
+    extern nlopt_rng *nlopt_rng_use(nlopt_rng *r);
+
+/* Sobol' low-discrepancy-sequence generation, in up to
+   NLOPT_SOBOL_MAXDIM dimensions */
+#define NLOPT_SOBOL_MAXDIM 21201
     typedef struct nlopt_soboldata_s *nlopt_sobol;
     extern nlopt_sobol nlopt_sobol_create(unsigned sdim);
     extern void nlopt_sobol_destroy(nlopt_sobol s);
     extern void nlopt_sobol_next01(nlopt_sobol s, double *x);
     extern void nlopt_sobol_next(nlopt_sobol s, double *x, const double *lb, const double *ub);
+    extern void nlopt_sobol_fill01(nlopt_sobol s, unsigned count, double *x);
     extern void nlopt_sobol_skip(nlopt_sobol s, unsigned n, double *x);
+    extern void nlopt_sobol_seek(nlopt_sobol s, unsigned n);
+
+/* per-phase profiler (compiled in only with -DNLOPT_PROFILE): accumulated
+   wall-clock time and call counts of the inner kernels algorithms spend
+   their non-evaluation time in, tagged with NLOPT_PHASE_START/STOP */
+    typedef enum {
+        NLOPT_PHASE_QP,         /* SLSQP least-squares QP subproblem */
+        NLOPT_PHASE_DUAL,       /* MMA/CCSAQ dual subproblem */
+        NLOPT_PHASE_HULL,       /* DIRECT convex hull of the rectangles */
+        NLOPT_PHASE_DISTANCE,   /* MLSL nearest-neighbour distance scans */
+        NLOPT_PHASE_SORT,       /* ISRES/ESCH population ranking */
+        NLOPT_NUM_PHASES
+    } nlopt_phase;
+    typedef struct {
+        double time[NLOPT_NUM_PHASES];
+        unsigned long count[NLOPT_NUM_PHASES];
+    } nlopt_profile;
+#ifdef NLOPT_PROFILE
+#  define NLOPT_PHASE_START(stop) ((stop)->profile ? nlopt_seconds() : 0.0)
+#  define NLOPT_PHASE_STOP(stop, phase, t0) do { \
+        if ((stop)->profile) { \
+            (stop)->profile->time[phase] += nlopt_seconds() - (t0); \
+            ++(stop)->profile->count[phase]; \
+        } \
+    } while (0)
+#else
+#  define NLOPT_PHASE_START(stop) 0.0
+#  define NLOPT_PHASE_STOP(stop, phase, t0) ((void) (t0))
+#endif
+
+/* state of the amortized maxtime check: nlopt_stop_time reads the clock
+   only on every stride-th call, adapting stride so that reads are about
+   NLOPT_TIME_CHECK_INTERVAL seconds apart; the stride is capped because a
+   function that suddenly gets slower can overshoot by a whole stride */
+#define NLOPT_TIME_CHECK_INTERVAL 1e-3
+#define NLOPT_TIME_CHECK_MAX_STRIDE 16
+    typedef struct {
+        unsigned countdown, stride;
+        double last;            /* time of the last read */
+    } nlopt_time_check;
 
 /* stopping criteria */
     typedef struct {
@@ -86,8 +140,15 @@ extern "C" {
         const double *x_weights;
         int *nevals_p, maxeval;
         double maxtime, start;
+        nlopt_time_check *time_check;   /* or NULL to read the clock on every check */
         int *force_stop;
         char **stop_msg;        /* pointer to msg string to update */
+        nlopt_profile *profile; /* phase timings, or NULL (always without NLOPT_PROFILE) */
+        nlopt_trace_func trace; /* timeline hook, or NULL */
+        void *trace_data;
+        nlopt_algorithm algorithm;
+        nlopt_batch_func batch; /* batch objective, or NULL */
+        void *batch_data;
     } nlopt_stopping;
     extern int nlopt_stop_f(const nlopt_stopping * stop, double f, double oldf);
     extern int nlopt_stop_ftol(const nlopt_stopping * stop, double f, double oldf);
@@ -99,6 +160,8 @@ extern "C" {
     extern int nlopt_stop_time(const nlopt_stopping * stop);
     extern int nlopt_stop_evalstime(const nlopt_stopping * stop);
     extern int nlopt_stop_forced(const nlopt_stopping * stop);
+    extern void nlopt_stop_iteration(const nlopt_stopping * stop);
+    extern unsigned nlopt_eval_batch(const nlopt_stopping * stop, unsigned count, unsigned n, const double *x, double *f);
 
 /* like vsprintf, but reallocs p to whatever size is needed */
     extern char *nlopt_vsprintf(char *p, const char *format, va_list ap);
@@ -128,6 +191,7 @@ extern "C" {
     extern unsigned nlopt_count_constraints(unsigned p, const nlopt_constraint * c);
     extern unsigned nlopt_max_constraint_dim(unsigned p, const nlopt_constraint * c);
     extern void nlopt_eval_constraint(double *result, double *grad, const nlopt_constraint * c, unsigned n, const double *x);
+    extern double nlopt_eval_objective_constraints(nlopt_stopping * stop, unsigned nthreads, const unsigned *offset, nlopt_func f, void *f_data, unsigned p, const nlopt_constraint * c, unsigned n, const double *x, double *grad, double *cval, double *cgrad);
 
 /* rescale.c: */
     double *nlopt_compute_rescaling(unsigned n, const double *dx);
@@ -136,6 +200,14 @@ extern "C" {
     void nlopt_unscale(unsigned n, const double *s, const double *x, double *xs);
     void nlopt_reorder_bounds(unsigned n, double *lb, double *ub);
 
+/* evalcache.c: */
+    typedef struct nlopt_evalcache_s nlopt_evalcache;
+    extern nlopt_evalcache *nlopt_evalcache_create(unsigned n, unsigned maxm, unsigned capacity, double tol);
+    extern void nlopt_evalcache_destroy(nlopt_evalcache * c);
+    extern int nlopt_evalcache_get(nlopt_evalcache * c, int fid, unsigned m, const double *x, double *result, double *grad);
+    extern void nlopt_evalcache_put(nlopt_evalcache * c, int fid, unsigned m, const double *x, const double *result, const double *grad);
+    extern void nlopt_evalcache_stats(const nlopt_evalcache * c, int *hits, int *misses);
+
 #ifdef __cplusplus
 }                               /* extern "C" */
 #endif                          /* __cplusplus */
@@ -20,7 +20,7 @@
  * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE. 
  */
 
-/* Generation of Sobol sequences in up to 1111 dimensions, based on the
+/* Generation of Sobol sequences in up to 21201 dimensions, based on the
    algorithms described in:
         P. Bratley and B. L. Fox, Algorithm 659, ACM Trans.
 	Math. Soft. 14 (1), 88-100 (1988),
@@ -44,9 +44,13 @@
    This is not to say that the authors above should not be credited for
    their clear description of the algorithm (and their tabulation of
    the critical numbers).  Please cite them.  Just that I needed
-   a free/open-source implementation. */
+   a free/open-source implementation.
+
+   Dimensions beyond 1111 use the direction numbers of Joe and Kuo's
+   later table of 21201 dimensions (see sobolextdata.h).  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #include "nlopt-util.h"
@@ -68,9 +72,10 @@ typedef unsigned int uint32_t;
 typedef struct nlopt_soboldata_s {
     unsigned sdim;              /* dimension of sequence being generated */
     uint32_t *mdata;            /* array of length 32 * sdim */
-    uint32_t *m[32];            /* more convenient pointers to mdata, of direction #s */
-    uint32_t *x;                /* previous x = x_n, array of length sdim */
-    unsigned *b;                /* position of fixed point in x[i] is after bit b[i] */
+    uint32_t *v[32];            /* more convenient pointers to mdata, of direction #s
+                                   m[j] scaled to 32-bit fixed point: v[j] = m[j] << (31 - j) */
+    uint32_t *x;                /* previous x = x_n, array of length sdim, as a
+                                   32-bit fixed-point fraction */
     uint32_t n;                 /* number of x's generated so far */
 } soboldata;
 
@@ -108,35 +113,53 @@ static unsigned rightzero32(uint32_t n)
    (if too many #'s generated) */
 static int sobol_gen(soboldata * sd, double *x)
 {
-    unsigned c, b, i, sdim;
+    unsigned i, sdim;
+    const uint32_t *v;
+    uint32_t *sx;
 
     if (sd->n == 4294967295U)
         return 0;               /* n == 2^32 - 1 ... we would
                                    need to switch to a 64-bit version
                                    to generate more terms. */
-    c = rightzero32(sd->n++);
+    /* x_{n+1} differs from x_n (in Gray-code order) by direction number c */
+    v = sd->v[rightzero32(sd->n++)];
+    sx = sd->x;
     sdim = sd->sdim;
     for (i = 0; i < sdim; ++i) {
-        b = sd->b[i];
-        if (b >= c) {
-            sd->x[i] ^= sd->m[c][i] << (b - c);
-            x[i] = ((double) (sd->x[i])) / (1U << (b + 1));
-        } else {
-            sd->x[i] = (sd->x[i] << (c - b)) ^ sd->m[c][i];
-            sd->b[i] = c;
-            x[i] = ((double) (sd->x[i])) / (1U << (c + 1));
-        }
+        sx[i] ^= v[i];
+        x[i] = sx[i] * (1.0 / 4294967296.0);
     }
     return 1;
 }
 
+/* set x_n directly, for any n, in O(sdim log n) time: x_n is the xor of the
+   direction numbers v[j] for the bits j of the Gray code of n */
+static void sobol_seek(soboldata * sd, uint32_t n)
+{
+    uint32_t g = n ^ (n >> 1);
+    unsigned i, j, sdim = sd->sdim;
+
+    memset(sd->x, 0, sizeof(uint32_t) * sdim);
+    for (j = 0; g; ++j, g >>= 1)
+        if (g & 1) {
+            const uint32_t *v = sd->v[j];
+            for (i = 0; i < sdim; ++i)
+                sd->x[i] ^= v[i];
+        }
+    sd->n = n;
+}
+
 #include "soboldata.h"
+#include "sobolextdata.h"
 
 static int sobol_init(soboldata * sd, unsigned sdim)
 {
     unsigned i, j;
+    const uint32_t *ext = sobol_ext_minit; /* next starting values in the
+                                              extended table */
+    uint32_t *m[32];
 
-    if (!sdim || sdim > MAXDIM)
+    if (!sdim || sdim > NLOPT_SOBOL_MAXDIM)
         return 0;
 
     sd->mdata = (uint32_t *) malloc(sizeof(uint32_t) * (sdim * 32));
@@ -144,11 +167,11 @@ static int sobol_init(soboldata * sd, unsigned sdim)
         return 0;
 
     for (j = 0; j < 32; ++j) {
-        sd->m[j] = sd->mdata + j * sdim;
-        sd->m[j][0] = 1;        /* special-case Sobol sequence */
+        m[j] = sd->v[j] = sd->mdata + j * sdim;
+        m[j][0] = 1;            /* special-case Sobol sequence */
     }
     for (i = 1; i < sdim; ++i) {
-        uint32_t a = sobol_a[i - 1];
+        uint32_t a = i < MAXDIM ? sobol_a[i - 1] : sobol_ext_a[i - MAXDIM];
         unsigned d = 0, k;
 
         while (a) {
@@ -159,37 +182,29 @@ static int sobol_init(soboldata * sd, unsigned sdim)
 
         /* set initial values of m from table */
         for (j = 0; j < d; ++j)
-            sd->m[j][i] = sobol_minit[j][i - 1];
+            m[j][i] = i < MAXDIM ? sobol_minit[j][i - 1] : *ext++;
 
         /* fill in remaining values using recurrence */
         for (j = d; j < 32; ++j) {
-            a = sobol_a[i - 1];
-            sd->m[j][i] = sd->m[j - d][i];
+            a = i < MAXDIM ? sobol_a[i - 1] : sobol_ext_a[i - MAXDIM];
+            m[j][i] = m[j - d][i];
             for (k = 0; k < d; ++k) {
-                sd->m[j][i] ^= ((a & 1) * sd->m[j - d + k][i]) << (d - k);
+                m[j][i] ^= ((a & 1) * m[j - d + k][i]) << (d - k);
                 a >>= 1;
             }
         }
     }
+    /* m[j] < 2^(j+1), so m[j] / 2^(j+1) is the 32-bit fraction m[j] << (31 - j) */
+    for (j = 0; j < 32; ++j)
+        for (i = 0; i < sdim; ++i)
+            sd->v[j][i] = m[j][i] << (31 - j);
 
-    sd->x = (uint32_t *) malloc(sizeof(uint32_t) * sdim);
+    sd->x = (uint32_t *) calloc(sdim, sizeof(uint32_t));
     if (!sd->x) {
         free(sd->mdata);
         return 0;
     }
 
-    sd->b = (unsigned *) malloc(sizeof(unsigned) * sdim);
-    if (!sd->b) {
-        free(sd->x);
-        free(sd->mdata);
-        return 0;
-    }
-
-    for (i = 0; i < sdim; ++i) {
-        sd->x[i] = 0;
-        sd->b[i] = 0;
-    }
-
     sd->n = 0;
     sd->sdim = sdim;
 
@@ -200,7 +215,6 @@ static void sobol_destroy(soboldata * sd)
 {
     free(sd->mdata);
     free(sd->x);
-    free(sd->b);
 }
 
 /************************************************************************/
@@ -248,17 +262,53 @@ void nlopt_sobol_next(nlopt_sobol s, double *x, const double *lb, const double *
         x[i] = lb[i] + (ub[i] - lb[i]) * x[i];
 }
 
+/* the next count vectors of the Sobol sequence, into the rows of the
+   count x sdim array x (each x[i] in (0,1)): the same as count calls of
+   nlopt_sobol_next01, but with a loop over each row that the compiler can
+   vectorize */
+void nlopt_sobol_fill01(nlopt_sobol s, unsigned count, double *x)
+{
+    unsigned k, i, sdim = s->sdim;
+    uint32_t *sx = s->x;
+
+    for (k = 0; k < count; ++k, x += sdim) {
+        const uint32_t *v;
+        if (s->n == 4294967295U) {
+            nlopt_sobol_next01(s, x);
+            continue;
+        }
+        v = s->v[rightzero32(s->n++)];
+        for (i = 0; i < sdim; ++i) {
+            sx[i] ^= v[i];
+            x[i] = sx[i] * (1.0 / 4294967296.0);
+        }
+    }
+}
+
 /* if we know in advance how many points (n) we want to compute, then
    adopt the suggestion of the Joe and Kuo paper, which in turn
    is taken from Acworth et al (1998), of skipping a number of
-   points equal to the largest power of 2 smaller than n */
+   points equal to the largest power of 2 smaller than n; x is set to
+   the last point skipped */
 void nlopt_sobol_skip(nlopt_sobol s, unsigned n, double *x)
 {
     if (s) {
-        unsigned k = 1;
+        unsigned k = 1, i;
         while (k * 2 < n)
             k *= 2;
-        while (k-- > 0)
-            sobol_gen(s, x);
+        if (k > 4294967295U - s->n)
+            k = 4294967295U - s->n;
+        sobol_seek(s, s->n + k);
+        for (i = 0; i < s->sdim; ++i)
+            x[i] = s->x[i] * (1.0 / 4294967296.0);
     }
 }
+
+/* continue the sequence after its first n points, as if they had been
+   generated, in O(sdim log n) time: e.g. to split it among several
+   threads, each with its own nlopt_sobol */
+void nlopt_sobol_seek(nlopt_sobol s, unsigned n)
+{
+    if (s)
+        sobol_seek(s, n);
+}
@@ -26,8 +26,6 @@
 #include <time.h>
 #include "nlopt-util.h"
 
-#define MAXDIM 1111
-
 /* test integrand from Joe and Kuo paper ... integrates to 1 */
 static double testfunc(unsigned n, const double *x)
 {
@@ -43,7 +41,7 @@ static double testfunc(unsigned n, const double *x)
 int main(int argc, char **argv)
 {
     unsigned n, j, i, sdim;
-    static double x[MAXDIM];
+    static double x[NLOPT_SOBOL_MAXDIM];
     double testint_sobol = 0, testint_rand = 0;
     nlopt_sobol s;
     if (argc < 3) {
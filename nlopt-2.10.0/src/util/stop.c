@@ -143,9 +143,36 @@ int nlopt_stop_time_(double start, double maxtime)
     return (maxtime > 0 && nlopt_seconds() - start >= maxtime);
 }
 
+/* Called after nearly every evaluation, where reading the clock can cost
+   as much as a cheap objective, so with a time_check only every stride-th
+   call reads it.  The stride doubles while reads come less than half an
+   interval apart and drops back to 1 as soon as one takes longer than
+   the interval, so maxtime is overshot by roughly one interval, or by
+   NLOPT_TIME_CHECK_MAX_STRIDE evaluations if they suddenly get slower. */
 int nlopt_stop_time(const nlopt_stopping * s)
 {
-    return nlopt_stop_time_(s->start, s->maxtime);
+    nlopt_time_check *tc = s->time_check;
+    double t, interval;
+
+    if (s->maxtime <= 0)
+        return 0;
+    if (!tc)
+        return nlopt_stop_time_(s->start, s->maxtime);
+    if (--tc->countdown > 0)
+        return 0;
+    t = nlopt_seconds();
+    if (t - s->start >= s->maxtime) {
+        tc->countdown = 1;      /* keep answering yes */
+        return 1;
+    }
+    interval = 0.01 * s->maxtime < NLOPT_TIME_CHECK_INTERVAL ? 0.01 * s->maxtime : NLOPT_TIME_CHECK_INTERVAL;
+    if (t - tc->last > interval)
+        tc->stride = 1;
+    else if (t - tc->last < 0.5 * interval && tc->stride < NLOPT_TIME_CHECK_MAX_STRIDE)
+        tc->stride *= 2;
+    tc->countdown = tc->stride;
+    tc->last = t;
+    return 0;
 }
 
 int nlopt_stop_evalstime(const nlopt_stopping * stop)
@@ -158,6 +185,35 @@ int nlopt_stop_forced(const nlopt_stopping * stop)
     return stop->force_stop && *(stop->force_stop);
 }
 
+/* called by the algorithms at the start of each outer iteration */
+void nlopt_stop_iteration(const nlopt_stopping * stop)
+{
+    if (stop->trace)
+        stop->trace(NLOPT_TRACE_ITERATION, stop->algorithm, stop->trace_data);
+}
+
+/* Evaluate the objective at the count points x (count-by-n, row-major)
+   with a single call of the batch objective, if there is one, storing the
+   values in f.  Returns the number of points evaluated: fewer than count
+   if that would exceed maxeval, and 0 if there is no batch objective, in
+   which case the caller evaluates the points one at a time as usual.  The
+   caller still counts each evaluation and applies its stopping tests as it
+   consumes the values in order, exactly as if it had made the calls. */
+unsigned nlopt_eval_batch(const nlopt_stopping * stop, unsigned count, unsigned n, const double *x, double *f)
+{
+    if (!stop->batch || nlopt_stop_forced(stop))
+        return 0;
+    if (stop->maxeval > 0) {
+        if (*(stop->nevals_p) >= stop->maxeval)
+            return 0;
+        if (count > (unsigned) (stop->maxeval - *(stop->nevals_p)))
+            count = (unsigned) (stop->maxeval - *(stop->nevals_p));
+    }
+    if (count > 0)
+        stop->batch(count, n, x, f, stop->batch_data);
+    return count;
+}
+
 unsigned nlopt_count_constraints(unsigned p, const nlopt_constraint * c)
 {
     unsigned i, count = 0;
@@ -183,6 +239,54 @@ void nlopt_eval_constraint(double *result, double *grad, const nlopt_constraint
         c->mf(c->m, result, n, x, grad, c->f_data);
 }
 
+/* Evaluate the objective f and the p constraints c at x, putting the
+   constraint values (and gradients, if cgrad) in cval and cgrad in the
+   order given by c (gradient rows of length n), and return f.  Counts one
+   evaluation.  With nthreads > 1, and if we were compiled with OpenMP,
+   the constraint blocks are evaluated by a team of nthreads threads while
+   the calling thread evaluates the objective (and then helps with the
+   constraints), so the constraint callbacks must be thread-safe;
+   offset[i] is the index in cval of the first value of c[i] (the sum of
+   the earlier c[].m).  The objective, and every wrapper around it (stall,
+   memoize, ...), still runs on the calling thread only; the one wrapper
+   that is shared with the constraints, the evaluation cache, locks.
+   Otherwise they are evaluated in order, stopping early (with the
+   remaining values unset) on a forced stop.  Callers should check
+   nlopt_stop_forced afterwards. */
+double nlopt_eval_objective_constraints(nlopt_stopping * stop, unsigned nthreads, const unsigned *offset, nlopt_func f, void *f_data, unsigned p, const nlopt_constraint * c, unsigned n, const double *x, double *grad, double *cval, double *cgrad)
+{
+    double fval;
+    unsigned i, k;
+
+    ++*(stop->nevals_p);
+#ifdef _OPENMP
+    if (nthreads > 1 && p > 0) {
+        int j;
+#pragma omp parallel num_threads(nthreads)
+        {
+#pragma omp master
+            fval = f(n, x, grad, f_data);
+#pragma omp for schedule(dynamic) nowait
+            for (j = 0; j < (int) p; ++j)
+                nlopt_eval_constraint(cval + offset[j], cgrad ? cgrad + offset[j] * n : NULL, c + j, n, x);
+        }
+        return fval;
+    }
+#else
+    (void) nthreads;
+    (void) offset;
+#endif
+    fval = f(n, x, grad, f_data);
+    if (nlopt_stop_forced(stop))
+        return fval;
+    for (i = k = 0; i < p; k += c[i++].m) {
+        nlopt_eval_constraint(cval + k, cgrad ? cgrad + k * n : NULL, c + i, n, x);
+        if (nlopt_stop_forced(stop))
+            break;
+    }
+    return fval;
+}
+
 char *nlopt_vsprintf(char *p, const char *format, va_list ap)
 {
     size_t len = strlen(format) + 128;
@@ -37,11 +37,28 @@
 #  include <windows.h>
 #endif
 
-/* return time in seconds since some arbitrary point in the past */
+/* return time in seconds since some arbitrary point in the past; a
+   monotonic clock is preferred, so that adjustments of the system time
+   (NTP, DST, the user) do not break maxtime */
 double nlopt_seconds(void)
 {
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1.e-9 * ts.tv_nsec;
+#elif defined(_WIN32) || defined(__WIN32__)
+    static THREADLOCAL double tick = 0; /* seconds per performance-counter tick */
+    LARGE_INTEGER count;
+    if (tick == 0) {
+        LARGE_INTEGER freq;
+        QueryPerformanceFrequency(&freq);
+        tick = 1.0 / (double) freq.QuadPart;
+    }
+    QueryPerformanceCounter(&count);
+    return tick * (double) count.QuadPart;
+#else
     static THREADLOCAL int start_inited = 0;    /* whether start time has been initialized */
-#if defined(HAVE_GETTIMEOFDAY)
+#  if defined(HAVE_GETTIMEOFDAY)
     static THREADLOCAL struct timeval start;
     struct timeval tv;
     if (!start_inited) {
@@ -50,19 +67,10 @@ double nlopt_seconds(void)
     }
     gettimeofday(&tv, NULL);
     return (tv.tv_sec - start.tv_sec) + 1.e-6 * (tv.tv_usec - start.tv_usec);
-#elif defined(HAVE_TIME)
+#  elif defined(HAVE_TIME)
+    (void) start_inited;
     return (double)time(NULL);
-#elif defined(_WIN32) || defined(__WIN32__)
-    static THREADLOCAL ULONGLONG start;
-    FILETIME ft;
-    if (!start_inited) {
-        start_inited = 1;
-        GetSystemTimeAsFileTime(&ft);
-        start = (((ULONGLONG) ft.dwHighDateTime) << 32) + ft.dwLowDateTime;
-    }
-    GetSystemTimeAsFileTime(&ft);
-    return 100e-9 * (((((ULONGLONG) ft.dwHighDateTime) << 32) + ft.dwLowDateTime) - start);
-#else
+#  else
     /* use clock() as a fallback... this is somewhat annoying
        because clock() may wrap around with a fairly short period */
     static THREADLOCAL clock_t start;
@@ -71,6 +79,7 @@ double nlopt_seconds(void)
         start = clock();
     }
     return (clock() - start) * 1.0 / CLOCKS_PER_SEC;
+#  endif
 #endif
 }
 
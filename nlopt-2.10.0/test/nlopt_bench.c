@@ -0,0 +1,340 @@
+/* Solver throughput benchmark: runs every algorithm (or those given with -a)
+   over the testfuncs suite and writes one JSON record per (algorithm,
+   function, dimension) with the number of evaluations, the time spent in
+   nlopt_optimize with and without the time spent in the objective, the
+   evaluation rate, the peak resident set size and the final error.  The
+   functions run at their own dimension, and those that accept any
+   dimension (Griewank) also at each of the -d dimensions below it.
+   Compare two runs with bench/compare.js.
+
+   usage: nlopt_bench [options] (-h for the list) */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+
+#include "nlopt_config.h"
+
+#ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
+#if defined(HAVE_GETOPT_H) && defined(HAVE_GETOPT)
+#  include <getopt.h>
+#else
+#  include "nlopt-getopt.h"
+#endif
+#if !defined(_WIN32)
+#  include <sys/resource.h>
+#endif
+
+#include "nlopt.h"
+#include "nlopt-util.h"
+#include "testfuncs.h"
+
+#define MAXDIMS 16
+
+static int maxeval = 1000, repeat = 3;
+static double maxtime = 2, xtol_rel = 0;
+static unsigned long seed = 1;
+static int ndims = 3, dims[MAXDIMS] = { 2, 5, 10 };
+static char algorithms[NLOPT_NUM_ALGORITHMS], functions[NTESTFUNCS];
+
+typedef struct {
+    nlopt_func f;
+    void *f_data;
+    int evaluations;
+    double seconds;             /* spent in f */
+} timed_func_data;
+
+static double timed_func(unsigned n, const double *x, double *grad, void *d_)
+{
+    timed_func_data *d = (timed_func_data *) d_;
+    double start = nlopt_seconds(), f = d->f(n, x, grad, d->f_data);
+    d->seconds += nlopt_seconds() - start;
+    ++d->evaluations;
+    return f;
+}
+
+typedef struct {
+    nlopt_result status;
+    int evaluations;
+    double seconds, objective_seconds, minf;
+    long peak_rss_kb;
+} run_result;
+
+/* start counting the peak RSS afresh (Linux only; elsewhere it is the peak
+   of the whole process so far) */
+static void reset_peak_rss(void)
+{
+#ifdef __linux__
+    FILE *f = fopen("/proc/self/clear_refs", "w");
+    if (f) {
+        fputs("5", f);
+        fclose(f);
+    }
+#endif
+}
+
+static long peak_rss_kb(void)
+{
+#ifdef __linux__
+    char line[128];
+    long kb = -1;
+    FILE *f = fopen("/proc/self/status", "r");
+    if (f) {
+        while (fgets(line, sizeof(line), f))
+            if (sscanf(line, "VmHWM: %ld kB", &kb) == 1)
+                break;
+        fclose(f);
+        if (kb >= 0)
+            return kb;
+    }
+#endif
+#if defined(_WIN32)
+    return -1;
+#else
+    {
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage))
+            return -1;
+#  ifdef __APPLE__
+        return usage.ru_maxrss / 1024;  /* bytes */
+#  else
+        return usage.ru_maxrss;
+#  endif
+    }
+#endif
+}
+
+/* the algorithms that have no default subsidiary optimizer */
+static int needs_local_optimizer(nlopt_algorithm a)
+{
+    return a == NLOPT_AUGLAG || a == NLOPT_AUGLAG_EQ || a == NLOPT_G_MLSL || a == NLOPT_G_MLSL_LDS;
+}
+
+static run_result run(nlopt_algorithm a, const testfunc * func, unsigned n)
+{
+    run_result r;
+    timed_func_data d;
+    nlopt_opt opt = nlopt_create(a, n), local = NULL;
+    double *x = (double *) malloc(sizeof(double) * n), start;
+    unsigned i;
+
+    memset(&r, 0, sizeof(r));
+    r.minf = HUGE_VAL;
+    if (!opt || !x) {
+        r.status = NLOPT_OUT_OF_MEMORY;
+        nlopt_destroy(opt);
+        free(x);
+        return r;
+    }
+    /* the same random starting point near the center of the box as testopt */
+    nlopt_srand(seed);
+    for (i = 0; i < n; ++i) {
+        double dx = (func->ub[i] - func->lb[i]) * 0.25, xm = 0.5 * (func->ub[i] + func->lb[i]);
+        x[i] = nlopt_urand(xm - dx, xm + dx);
+    }
+    d.f = func->f;
+    d.f_data = func->f_data;
+    d.evaluations = 0;
+    d.seconds = 0;
+    nlopt_set_min_objective(opt, timed_func, &d);
+    nlopt_set_lower_bounds(opt, func->lb);
+    nlopt_set_upper_bounds(opt, func->ub);
+    nlopt_set_maxeval(opt, maxeval);
+    nlopt_set_maxtime(opt, maxtime);
+    nlopt_set_xtol_rel(opt, xtol_rel);
+    nlopt_set_seed(opt, seed, 0);
+    if (needs_local_optimizer(a)) {
+        local = nlopt_create(NLOPT_LD_LBFGS, n);
+        nlopt_set_xtol_rel(local, 1e-7);
+        nlopt_set_local_optimizer(opt, local);
+    }
+
+    reset_peak_rss();
+    start = nlopt_seconds();
+    r.status = nlopt_optimize(opt, x, &r.minf);
+    r.seconds = nlopt_seconds() - start;
+    r.peak_rss_kb = peak_rss_kb();
+    r.evaluations = d.evaluations;
+    r.objective_seconds = d.seconds;
+
+    nlopt_destroy(local);
+    nlopt_destroy(opt);
+    free(x);
+    return r;
+}
+
+static void write_number(FILE * f, double x)
+{
+    if (isfinite(x))
+        fprintf(f, "%.9g", x);
+    else
+        fprintf(f, "null");
+}
+
+static void bench(FILE * out, nlopt_algorithm a, int ifunc, unsigned n, int *first)
+{
+    const testfunc *func = testfuncs + ifunc;
+    run_result best, r;
+    double minf = (unsigned) func->n == n ? func->minf : func->f(n, func->xmin, NULL, func->f_data);
+    int k, ok;
+
+    best = run(a, func, n);
+    for (k = 1; k < repeat; ++k) {
+        r = run(a, func, n);
+        if (r.seconds - r.objective_seconds < best.seconds - best.objective_seconds)
+            best = r;
+    }
+    /* as in testopt, these still return the best point found */
+    ok = best.status > 0 || best.status == NLOPT_ROUNDOFF_LIMITED || best.status == NLOPT_FORCED_STOP;
+
+    fprintf(out, "%s\n    {\"algorithm\": \"%s\", \"function\": \"%s\", \"n\": %u, \"status\": \"%s\", \"evaluations\": %d, ",
+            *first ? "" : ",", nlopt_algorithm_to_string(a), func->name, n, nlopt_result_to_string(best.status), best.evaluations);
+    fprintf(out, "\"seconds\": ");
+    write_number(out, best.seconds);
+    fprintf(out, ", \"objective_seconds\": ");
+    write_number(out, best.objective_seconds);
+    fprintf(out, ", \"solver_seconds\": ");
+    write_number(out, best.seconds - best.objective_seconds);
+    fprintf(out, ", \"evaluations_per_second\": ");
+    write_number(out, best.seconds > 0 ? best.evaluations / best.seconds : HUGE_VAL);
+    fprintf(out, ", \"peak_rss_kb\": %ld, \"minf\": ", best.peak_rss_kb);
+    write_number(out, ok ? best.minf : HUGE_VAL);
+    fprintf(out, ", \"error\": ");
+    write_number(out, ok ? fabs(best.minf - minf) : HUGE_VAL);
+    fprintf(out, "}");
+    fflush(out);
+    *first = 0;
+}
+
+/* a comma-separated list of algorithm names (as in nlopt_algorithm_to_string)
+   or numbers, or of function numbers */
+static int parse_list(const char *s, char *selected, int count, int algorithm)
+{
+    memset(selected, 0, count);
+    while (s && *s) {
+        char name[64];
+        size_t len = strcspn(s, ",");
+        int i;
+        if (len >= sizeof(name))
+            return 0;
+        memcpy(name, s, len);
+        name[len] = 0;
+        i = name[0] >= '0' && name[0] <= '9' ? atoi(name) : algorithm ? (int) nlopt_algorithm_from_string(name) : -1;
+        if (i < 0 || i >= count)
+            return 0;
+        selected[i] = 1;
+        s = s[len] ? s + len + 1 : NULL;
+    }
+    return 1;
+}
+
+static void usage(FILE * f)
+{
+    fprintf(f, "Usage: nlopt_bench [OPTIONS]\n"
+            "Options:\n"
+            "     -h : print this help\n"
+            " -a <list>: algorithms, by name (LN_BOBYQA) or number (default: all)\n"
+            " -o <list>: objective functions, by number as in testopt -L (default: all)\n"
+            " -d <list>: further dimensions for the functions of any dimension (default: 2,5,10)\n");
+    fprintf(f,
+            " -e <n> : use at most <n> evals (default: %d)\n"
+            " -t <t> : use at most <t> seconds per run (default: %g, 0 to disable)\n"
+            " -x <t> : relative tolerance <t> on x (default: disabled)\n"
+            " -i <n> : run each case <n> times and keep the fastest (default: %d)\n"
+            " -r <s> : random seed <s> for starting guesses and stochastic algorithms (default: %lu)\n"
+            " -O <f> : write the JSON to file <f> (default: stdout)\n", maxeval, maxtime, repeat, seed);
+}
+
+int main(int argc, char **argv)
+{
+    FILE *out = stdout;
+    int c, a, i, k, first = 1, major, minor, patch;
+
+    memset(algorithms, 1, sizeof(algorithms));
+    memset(functions, 1, sizeof(functions));
+    while ((c = getopt(argc, argv, "ha:o:d:e:t:x:i:r:O:")) != -1)
+        switch (c) {
+        case 'h':
+            usage(stdout);
+            return EXIT_SUCCESS;
+        case 'a':
+            if (!parse_list(optarg, algorithms, NLOPT_NUM_ALGORITHMS, 1)) {
+                fprintf(stderr, "nlopt_bench: invalid algorithm list %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'o':
+            if (!parse_list(optarg, functions, NTESTFUNCS, 0)) {
+                fprintf(stderr, "nlopt_bench: invalid function list %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'd':{
+                const char *s = optarg;
+                for (ndims = 0; s && *s && ndims < MAXDIMS; ++ndims) {
+                    dims[ndims] = atoi(s);
+                    s = strchr(s, ',');
+                    if (s)
+                        ++s;
+                }
+                break;
+            }
+        case 'e':
+            maxeval = atoi(optarg);
+            break;
+        case 't':
+            maxtime = atof(optarg);
+            break;
+        case 'x':
+            xtol_rel = atof(optarg);
+            break;
+        case 'i':
+            repeat = atoi(optarg) > 0 ? atoi(optarg) : 1;
+            break;
+        case 'r':
+            seed = (unsigned long) atol(optarg);
+            break;
+        case 'O':
+            if (!(out = fopen(optarg, "w"))) {
+                perror(optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        default:
+            fprintf(stderr, "nlopt_bench: invalid argument -%c\n", c);
+            usage(stderr);
+            return EXIT_FAILURE;
+        }
+
+    nlopt_version(&major, &minor, &patch);
+    fprintf(out, "{\n  \"benchmark\": \"nlopt_bench\",\n  \"version\": \"%d.%d.%d\",\n", major, minor, patch);
+    fprintf(out, "  \"settings\": {\"maxeval\": %d, \"maxtime\": %g, \"xtol_rel\": %g, \"repeat\": %d, \"seed\": %lu},\n", maxeval, maxtime, xtol_rel, repeat, seed);
+    /* how bench/compare.js matches records and judges each field */
+    fprintf(out, "  \"key\": [\"algorithm\", \"function\", \"n\"],\n");
+    fprintf(out, "  \"metrics\": {\"status\": \"exact\", \"evaluations\": \"exact\", \"solver_seconds\": \"time\", \"seconds\": \"time\", \"peak_rss_kb\": \"memory\", \"error\": \"error\"},\n");
+    fprintf(out, "  \"results\": [");
+    for (a = 0; a < NLOPT_NUM_ALGORITHMS; ++a) {
+        if (!algorithms[a])
+            continue;
+        for (i = 0; i < NTESTFUNCS; ++i) {
+            const testfunc *func = testfuncs + i;
+            if (!functions[i])
+                continue;
+            bench(out, (nlopt_algorithm) a, i, func->n, &first);
+            /* Griewank's f and minimum (at the origin) hold in any dimension */
+            if (!strcmp(func->name, "Griewank function"))
+                for (k = 0; k < ndims; ++k)
+                    if (dims[k] > 0 && dims[k] < func->n)
+                        bench(out, (nlopt_algorithm) a, i, dims[k], &first);
+        }
+        if (out != stdout)
+            fprintf(stderr, "%s\n", nlopt_algorithm_to_string((nlopt_algorithm) a));
+    }
+    fprintf(out, "\n  ]\n}\n");
+    if (out != stdout)
+        fclose(out);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,141 @@
+/* Checks AUGLAG's warm_start parameter: that each subsidiary optimization
+   after the first starts with the step carried over from the previous one
+   (AUGLAG_WARM_STEP times the distance it moved, clamped between
+   AUGLAG_WARM_MINSTEP times and once the original initial step), that
+   without warm_start every one starts with the original step, and that
+   both reach the same minimum.
+
+   The subsidiary algorithm (BOBYQA or Nelder-Mead) first evaluates its
+   starting point and then x + dx[i] e_i for each i, so the objective sees
+   the initial step of every subsidiary run, and each run starts where the
+   previous one stopped.
+
+   usage: t_auglag_warm [subsidiary algorithm] */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "nlopt.h"
+
+#define N 2
+#define MAXRUNS 100
+
+/* must match auglag.c */
+#define AUGLAG_WARM_STEP 30
+#define AUGLAG_WARM_MINSTEP 1e-3
+
+static const double dx0[N] = {0.5, 0.25};
+
+typedef struct {
+    nlopt_algorithm sub;
+    int in_sub, nruns, nevals;
+    double start[MAXRUNS][N], step[MAXRUNS][N];
+} probe;
+
+static void trace(nlopt_trace_event event, nlopt_algorithm algorithm, void *data)
+{
+    probe *p = (probe *) data;
+    if (algorithm != p->sub)
+        return;
+    if (event == NLOPT_TRACE_BEGIN) {
+        p->in_sub = 1;
+        p->nevals = 0;
+    } else if (event == NLOPT_TRACE_END) {
+        p->in_sub = 0;
+        if (p->nevals > N && p->nruns < MAXRUNS)
+            ++p->nruns;
+    }
+}
+
+/* (x0-2)^2 + (x1-1)^2, whose minimum over the unit disc is at (2,1)/sqrt(5) */
+static double objective(unsigned n, const double *x, double *grad, void *data)
+{
+    probe *p = (probe *) data;
+    (void) n;
+    (void) grad;
+    if (p->in_sub && p->nruns < MAXRUNS) {
+        if (p->nevals == 0) {
+            p->start[p->nruns][0] = x[0];
+            p->start[p->nruns][1] = x[1];
+        } else if (p->nevals <= N) {
+            int i = p->nevals - 1;
+            p->step[p->nruns][i] = fabs(x[i] - p->start[p->nruns][i]);
+        }
+        ++p->nevals;
+    }
+    return (x[0] - 2) * (x[0] - 2) + (x[1] - 1) * (x[1] - 1);
+}
+
+static double disc(unsigned n, const double *x, double *grad, void *data)
+{
+    (void) n;
+    (void) grad;
+    (void) data;
+    return x[0] * x[0] + x[1] * x[1] - 1;
+}
+
+static int close_to(double a, double b)
+{
+    return fabs(a - b) <= 1e-9 * fabs(b);
+}
+
+static int run(nlopt_algorithm sub, int warm, double *minf)
+{
+    static probe p;
+    double x[N] = {0, 0};
+    nlopt_opt opt = nlopt_create(NLOPT_AUGLAG, N), local = nlopt_create(sub, N);
+    nlopt_result ret;
+    int k, i, smaller = 0;
+
+    p.sub = sub;
+    p.in_sub = p.nruns = p.nevals = 0;
+    nlopt_set_initial_step(local, dx0);
+    nlopt_set_xtol_rel(local, 1e-10);
+    nlopt_set_local_optimizer(opt, local);
+    nlopt_destroy(local);
+    nlopt_set_min_objective(opt, objective, &p);
+    nlopt_add_inequality_constraint(opt, disc, NULL, 1e-10);
+    nlopt_set_xtol_rel(opt, 1e-8);
+    nlopt_set_maxeval(opt, 20000);
+    nlopt_set_param(opt, "warm_start", warm);
+    nlopt_set_trace_func(opt, trace, &p);
+    ret = nlopt_optimize(opt, x, minf);
+    nlopt_destroy(opt);
+    printf("%s warm_start=%d: ret=%d minf=%.10g, %d subsidiary runs\n", nlopt_algorithm_name(sub), warm, (int) ret, *minf, p.nruns);
+    if (ret < 0 || p.nruns < 2)
+        return 0;
+
+    for (k = 0; k < p.nruns; ++k)
+        for (i = 0; i < N; ++i) {
+            double expect = dx0[i];
+            if (warm && k > 0) {
+                double moved = fabs(p.start[k][i] - p.start[k - 1][i]);
+                expect = fmin(dx0[i], fmax(AUGLAG_WARM_STEP * moved, AUGLAG_WARM_MINSTEP * dx0[i]));
+            }
+            if (!close_to(p.step[k][i], expect)) {
+                fprintf(stderr, "run %d: initial step[%d] = %g, expected %g\n", k, i, p.step[k][i], expect);
+                return 0;
+            }
+            smaller += p.step[k][i] < dx0[i];
+        }
+    if (warm && !smaller) {
+        fprintf(stderr, "the initial step never shrank\n");
+        return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    nlopt_algorithm sub = argc > 1 ? (nlopt_algorithm) atoi(argv[1]) : NLOPT_LN_BOBYQA;
+    double cold, warm, exact = (sqrt(5.0) - 1) * (sqrt(5.0) - 1);
+
+    if (!run(sub, 0, &cold) || !run(sub, 1, &warm))
+        return EXIT_FAILURE;
+    if (fabs(cold - exact) > 1e-6 || fabs(warm - exact) > 1e-6) {
+        fprintf(stderr, "minimum %g (cold) / %g (warm), expected %g\n", cold, warm, exact);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
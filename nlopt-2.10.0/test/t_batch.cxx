@@ -0,0 +1,93 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <nlopt.hpp>
+
+// Rosenbrock function, counting single and batch calls
+static int ncalls = 0, nbatches = 0, nbatched = 0;
+
+static double rosenbrock(unsigned n, const double *x)
+{
+  double f = 0;
+  for (unsigned i = 0; i + 1 < n; ++i) {
+    double a = x[i+1] - x[i]*x[i], b = 1 - x[i];
+    f += 100*a*a + b*b;
+  }
+  return f;
+}
+
+double objective(const std::vector<double> &x, std::vector<double> &grad, void *data)
+{
+  (void)grad;
+  ++ncalls;
+  return *(int *)data ? -rosenbrock(x.size(), x.data()) : rosenbrock(x.size(), x.data());
+}
+
+void batch(unsigned count, unsigned n, const double *x, double *f, void *data)
+{
+  ++nbatches;
+  nbatched += count;
+  for (unsigned k = 0; k < count; ++k)
+    f[k] = *(int *)data ? -rosenbrock(n, x + k*n) : rosenbrock(n, x + k*n);
+}
+
+static std::vector<double> run(nlopt::algorithm algo, bool batched, bool maximize, bool fixed, int stall, double &minf, nlopt::result &ret)
+{
+  static int sense;
+  sense = maximize;
+  nlopt::srand(314159);
+  nlopt::opt opt(algo, 4);
+  std::vector<double> lb(4, -3), ub(4, 3);
+  if (fixed) // eliminated from the problem by some algorithms
+    lb[3] = ub[3] = 1;
+  opt.set_lower_bounds(lb);
+  opt.set_upper_bounds(ub);
+  if (maximize)
+    opt.set_max_objective(objective, &sense);
+  else
+    opt.set_min_objective(objective, &sense);
+  if (batched)
+    opt.set_batch_objective(batch, &sense);
+  if (stall)
+    opt.set_stall(stall, 1e-6);
+  opt.set_param("crs_batch", 8); // CRS2: generate the trial points 8 at a time
+  opt.set_maxeval(3001);
+  std::vector<double> x = {-1.2, 1, -1.2, 1};
+  ncalls = nbatches = nbatched = 0;
+  try {
+    ret = opt.optimize(x, minf);
+  }
+  catch (nlopt::roundoff_limited &) {
+    ret = nlopt::ROUNDOFF_LIMITED;
+  }
+  return x;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: t_batch algo" << std::endl;
+    return EXIT_FAILURE;
+  }
+  nlopt::algorithm algo = (nlopt::algorithm)atoi(argv[1]);
+  // the batch objective must not change the iterates, only how the
+  // evaluations are grouped into calls; a stall is only detected at the
+  // end of a batch, so there just check that it is detected
+  for (int variant = 0; variant < 6; ++variant) {
+    bool maximize = variant & 1, fixed = variant >= 4;
+    int stall = variant & 2 ? 400 : 0;
+    double f0, f1;
+    nlopt::result r0, r1;
+    std::vector<double> x0 = run(algo, false, maximize, fixed, stall, f0, r0);
+    int calls0 = ncalls;
+    std::vector<double> x1 = run(algo, true, maximize, fixed, stall, f1, r1);
+    std::cout << (maximize ? "max" : "min") << (fixed ? " x3=1" : "") << " stall=" << stall << ": " << calls0 << " calls -> "
+              << ncalls << " calls + " << nbatched << " in " << nbatches << " batches, f = " << f1
+              << ", " << r1 << " (unbatched f = " << f0 << ")" << std::endl;
+    if (r1 != r0 || nbatches == 0)
+      return EXIT_FAILURE;
+    if (!stall && (x1 != x0 || f1 != f0 || ncalls + nbatched != calls0))
+      return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
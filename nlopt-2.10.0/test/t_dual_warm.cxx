@@ -0,0 +1,94 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <nlopt.hpp>
+
+// min sum (x_i - c)^2 subject to x_i^2 + x_{i+1}^2 <= 1 (cyclically): for
+// c > 1/sqrt(2) every constraint is active, so all multipliers are nonzero
+static const unsigned n = 10;
+
+double center(const std::vector<double> &x, std::vector<double> &grad, void *data)
+{
+  double c = *static_cast<double *>(data), f = 0;
+  for (unsigned i = 0; i < n; ++i) {
+    f += (x[i] - c) * (x[i] - c);
+    if (!grad.empty())
+      grad[i] = 2 * (x[i] - c);
+  }
+  return f;
+}
+
+void discs(unsigned m, double *result, unsigned nx, const double *x, double *grad, void *data)
+{
+  (void)data;
+  for (unsigned i = 0; i < m; ++i) {
+    unsigned j = (i + 1) % nx;
+    result[i] = x[i] * x[i] + x[j] * x[j] - 1;
+    if (grad) {
+      for (unsigned k = 0; k < nx; ++k)
+        grad[i * nx + k] = 0;
+      grad[i * nx + i] = 2 * x[i];
+      grad[i * nx + j] = 2 * x[j];
+    }
+  }
+}
+
+// solves the problem for c = 1, 1.1, ..., 1.4 with one nlopt_opt, each run
+// starting from the previous minimum; with dual_warm_start the dual starts
+// from the previous run's multipliers too;
+// returns the total number of dual evaluations
+static int sweep(nlopt::algorithm algo, bool warm, std::vector<double> &minima)
+{
+  nlopt::opt opt(algo, n);
+  double c = 0;
+  std::vector<double> tol(n, 1e-10);
+  opt.set_lower_bounds(-2);
+  opt.set_upper_bounds(2);
+  opt.set_min_objective(center, &c);
+  opt.add_inequality_mconstraint(discs, NULL, tol);
+  opt.set_xtol_rel(1e-8);
+  opt.set_maxeval(2000);
+  opt.set_param("dual_ftol_rel", 1e-12);
+  if (warm)
+    opt.set_param("dual_warm_start", 1);
+  int dual_evals = 0;
+  std::vector<double> x(n, 0.1);
+  minima.clear();
+  for (int step = 0; step < 5; ++step) {
+    c = 1 + 0.1 * step;
+    double minf;
+    opt.optimize(x, minf);
+    if (opt.get_dual_numevals() <= 0) {
+      std::cerr << "no dual evaluations reported" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+    dual_evals += opt.get_dual_numevals();
+    minima.push_back(minf);
+  }
+  return dual_evals;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: t_dual_warm algo" << std::endl;
+    return EXIT_FAILURE;
+  }
+  nlopt::algorithm algo = (nlopt::algorithm)atoi(argv[1]);
+  std::vector<double> cold_minima, warm_minima;
+  int cold = sweep(algo, false, cold_minima);
+  int warm = sweep(algo, true, warm_minima);
+  std::cout << "dual evaluations: " << cold << " cold, " << warm << " warm" << std::endl;
+  for (unsigned i = 0; i < cold_minima.size(); ++i) {
+    // the exact minimum, all x_i = 1/sqrt(2)
+    double c = 1 + 0.1 * i, exact = n * (c - sqrt(0.5)) * (c - sqrt(0.5));
+    std::cout << "c=" << c << ": " << cold_minima[i] << " cold, " << warm_minima[i] << " warm (exact " << exact << ")" << std::endl;
+    if (fabs(cold_minima[i] - exact) > 1e-6 || fabs(warm_minima[i] - exact) > 1e-6)
+      return EXIT_FAILURE;
+  }
+  if (!(warm < cold)) {
+    std::cerr << "warm start did not reduce the dual evaluations" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,104 @@
+#include <iostream>
+#include <vector>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+#include <nlopt.hpp>
+
+// with eval_threads, the constraints are evaluated on several threads while
+// the objective (and every wrapper around it) stays on the calling thread;
+// the result must be the same as evaluating them one after another
+static const unsigned n = 4, m = 12;
+
+static std::thread::id caller;
+static bool objective_moved;
+static std::mutex mutex;
+static std::set<std::thread::id> constraint_threads;
+
+double objective(const std::vector<double> &x, std::vector<double> &grad, void *data)
+{
+  (void)data;
+  if (std::this_thread::get_id() != caller)
+    objective_moved = true;
+  double f = 0;
+  for (unsigned i = 0; i < n; ++i) {
+    f += (x[i] - 1) * (x[i] - 1);
+    if (!grad.empty())
+      grad[i] = 2 * (x[i] - 1);
+  }
+  return f;
+}
+
+// the half-space sum_i cos(k + i) x_i <= 1, slow enough that the other
+// threads pick up some of the constraints
+double plane(unsigned n_, const double *x, double *grad, void *data)
+{
+  unsigned k = *static_cast<unsigned *>(data);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    constraint_threads.insert(std::this_thread::get_id());
+  }
+  std::this_thread::sleep_for(std::chrono::microseconds(100));
+  double c = -1;
+  for (unsigned i = 0; i < n_; ++i) {
+    c += cos(k + i) * x[i];
+    if (grad)
+      grad[i] = cos(k + i);
+  }
+  return c;
+}
+
+static std::vector<double> run(nlopt::algorithm algo, int threads, double &minf, int &evals)
+{
+  static unsigned index[m];
+  nlopt::opt opt(algo, n);
+  opt.set_lower_bounds(-5);
+  opt.set_upper_bounds(5);
+  opt.set_min_objective(objective, NULL);
+  for (unsigned k = 0; k < m; ++k) {
+    index[k] = k;
+    opt.add_inequality_constraint(plane, &index[k], 1e-10);
+  }
+  opt.set_xtol_rel(1e-10);
+  opt.set_maxeval(500);
+  // the wrappers that keep state between evaluations
+  opt.set_stall(1000, 0);
+  opt.set_param("eval_cache", 100);
+  opt.set_param("eval_threads", threads);
+  std::vector<double> x(n, 0);
+  constraint_threads.clear();
+  opt.optimize(x, minf);
+  evals = opt.get_numevals();
+  return x;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: t_eval_threads algo" << std::endl;
+    return EXIT_FAILURE;
+  }
+  nlopt::algorithm algo = (nlopt::algorithm)atoi(argv[1]);
+  caller = std::this_thread::get_id();
+  double minf0, minf4;
+  int evals0, evals4;
+  std::vector<double> x0 = run(algo, 0, minf0, evals0);
+  std::vector<double> x4 = run(algo, 4, minf4, evals4);
+  std::cout << "eval_threads=0: minf=" << minf0 << " evals=" << evals0 << std::endl;
+  std::cout << "eval_threads=4: minf=" << minf4 << " evals=" << evals4 << ", constraints on " << constraint_threads.size() << " threads" << std::endl;
+  if (x0 != x4 || minf0 != minf4 || evals0 != evals4) {
+    std::cerr << "the threaded run differs" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (objective_moved) {
+    std::cerr << "the objective was called off the calling thread" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (constraint_threads.size() < 2) {
+    std::cerr << "the constraints were not evaluated concurrently" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <nlopt.hpp>
+
+// Rosenbrock function, counting calls
+static int ncalls = 0;
+
+double rosenbrock(const std::vector<double> &x, std::vector<double> &grad, void *data)
+{
+  (void)data;
+  ++ncalls;
+  double f = 0;
+  if (!grad.empty())
+    for (unsigned i = 0; i < x.size(); ++i)
+      grad[i] = 0;
+  for (unsigned i = 0; i + 1 < x.size(); ++i) {
+    double a = x[i+1] - x[i]*x[i], b = 1 - x[i];
+    f += 100*a*a + b*b;
+    if (!grad.empty()) {
+      grad[i] += -400*a*x[i] - 2*b;
+      grad[i+1] += 200*a;
+    }
+  }
+  return f;
+}
+
+double ball(const std::vector<double> &x, std::vector<double> &grad, void *data)
+{
+  (void)data;
+  ++ncalls;
+  double s = 0;
+  for (unsigned i = 0; i < x.size(); ++i) {
+    s += x[i]*x[i];
+    if (!grad.empty())
+      grad[i] = 2*x[i];
+  }
+  return s - 2;
+}
+
+static std::vector<double> run(nlopt::algorithm algo, double cache, double &minf, int &hits, int &misses)
+{
+  nlopt::opt opt(algo, 4);
+  opt.set_lower_bounds(-3);
+  opt.set_upper_bounds(3);
+  opt.set_min_objective(rosenbrock, NULL);
+  if (algo == nlopt::LN_COBYLA || algo == nlopt::LD_MMA || algo == nlopt::LD_SLSQP)
+    opt.add_inequality_constraint(ball, NULL, 1e-8);
+  if (algo == nlopt::G_MLSL) {
+    nlopt::opt local(nlopt::LN_BOBYQA, 4);
+    local.set_xtol_rel(1e-6);
+    opt.set_local_optimizer(local);
+  }
+  opt.set_xtol_rel(1e-10);
+  opt.set_maxeval(5000);
+  opt.set_seed(1, 0);
+  if (cache > 0)
+    opt.set_param("eval_cache", cache);
+  std::vector<double> x = {-1.2, 1, -1.2, 1};
+  ncalls = 0;
+  opt.optimize(x, minf);
+  hits = opt.get_cache_hits();
+  misses = opt.get_cache_misses();
+  return x;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: t_evalcache algo" << std::endl;
+    return EXIT_FAILURE;
+  }
+  nlopt::algorithm algo = (nlopt::algorithm)atoi(argv[1]);
+  // these evaluate some points more than once: ESCH keeps evaluated parents
+  // in its population, MLSL's local searches and AUGLAG's subproblems start
+  // from points that were already evaluated
+  bool revisits = algo == nlopt::GN_ESCH || algo == nlopt::G_MLSL || algo == nlopt::LN_AUGLAG;
+  double f0, f1;
+  int hits, misses;
+  std::vector<double> x0 = run(algo, 0, f0, hits, misses);
+  int calls0 = ncalls;
+  if (hits || misses)
+    return EXIT_FAILURE;
+  // an exact cache must not change the iterates, only avoid calls, one per
+  // hit; also run with a tiny cache to exercise eviction
+  for (double cache = 1000; cache >= 2; cache /= 500) {
+    std::vector<double> x1 = run(algo, cache, f1, hits, misses);
+    std::cout << "cache=" << cache << " calls " << calls0 << " -> " << ncalls
+              << " (hits=" << hits << ", misses=" << misses << ")" << std::endl;
+    if (x1 != x0 || f1 != f0 || ncalls != calls0 - hits || misses != ncalls)
+      return EXIT_FAILURE;
+    if (revisits && cache == 1000 && hits == 0) {
+      std::cerr << "no cache hits" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+/* ISRES's stochastic ranking: checks that isres_stochastic_rank gives the
+   rankings of Runarsson & Yao's original formulation (one uniform deviate
+   per comparison) with the same probabilities, and times both on random
+   populations of the given sizes.
+
+   usage: t_isres_rank [population ...]   (default: 100 1000 5000) */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "isres.h"
+
+#define PF 0.45
+#define SMALL 5 /* population for the distribution check */
+#define TRIALS 200000
+
+/* the original ranking loop */
+static void reference_rank(int population, const double *fval, const double *penalty, int *irank)
+{
+    int i, j;
+    for (i = 0; i < population; ++i)
+        irank[i] = i;
+    for (i = 0; i < population; ++i) {
+        int swapped = 0;
+        for (j = 0; j < population - 1; ++j) {
+            double u = nlopt_urand(0, 1);
+            int swap;
+            if (u < PF || (penalty[irank[j]] == 0 && penalty[irank[j + 1]] == 0))
+                swap = fval[irank[j]] > fval[irank[j + 1]];
+            else
+                swap = penalty[irank[j]] > penalty[irank[j + 1]];
+            if (swap) {
+                int t = irank[j];
+                irank[j] = irank[j + 1];
+                irank[j + 1] = t;
+                swapped = 1;
+            }
+        }
+        if (!swapped)
+            break;
+    }
+}
+
+static int perm_index(const int *irank)
+{
+    int i, k = 0;
+    for (i = 0; i < SMALL; ++i)
+        k = k * SMALL + irank[i];
+    return k;
+}
+
+static void random_population(int population, double *fval, double *penalty)
+{
+    int i;
+    for (i = 0; i < population; ++i) {
+        fval[i] = nlopt_urand(0, 1);
+        penalty[i] = nlopt_urand(0, 1) < 0.5 ? 0 : nlopt_urand(0, 1);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    static const int sizes[] = { 100, 1000, 5000 };
+    int nsizes = argc > 1 ? argc - 1 : (int) (sizeof(sizes) / sizeof(sizes[0]));
+    /* the ranking of this population is far from deterministic */
+    double fval[SMALL] = { 0.1, 0.3, 0.5, 0.7, 0.9 }, penalty[SMALL] = { 0.4, 0.3, 0, 0.2, 0.1 };
+    double us[SMALL], chi2 = 0;
+    int irank[SMALL], t, k, cells = 0;
+    int *count0 = (int *) calloc(2 * SMALL * SMALL * SMALL * SMALL * SMALL, sizeof(int)), *count1;
+    isres_rank_key keys[SMALL];
+
+    if (!count0)
+        return EXIT_FAILURE;
+    count1 = count0 + SMALL * SMALL * SMALL * SMALL * SMALL;
+    nlopt_init_genrand(5489);
+    for (t = 0; t < TRIALS; ++t) {
+        reference_rank(SMALL, fval, penalty, irank);
+        ++count0[perm_index(irank)];
+        isres_stochastic_rank(SMALL, fval, penalty, PF, irank, keys, us);
+        ++count1[perm_index(irank)];
+    }
+    /* two-sample chi-square test over the rankings that occurred */
+    for (k = 0; k < SMALL * SMALL * SMALL * SMALL * SMALL; ++k)
+        if (count0[k] + count1[k]) {
+            double d = count0[k] - count1[k];
+            chi2 += d * d / (count0[k] + count1[k]);
+            ++cells;
+        }
+    free(count0);
+    printf("%d rankings, chi-square %.1f (limit %.1f)\n", cells, chi2, cells - 1 + 5 * sqrt(2.0 * (cells - 1)));
+    if (chi2 > cells - 1 + 5 * sqrt(2.0 * (cells - 1))) {
+        fprintf(stderr, "the rankings have a different distribution\n");
+        return EXIT_FAILURE;
+    }
+
+    for (k = 0; k < nsizes; ++k) {
+        int population = argc > 1 ? atoi(argv[k + 1]) : sizes[k];
+        double *f = (double *) malloc(sizeof(double) * (3 * population));
+        int *r = (int *) malloc(sizeof(int) * population);
+        isres_rank_key *kk = (isres_rank_key *) malloc(sizeof(isres_rank_key) * population);
+        double t0, tref, tnew;
+        if (!f || !r || !kk || population < 2)
+            return EXIT_FAILURE;
+        random_population(population, f, f + population);
+        t0 = nlopt_seconds();
+        reference_rank(population, f, f + population, r);
+        tref = nlopt_seconds() - t0;
+        t0 = nlopt_seconds();
+        isres_stochastic_rank(population, f, f + population, PF, r, kk, f + 2 * population);
+        tnew = nlopt_seconds() - t0;
+        printf("population %6d: %9.3f ms, originally %9.3f ms\n", population, tnew * 1e3, tref * 1e3);
+        free(f);
+        free(r);
+        free(kk);
+    }
+    return EXIT_SUCCESS;
+}
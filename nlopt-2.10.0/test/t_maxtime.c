@@ -0,0 +1,131 @@
+/* Microbenchmark of the maxtime check, which runs after nearly every
+   objective evaluation: the cost of one clock read (nlopt_seconds), of an
+   unamortized nlopt_stop_time and of the amortized one used during
+   optimization, plus a check that maxtime is still honored promptly with
+   an objective that costs almost nothing, and by LN_NEWUOA_BOUND, whose
+   trust-region subproblems are nlopt optimizations of their own.
+
+   usage: t_maxtime [maxtime] */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "nlopt.h"
+#include "nlopt-util.h"
+
+#define NCALLS 10000000
+
+static volatile double sink;
+
+static double ns_per_call(double start, int ncalls)
+{
+    return (nlopt_seconds() - start) * 1e9 / ncalls;
+}
+
+/* Box and Betts' function (as in testfuncs.c) */
+static double boxbetts(unsigned n, const double *x, double *grad, void *data)
+{
+    int i;
+    double f = 0;
+    (void) n;
+    (void) grad;
+    (void) data;
+    for (i = 1; i <= 10; ++i) {
+        double g = exp(-0.1 * i * x[0]) - exp(-0.1 * i * x[1]) - (exp(-0.1 * i) - exp(-1.0 * i)) * x[2];
+        f += g * g;
+    }
+    return f;
+}
+
+static double sphere(unsigned n, const double *x, double *grad, void *data)
+{
+    unsigned i;
+    double f = 0;
+    (void) data;
+    for (i = 0; i < n; ++i) {
+        f += x[i] * x[i];
+        if (grad)
+            grad[i] = 2 * x[i];
+    }
+    return f;
+}
+
+int main(int argc, char **argv)
+{
+    double maxtime = argc > 1 ? atof(argv[1]) : 0.2;
+    double lb[2] = { -1, -1 }, ub[2] = { 2, 2 }, x[2] = { 1, 1 }, minf, t0, elapsed, last;
+    /* testopt -r 1 -a 27 -o 2: one of the subproblems from here used to run
+       for over a minute, whatever the maxtime */
+    double bb_lb[3] = { 0.9, 9, 0.9 }, bb_ub[3] = { 1.2, 11.2, 1.2 };
+    double bb_x[3] = { 1.0375533007053861, 10.342356942786374, 0.97501715622260177 }, bb_elapsed;
+    int evals = 0, i, backwards = 0;
+    nlopt_stopping stop;
+    nlopt_time_check time_check;
+    nlopt_opt opt;
+    nlopt_result ret, bb_ret;
+
+    /* one clock read, and whether the clock ever goes backwards */
+    last = t0 = nlopt_seconds();
+    for (i = 0; i < NCALLS; ++i) {
+        double t = nlopt_seconds();
+        backwards += t < last;
+        last = t;
+    }
+    printf("nlopt_seconds:              %6.2f ns/call\n", ns_per_call(t0, NCALLS));
+
+    stop.maxtime = 1e6;
+    stop.start = nlopt_seconds();
+    stop.time_check = NULL;
+    t0 = nlopt_seconds();
+    for (i = 0; i < NCALLS; ++i)
+        sink = nlopt_stop_time(&stop);
+    printf("nlopt_stop_time, per call:  %6.2f ns/call\n", ns_per_call(t0, NCALLS));
+
+    time_check.countdown = time_check.stride = 1;
+    time_check.last = stop.start;
+    stop.time_check = &time_check;
+    t0 = nlopt_seconds();
+    for (i = 0; i < NCALLS; ++i)
+        sink = nlopt_stop_time(&stop);
+    printf("nlopt_stop_time, amortized: %6.2f ns/call (stride %u)\n", ns_per_call(t0, NCALLS), time_check.stride);
+
+    /* DIRECT checks the time after every evaluation */
+    opt = nlopt_create(NLOPT_GN_DIRECT_L, 2);
+    nlopt_set_lower_bounds(opt, lb);
+    nlopt_set_upper_bounds(opt, ub);
+    nlopt_set_min_objective(opt, sphere, NULL);
+    nlopt_set_maxtime(opt, maxtime);
+    t0 = nlopt_seconds();
+    ret = nlopt_optimize(opt, x, &minf);
+    elapsed = nlopt_seconds() - t0;
+    evals = nlopt_get_numevals(opt);
+    nlopt_destroy(opt);
+    printf("GN_DIRECT_L, maxtime %g s:  %s after %g s, %d evaluations\n", maxtime, nlopt_result_to_string(ret), elapsed, evals);
+
+    opt = nlopt_create(NLOPT_LN_NEWUOA_BOUND, 3);
+    nlopt_set_lower_bounds(opt, bb_lb);
+    nlopt_set_upper_bounds(opt, bb_ub);
+    nlopt_set_min_objective(opt, boxbetts, NULL);
+    nlopt_set_maxeval(opt, 1000);
+    nlopt_set_maxtime(opt, maxtime);
+    t0 = nlopt_seconds();
+    bb_ret = nlopt_optimize(opt, bb_x, &minf);
+    bb_elapsed = nlopt_seconds() - t0;
+    printf("LN_NEWUOA_BOUND, maxtime %g s: %s after %g s, %d evaluations\n", maxtime, nlopt_result_to_string(bb_ret), bb_elapsed, nlopt_get_numevals(opt));
+    nlopt_destroy(opt);
+
+    if (backwards) {
+        fprintf(stderr, "clock went backwards %d times\n", backwards);
+        return EXIT_FAILURE;
+    }
+    if (ret != NLOPT_MAXTIME_REACHED || elapsed < maxtime || elapsed > 1.5 * maxtime + 0.05) {
+        fprintf(stderr, "maxtime not honored\n");
+        return EXIT_FAILURE;
+    }
+    if (bb_ret < 0 || bb_elapsed > 1.5 * maxtime + 0.05) {
+        fprintf(stderr, "maxtime not honored by LN_NEWUOA_BOUND\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
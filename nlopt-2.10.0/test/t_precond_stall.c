@@ -0,0 +1,98 @@
+/* Checks that a preconditioned objective keeps its own data pointer when
+   nlopt_optimize wraps it (the stall window, maximization): the
+   preconditioner must be called with the data that was passed to
+   nlopt_set_precond_min/max_objective, like the objective itself.
+
+   usage: t_precond_stall [algorithm] */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "nlopt.h"
+
+#define N 3
+
+typedef struct {
+    double sign;
+    int nf, npre, bad;
+} probe;
+
+static probe p;
+
+/* sign * sum_i (i+1) (x_i - 1)^2 */
+static double objective(unsigned n, const double *x, double *grad, void *data)
+{
+    unsigned i;
+    double f = 0;
+    if (data != &p)
+        ++p.bad;
+    ++p.nf;
+    for (i = 0; i < n; ++i) {
+        f += (i + 1) * (x[i] - 1) * (x[i] - 1);
+        if (grad)
+            grad[i] = p.sign * 2 * (i + 1) * (x[i] - 1);
+    }
+    return p.sign * f;
+}
+
+/* the (diagonal) Hessian of the objective */
+static void hessian(unsigned n, const double *x, const double *v, double *vpre, void *data)
+{
+    unsigned i;
+    (void) x;
+    if (data != &p)
+        ++p.bad;
+    ++p.npre;
+    for (i = 0; i < n; ++i)
+        vpre[i] = p.sign * 2 * (i + 1) * v[i];
+}
+
+static int run(nlopt_algorithm algorithm, int maximize, int stall)
+{
+    double x[N] = {0, 0, 0}, f;
+    nlopt_opt opt = nlopt_create(algorithm, N);
+    nlopt_result ret;
+    int i, ok = 1;
+
+    p.sign = maximize ? -1 : 1;
+    p.nf = p.npre = p.bad = 0;
+    nlopt_set_lower_bounds1(opt, -5);
+    nlopt_set_upper_bounds1(opt, 5);
+    if (maximize)
+        nlopt_set_precond_max_objective(opt, objective, hessian, &p);
+    else
+        nlopt_set_precond_min_objective(opt, objective, hessian, &p);
+    if (stall)
+        nlopt_set_stall(opt, 1000, 0);
+    nlopt_set_xtol_rel(opt, 1e-8);
+    nlopt_set_maxeval(opt, 1000);
+    ret = nlopt_optimize(opt, x, &f);
+    nlopt_destroy(opt);
+    printf("%s stall=%d: ret=%d f=%g, %d evaluations, %d preconditioner calls\n", maximize ? "max" : "min", stall, (int) ret, f, p.nf, p.npre);
+    if (p.bad) {
+        fprintf(stderr, "%d calls got the wrong data pointer\n", p.bad);
+        ok = 0;
+    }
+    if (p.npre == 0) {
+        fprintf(stderr, "the preconditioner was never called\n");
+        ok = 0;
+    }
+    for (i = 0; i < N; ++i)
+        if (fabs(x[i] - 1) > 1e-5) {
+            fprintf(stderr, "x[%d] = %g, expected 1\n", i, x[i]);
+            ok = 0;
+        }
+    return ok && ret > 0;
+}
+
+int main(int argc, char *argv[])
+{
+    nlopt_algorithm algorithm = argc > 1 ? (nlopt_algorithm) atoi(argv[1]) : NLOPT_LD_CCSAQ;
+    int maximize, stall, ok = 1;
+
+    for (maximize = 0; maximize < 2; ++maximize)
+        for (stall = 0; stall < 2; ++stall)
+            ok = run(algorithm, maximize, stall) && ok;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
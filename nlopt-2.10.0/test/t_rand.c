@@ -0,0 +1,142 @@
+/* Statistical checks and throughput of the bulk random-variate generators
+   (nlopt_urand01_fill, nlopt_nrand_fill, nlopt_crand_fill), with both the
+   global Mersenne twister and a seeded stream: a Kolmogorov-Smirnov test
+   of each distribution, the correlation between two streams of one seed,
+   and the cost per variate against the one-at-a-time functions.
+
+   usage: t_rand [count] */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "nlopt-util.h"
+
+static volatile double sink;
+
+static int cmp_double(const void *a_, const void *b_)
+{
+    double a = *(const double *) a_, b = *(const double *) b_;
+    return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+static double uniform_cdf(double x, const double *p)
+{
+    (void) p;
+    return x;
+}
+
+static double normal_cdf(double x, const double *p)
+{
+    (void) p;
+    return 0.5 * erfc(-x / sqrt(2.0));
+}
+
+/* p = { loc, scale, lo, hi } */
+static double cauchy_cdf(double x, const double *p)
+{
+    double alo = atan((p[2] - p[0]) / p[1]), ahi = atan((p[3] - p[0]) / p[1]);
+    return (atan((x - p[0]) / p[1]) - alo) / (ahi - alo);
+}
+
+/* Kolmogorov-Smirnov statistic of x[0..n-1] (sorted in place) against cdf */
+static double ks(double *x, unsigned n, double (*cdf) (double, const double *), const double *p)
+{
+    double d = 0;
+    unsigned i;
+    qsort(x, n, sizeof(double), cmp_double);
+    for (i = 0; i < n; ++i) {
+        double F = cdf(x[i], p);
+        if ((i + 1.0) / n - F > d)
+            d = (i + 1.0) / n - F;
+        if (F - (double) i / n > d)
+            d = F - (double) i / n;
+    }
+    return d;
+}
+
+static double ns_per_variate(double start, unsigned n)
+{
+    return (nlopt_seconds() - start) * 1e9 / n;
+}
+
+static int check(const char *what, double d, unsigned n)
+{
+    double limit = 1.95 / sqrt((double) n); /* 0.1% significance */
+    printf("  %-24s KS %.5f (limit %.5f)\n", what, d, limit);
+    if (d > limit) {
+        fprintf(stderr, "%s: not the expected distribution\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned n = argc > 1 ? (unsigned) atoi(argv[1]) : 1u << 18, i;
+    double *x = (double *) malloc(sizeof(double) * n), *y = (double *) malloc(sizeof(double) * n);
+    double cauchy[4] = { 0, 1, -5, 5 }, wide[4] = { 1, 2, -HUGE_VAL, HUGE_VAL };
+    double sxy = 0, t0;
+    nlopt_rng rng, rng1;
+    int mode, fails = 0;
+
+    if (!x || !y || n < 2)
+        return EXIT_FAILURE;
+
+    for (mode = 0; mode < 2; ++mode) {
+        if (mode == 0) {
+            printf("global generator:\n");
+            nlopt_init_genrand(5489);
+        } else {
+            printf("seeded stream:\n");
+            nlopt_rng_seed(&rng, 5489, 0);
+            nlopt_rng_use(&rng);
+        }
+        nlopt_urand01_fill(n, x);
+        fails += check("uniform", ks(x, n, uniform_cdf, NULL), n);
+        nlopt_nrand_fill(n - 1, x, 0, 1); /* an odd count */
+        fails += check("normal", ks(x, n - 1, normal_cdf, NULL), n - 1);
+        nlopt_crand_fill(n, x, cauchy[0], cauchy[1], cauchy[2], cauchy[3]);
+        fails += check("Cauchy, truncated", ks(x, n, cauchy_cdf, cauchy), n);
+        nlopt_crand_fill(n, x, wide[0], wide[1], wide[2], wide[3]);
+        fails += check("Cauchy", ks(x, n, cauchy_cdf, wide), n);
+
+        t0 = nlopt_seconds();
+        for (i = 0; i < n; ++i)
+            sink = nlopt_urand(0, 1);
+        printf("  nlopt_urand:        %6.2f ns/variate\n", ns_per_variate(t0, n));
+        t0 = nlopt_seconds();
+        nlopt_urand01_fill(n, x);
+        printf("  nlopt_urand01_fill: %6.2f ns/variate\n", ns_per_variate(t0, n));
+        t0 = nlopt_seconds();
+        for (i = 0; i < n; ++i)
+            sink = nlopt_nrand(0, 1);
+        printf("  nlopt_nrand:        %6.2f ns/variate\n", ns_per_variate(t0, n));
+        t0 = nlopt_seconds();
+        nlopt_nrand_fill(n, x, 0, 1);
+        printf("  nlopt_nrand_fill:   %6.2f ns/variate\n", ns_per_variate(t0, n));
+        t0 = nlopt_seconds();
+        nlopt_crand_fill(n, x, 0, 1, -5, 5);
+        printf("  nlopt_crand_fill:   %6.2f ns/variate\n", ns_per_variate(t0, n));
+    }
+
+    /* streams 0 and 1 of one seed should be uncorrelated */
+    nlopt_rng_seed(&rng, 5489, 0);
+    nlopt_rng_seed(&rng1, 5489, 1);
+    nlopt_rng_use(&rng);
+    nlopt_nrand_fill(n, x, 0, 1);
+    nlopt_rng_use(&rng1);
+    nlopt_nrand_fill(n, y, 0, 1);
+    nlopt_rng_use(NULL);
+    for (i = 0; i < n; ++i)
+        sxy += x[i] * y[i];
+    printf("correlation of streams 0 and 1: %.5f\n", sxy / n);
+    if (fabs(sxy / n) > 4 / sqrt((double) n)) {
+        fprintf(stderr, "streams 0 and 1 are correlated\n");
+        ++fails;
+    }
+
+    free(x);
+    free(y);
+    return fails ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,83 @@
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <nlopt.hpp>
+
+// Rosenbrock function
+double objective(const std::vector<double> &x, std::vector<double> &grad, void *data)
+{
+  (void)data;
+  double f = 0;
+  if (!grad.empty())
+    grad.assign(x.size(), 0);
+  for (unsigned i = 0; i + 1 < x.size(); ++i) {
+    double a = x[i+1] - x[i]*x[i], b = 1 - x[i];
+    f += 100*a*a + b*b;
+    if (!grad.empty()) {
+      grad[i] += -400*a*x[i] - 2*b;
+      grad[i+1] += 200*a;
+    }
+  }
+  return f;
+}
+
+static std::vector<double> run(nlopt::opt &opt, double &minf)
+{
+  std::vector<double> x = {-1.2, 1, -1.2, 1};
+  try {
+    opt.optimize(x, minf);
+  }
+  catch (nlopt::roundoff_limited &) {
+  }
+  return x;
+}
+
+static nlopt::opt create(nlopt::algorithm algo, unsigned long seed, unsigned stream)
+{
+  nlopt::opt opt(algo, 4);
+  opt.set_lower_bounds(std::vector<double>(4, -3));
+  opt.set_upper_bounds(std::vector<double>(4, 3));
+  opt.set_min_objective(objective, NULL);
+  opt.set_maxeval(2000);
+  opt.set_seed(seed, stream);
+  return opt;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: t_seed algo" << std::endl;
+    return EXIT_FAILURE;
+  }
+  nlopt::algorithm algo = (nlopt::algorithm)atoi(argv[1]);
+  // the local searches of MLSL and PRAXIS can end at the same point
+  bool differ = algo == nlopt::GN_DIRECT_L_RAND || algo == nlopt::GN_CRS2_LM
+    || algo == nlopt::GN_ISRES || algo == nlopt::GN_ESCH;
+  double f0, f1, f2, f3;
+
+  // a seeded run restarts its own stream, whatever the global generator does
+  nlopt::opt a = create(algo, 42, 0);
+  nlopt::srand(1);
+  std::vector<double> x0 = run(a, f0);
+  nlopt::srand(2);
+  std::vector<double> x1 = run(a, f1);
+  if (x1 != x0 || f1 != f0) {
+    std::cerr << "rerun with the same seed differs: " << f0 << " vs " << f1 << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // a copy has its own stream too, and runs of other streams in between
+  // do not disturb it
+  nlopt::opt b = create(algo, 42, 1), c(a);
+  std::vector<double> x2 = run(b, f2);
+  std::vector<double> x3 = run(c, f3);
+  if (x3 != x0 || f3 != f0) {
+    std::cerr << "copy with the same seed differs: " << f0 << " vs " << f3 << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (differ && x2 == x0) {
+    std::cerr << "streams 0 and 1 give the same result" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "stream 0: " << f0 << ", stream 1: " << f2 << " after " << b.get_numevals() << " evaluations" << std::endl;
+  return EXIT_SUCCESS;
+}
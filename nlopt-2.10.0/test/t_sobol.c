@@ -0,0 +1,131 @@
+/* Checks and throughput of the Sobol' sequence: that nlopt_sobol_seek and
+   nlopt_sobol_fill01 (and the public nlopt_sobol_points) give the same
+   points as stepping through the sequence with nlopt_sobol_next01, that
+   every coordinate of the first 2^m points (with the origin) is stratified
+   in all NLOPT_SOBOL_MAXDIM dimensions, and the cost per coordinate of the
+   one-at-a-time and the bulk generators.
+
+   usage: t_sobol [dim] [count] */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "nlopt-util.h"
+
+#define STRATA_BITS 8
+
+static volatile double sink;
+
+static double ns_per_coordinate(double start, double n)
+{
+    return (nlopt_seconds() - start) * 1e9 / n;
+}
+
+/* the rows of x (count x dim) against stepping from the start */
+static int check_points(const char *what, unsigned dim, unsigned skip, unsigned count, const double *x)
+{
+    nlopt_sobol s = nlopt_sobol_create(dim);
+    double *y = (double *) malloc(sizeof(double) * dim);
+    unsigned k;
+    int fails = 0;
+
+    for (k = 0; k < skip; ++k)
+        nlopt_sobol_next01(s, y);
+    for (k = 0; k < count && !fails; ++k) {
+        nlopt_sobol_next01(s, y);
+        fails = memcmp(y, x + (size_t) k * dim, sizeof(double) * dim) != 0;
+    }
+    if (fails)
+        fprintf(stderr, "%s: point %u after skipping %u differs in %u dimensions\n", what, skip + k, skip, dim);
+    nlopt_sobol_destroy(s);
+    free(y);
+    return fails;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned dim = argc > 1 ? (unsigned) atoi(argv[1]) : 2000;
+    unsigned count = argc > 2 ? (unsigned) atoi(argv[2]) : 2000;
+    unsigned skips[] = { 0, 1, 2, 3, 255, 256, 1000, 1023, 1024, 1500 };
+    unsigned i, j, k, nstrata = 1U << STRATA_BITS, empty = 0;
+    double *x = (double *) malloc(sizeof(double) * dim * count), *y, t0;
+    unsigned char *strata;
+    nlopt_sobol s;
+    int fails = 0;
+
+    if (!x || dim == 0 || dim > NLOPT_SOBOL_MAXDIM || count < 2) {
+        fprintf(stderr, "usage: t_sobol [dim <= %d] [count >= 2]\n", NLOPT_SOBOL_MAXDIM);
+        return EXIT_FAILURE;
+    }
+
+    /* skip-ahead and the bulk generator */
+    s = nlopt_sobol_create(dim);
+    nlopt_sobol_fill01(s, count, x);
+    nlopt_sobol_destroy(s);
+    fails += check_points("nlopt_sobol_fill01", dim, 0, count, x);
+    for (i = 0; i < sizeof(skips) / sizeof(skips[0]); ++i) {
+        unsigned skip = skips[i] % count, n = count - skip < 20 ? count - skip : 20;
+        s = nlopt_sobol_create(dim);
+        nlopt_sobol_seek(s, skip);
+        nlopt_sobol_fill01(s, n, x);
+        nlopt_sobol_destroy(s);
+        fails += check_points("nlopt_sobol_seek", dim, skip, n, x);
+        if (nlopt_sobol_points(dim, n, skip, x) != NLOPT_SUCCESS)
+            ++fails;
+        else
+            fails += check_points("nlopt_sobol_points", dim, skip, n, x);
+    }
+    if (nlopt_sobol_points(NLOPT_SOBOL_MAXDIM + 1, 1, 0, x) != NLOPT_INVALID_ARGS
+        || nlopt_sobol_points(dim, 2, 4294967294U, x) != NLOPT_INVALID_ARGS) {
+        fprintf(stderr, "nlopt_sobol_points: invalid arguments accepted\n");
+        ++fails;
+    }
+
+    /* the origin and the next 2^m - 1 points put exactly one value of every
+       coordinate into each interval [i/2^m, (i+1)/2^m) */
+    strata = (unsigned char *) calloc((size_t) NLOPT_SOBOL_MAXDIM * nstrata, 1);
+    y = (double *) malloc(sizeof(double) * NLOPT_SOBOL_MAXDIM);
+    s = nlopt_sobol_create(NLOPT_SOBOL_MAXDIM);
+    if (!strata || !y || !s) {
+        fprintf(stderr, "out of memory\n");
+        return EXIT_FAILURE;
+    }
+    for (j = 0; j < NLOPT_SOBOL_MAXDIM; ++j)
+        strata[(size_t) j * nstrata] = 1;
+    for (k = 1; k < nstrata; ++k) {
+        nlopt_sobol_next01(s, y);
+        for (j = 0; j < NLOPT_SOBOL_MAXDIM; ++j)
+            strata[(size_t) j * nstrata + (unsigned) (y[j] * nstrata)] = 1;
+    }
+    nlopt_sobol_destroy(s);
+    for (j = 0; j < (unsigned) NLOPT_SOBOL_MAXDIM * nstrata; ++j)
+        empty += !strata[j];
+    free(strata);
+    free(y);
+    printf("first %u points of %d dimensions: %u empty strata\n", nstrata, NLOPT_SOBOL_MAXDIM, empty);
+    if (empty) {
+        fprintf(stderr, "some coordinates are not stratified\n");
+        ++fails;
+    }
+
+    /* throughput, in dim dimensions */
+    s = nlopt_sobol_create(dim);
+    t0 = nlopt_seconds();
+    for (k = 0; k < count; ++k)
+        nlopt_sobol_next01(s, x + (size_t) k * dim);
+    printf("%u dimensions:\n  nlopt_sobol_next01: %6.2f ns/coordinate\n", dim, ns_per_coordinate(t0, (double) dim * count));
+    sink = x[dim * count - 1];
+    t0 = nlopt_seconds();
+    nlopt_sobol_fill01(s, count, x);
+    printf("  nlopt_sobol_fill01: %6.2f ns/coordinate\n", ns_per_coordinate(t0, (double) dim * count));
+    sink = x[dim * count - 1];
+    t0 = nlopt_seconds();
+    for (k = 0; k < 1000; ++k)
+        nlopt_sobol_seek(s, 4000000000U - k);
+    printf("  nlopt_sobol_seek:   %6.2f ns/coordinate\n", ns_per_coordinate(t0, 1000.0 * dim));
+    nlopt_sobol_destroy(s);
+    free(x);
+
+    return fails ? EXIT_FAILURE : EXIT_SUCCESS;
+}
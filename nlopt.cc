@@ -1,8 +1,19 @@
 #include <node.h>
 #include <v8.h>
 #include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <string>
+#include <vector>
 #include <nlopt.h>
 #include <nan.h>
+#include "evalstore.h"
+#include "evaltrace.h"
+#include "instrumentation.h"
+#include "timeline.h"
+#include "progress.h"
 
 using namespace v8;
 
@@ -55,6 +66,9 @@ void checkNloptErrorCode(Local<Object>& errors, Local<String>& operation, nlopt_
     case NLOPT_MAXTIME_REACHED:
       str = "Success: Optimization stopped because maxTime was reached";
       break;
+    case NLOPT_STALL_REACHED:
+      str = "Success: Optimization stopped because the objective stalled for stallWindow evaluations";
+      break;
     case NLOPT_FAILURE:
       str = "Failure";
       break;
@@ -95,7 +109,16 @@ void checkNloptErrorCode(Local<Object>& errors, Local<String>& operation, nlopt_
     CHECK_CODE(NAME) \
   }
 
-double optimizationFunc(unsigned n, const double* x, double* grad, void* ptrCallback)
+#define PARAM_CONFIG_OPTION(NAME, PARAM) \
+  GET_VALUE(Number, NAME, options) \
+  if(hasValue(val_##NAME)){ \
+    code = nlopt_set_param(opt, PARAM, val_##NAME->Value()); \
+    CHECK_CODE(NAME) \
+  }
+
+// Calls the JS objective or constraint; returns false if it didn't return a
+// number or resized the gradient.
+bool callOptimizationFunc(unsigned n, const double* x, double* grad, void* ptrCallback, double* value)
 {
   Isolate* isolate = Isolate::GetCurrent();
   EscapableHandleScope scope(isolate);
@@ -104,7 +127,7 @@ double optimizationFunc(unsigned n, const double* x, double* grad, void* ptrCall
   Local<Value> undefined;
   //Local<Function> callback = *reinterpret_cast<Local<Function>*>(ptrCallback);
   Function* callback = (Function*)(ptrCallback);
-  double returnValue = -1;
+  bool succeeded = false;
 
   //prepare parms to callback
   Local<Value> argv[3];
@@ -135,13 +158,22 @@ double optimizationFunc(unsigned n, const double* x, double* grad, void* ptrCall
         grad[i] = v8Grad->Get(context, i).ToLocalChecked()->NumberValue(context).ToChecked();
       }
     }
-    returnValue = ret->NumberValue(context).ToChecked();
+    *value = ret->NumberValue(context).ToChecked();
+    succeeded = true;
   }
   scope.Escape(undefined);
-  return returnValue;
+  return succeeded;
 }
 
-void optimizationMFunc(unsigned m, double* result, unsigned n, const double* x, double* grad, void* ptrCallback)
+double optimizationFunc(unsigned n, const double* x, double* grad, void* ptrCallback)
+{
+  double value = -1;
+  callOptimizationFunc(n, x, grad, ptrCallback, &value);
+  return value;
+}
+
+// Vector-valued counterpart of callOptimizationFunc.
+bool callOptimizationMFunc(unsigned m, double* result, unsigned n, const double* x, double* grad, void* ptrCallback)
 {
   Isolate* isolate = Isolate::GetCurrent();
   EscapableHandleScope scope(isolate);
@@ -150,6 +182,7 @@ void optimizationMFunc(unsigned m, double* result, unsigned n, const double* x,
   Local<Value> undefined;
   //Local<Function> callback = *reinterpret_cast<Local<Function>*>(ptrCallback);
   Function* callback = (Function*)(ptrCallback);
+  bool succeeded = false;
 
   //prepare parms to callback
   Local<Value> argv[4];
@@ -171,6 +204,8 @@ void optimizationMFunc(unsigned m, double* result, unsigned n, const double* x,
   //validate return results
   if(!ret->IsFloat64Array()){
     isolate->ThrowException(Exception::TypeError(String::NewFromUtf8(isolate, "Objective or constraint function must return an array of number.").ToLocalChecked()));
+    scope.Escape(undefined);
+    return false;
   }
 
   Local<Array> resultArray = Local<Array>::Cast(ret);
@@ -189,14 +224,462 @@ void optimizationMFunc(unsigned m, double* result, unsigned n, const double* x,
     for (unsigned i = 0; i < m; ++i) {
       result[i] = resultArray->Get(context, i).ToLocalChecked()->NumberValue(context).ToChecked();
     }
+    succeeded = true;
   }
   scope.Escape(undefined);
+  return succeeded;
+}
+
+void optimizationMFunc(unsigned m, double* result, unsigned n, const double* x, double* grad, void* ptrCallback)
+{
+  callOptimizationMFunc(m, result, n, x, grad, ptrCallback);
+}
+
+// Everything JS callbacks may be routed through: an EvalStore, an EvalTrace
+// (which, when replaying, replaces the callbacks entirely), statistics, a
+// timeline, a progress buffer and a cancellation signal.
+struct EvaluationContext {
+  EvalStore* store;
+  EvalTrace* trace;
+  Instrumentation* stats;
+  Timeline* timeline;
+  ProgressBuffer* progress;
+  const std::atomic<int32_t>* cancelFlag; // Int32Array element, nonzero = cancel
+  Object* abortSignal;
+  nlopt_opt opt;
+  uint64_t gcStart;
+  int runDepth; // > 1 inside local optimizations of MLSL/AUGLAG
+};
+
+struct WrappedFunction {
+  EvaluationContext* context;
+  int fid; // 0 = objective, then constraints in registration order
+  bool vectorValued;
+  Function* callback;
+  std::string name;
+};
+
+void evaluate(WrappedFunction* w, unsigned m, double* result, unsigned n, const double* x, double* grad)
+{
+  EvaluationContext* c = w->context;
+  if (c->trace && c->trace->replaying()) {
+    if (!c->trace->next(w->fid, m, x, result, grad)) {
+      nlopt_force_stop(c->opt);
+    }
+    return;
+  }
+  uint64_t requested = c->trace ? c->trace->now() : 0;
+  if (!c->store || !c->store->lookup(w->fid, m, x, result, grad)) {
+    uint64_t start = c->stats ? monotonicNanoseconds() : 0;
+    bool succeeded;
+    if (w->vectorValued) {
+      succeeded = callOptimizationMFunc(m, result, n, x, grad, w->callback);
+    }
+    else {
+      result[0] = -1;
+      succeeded = callOptimizationFunc(n, x, grad, w->callback, &result[0]);
+    }
+    if (c->stats) {
+      uint64_t elapsed = monotonicNanoseconds() - start;
+      c->stats->functions[w->fid].latency.record(elapsed);
+      c->stats->callbackNs += elapsed;
+    }
+    // a failed call leaves nothing worth serving to a later run
+    if (c->store && succeeded) {
+      c->store->append(w->fid, m, x, result, grad);
+    }
+  }
+  if (c->trace) {
+    c->trace->write(w->fid, m, x, result, grad, requested, c->trace->now());
+  }
+}
+
+bool cancelled(EvaluationContext* c)
+{
+  if (c->cancelFlag) {
+    return c->cancelFlag->load(std::memory_order_relaxed) != 0;
+  }
+  if (c->abortSignal) {
+    Isolate* isolate = Isolate::GetCurrent();
+    Local<Context> context = isolate->GetCurrentContext();
+    Local<Value> aborted;
+    return c->abortSignal->Get(context, String::NewFromUtf8(isolate, "aborted").ToLocalChecked()).ToLocal(&aborted) && aborted->BooleanValue(isolate);
+  }
+  return false;
+}
+
+void wrappedMFunc(unsigned m, double* result, unsigned n, const double* x, double* grad, void* data)
+{
+  WrappedFunction* w = static_cast<WrappedFunction*>(data);
+  EvaluationContext* c = w->context;
+  if ((c->cancelFlag || c->abortSignal) && cancelled(c)) {
+    // nlopt_force_stop also stops any local optimization running under c->opt
+    nlopt_force_stop(c->opt);
+    for (unsigned i = 0; i < m; ++i) {
+      result[i] = HUGE_VAL;
+    }
+    return;
+  }
+  if (c->stats) {
+    ++c->stats->functions[w->fid].evaluations;
+  }
+  if (c->timeline) {
+    c->timeline->beginCallback(w->name);
+  }
+  evaluate(w, m, result, n, x, grad);
+  if (c->timeline) {
+    c->timeline->endCallback();
+  }
+  if (c->progress && w->fid == 0) {
+    c->progress->evaluated(x, result[0]);
+  }
+}
+
+double wrappedFunc(unsigned n, const double* x, double* grad, void* data)
+{
+  double value;
+  wrappedMFunc(1, &value, n, x, grad, data);
+  return value;
+}
+
+// Returns the data pointer to register callback with: the callback itself,
+// or a WrappedFunction around it when a store, trace, statistics, a timeline,
+// a progress buffer or a cancellation signal are in use.
+void* wrapCallback(EvaluationContext& context, std::vector<std::unique_ptr<WrappedFunction> >& wrapped, Function* callback, bool vectorValued, const std::string& name) {
+  if (!context.store && !context.trace && !context.stats && !context.timeline && !context.progress && !context.cancelFlag && !context.abortSignal) {
+    return callback;
+  }
+  WrappedFunction* w = new WrappedFunction();
+  w->context = &context;
+  w->fid = wrapped.size();
+  w->vectorValued = vectorValued;
+  w->callback = callback;
+  w->name = name;
+  wrapped.push_back(std::unique_ptr<WrappedFunction>(w));
+  if (context.stats) {
+    context.stats->functions.resize(wrapped.size());
+    context.stats->functions.back().name = name;
+    context.stats->functions.back().evaluations = 0;
+  }
+  return w;
+}
+
+// Batches of objective evaluations handed to a pool created by
+// nlopt.createWorkerPool: the points are written straight into the pool's
+// shared x array, pool.run(count) has the workers evaluate them, and the
+// values are read back from its f array, so nothing is converted to JS values.
+struct WorkerPoolBatch {
+  EvaluationContext* context;
+  Function* run;
+  double* x; // capacity * n
+  double* f; // capacity
+  unsigned capacity;
+  Global<Value> exception; // thrown by run, rethrown once optimize returns
+};
+
+void workerPoolBatch(unsigned count, unsigned n, const double* x, double* f, void* data)
+{
+  WorkerPoolBatch* b = static_cast<WorkerPoolBatch*>(data);
+  EvaluationContext* c = b->context;
+  if ((c->cancelFlag || c->abortSignal) && cancelled(c)) {
+    nlopt_force_stop(c->opt);
+    std::fill(f, f + count, HUGE_VAL);
+    return;
+  }
+  Isolate* isolate = Isolate::GetCurrent();
+  HandleScope scope(isolate);
+  Local<Context> context = isolate->GetCurrentContext();
+  uint64_t start = c->stats ? monotonicNanoseconds() : 0;
+  if (c->timeline) {
+    c->timeline->beginCallback("objective batch of " + std::to_string(count));
+  }
+  for (unsigned done = 0; done < count; ) {
+    unsigned chunk = std::min(count - done, b->capacity);
+    memcpy(b->x, x + done * n, sizeof(double) * chunk * n);
+    Local<Value> argv[1] = {Number::New(isolate, chunk)};
+    TryCatch tryCatch(isolate);
+    if (b->run->Call(context, context->Global(), 1, argv).IsEmpty()) {
+      b->exception.Reset(isolate, tryCatch.Exception());
+      nlopt_force_stop(c->opt);
+      std::fill(f + done, f + count, HUGE_VAL);
+      break;
+    }
+    memcpy(f + done, b->f, sizeof(double) * chunk);
+    done += chunk;
+  }
+  if (c->timeline) {
+    c->timeline->endCallback();
+  }
+  if (c->stats) {
+    c->stats->functions[0].evaluations += count;
+    c->stats->callbackNs += monotonicNanoseconds() - start;
+  }
+  if (c->progress) {
+    for (unsigned k = 0; k < count; ++k) {
+      c->progress->evaluated(x + k * n, f[k]);
+    }
+  }
+}
+
+void gcPrologue(Isolate*, GCType, GCCallbackFlags, void* data) {
+  EvaluationContext* c = static_cast<EvaluationContext*>(data);
+  c->gcStart = monotonicNanoseconds();
+}
+
+void gcEpilogue(Isolate*, GCType, GCCallbackFlags, void* data) {
+  EvaluationContext* c = static_cast<EvaluationContext*>(data);
+  uint64_t now = monotonicNanoseconds();
+  if (c->stats) {
+    c->stats->gcNs += now - c->gcStart;
+    ++c->stats->gcCount;
+  }
+  if (c->timeline) {
+    c->timeline->gcPause(c->gcStart, now);
+  }
+}
+
+void traceEvent(nlopt_trace_event event, nlopt_algorithm algorithm, void* data) {
+  EvaluationContext* c = static_cast<EvaluationContext*>(data);
+  switch (event) {
+    case NLOPT_TRACE_BEGIN:
+      ++c->runDepth;
+      if (c->timeline) {
+        c->timeline->beginRun(nlopt_algorithm_to_string(algorithm));
+      }
+      break;
+    case NLOPT_TRACE_ITERATION:
+      if (c->timeline) {
+        c->timeline->iteration();
+      }
+      if (c->progress && c->runDepth == 1) {
+        c->progress->iteration();
+      }
+      break;
+    case NLOPT_TRACE_END:
+      --c->runDepth;
+      if (c->timeline) {
+        c->timeline->endRun();
+      }
+      break;
+  }
+}
+
+Local<Object> latencyToV8(const LatencyHistogram& h) {
+  Isolate* isolate = Isolate::GetCurrent();
+  Local<Context> context = isolate->GetCurrentContext();
+  Local<Object> obj = Object::New(isolate);
+  const double us = 1e-3;
+  obj->Set(context, String::NewFromUtf8(isolate, "count").ToLocalChecked(), Number::New(isolate, h.count)).FromJust();
+  obj->Set(context, String::NewFromUtf8(isolate, "minMicros").ToLocalChecked(), Number::New(isolate, h.count ? h.min * us : 0)).FromJust();
+  obj->Set(context, String::NewFromUtf8(isolate, "meanMicros").ToLocalChecked(), Number::New(isolate, h.count ? h.total * us / h.count : 0)).FromJust();
+  obj->Set(context, String::NewFromUtf8(isolate, "p50Micros").ToLocalChecked(), Number::New(isolate, h.percentile(0.5) * us)).FromJust();
+  obj->Set(context, String::NewFromUtf8(isolate, "p90Micros").ToLocalChecked(), Number::New(isolate, h.percentile(0.9) * us)).FromJust();
+  obj->Set(context, String::NewFromUtf8(isolate, "p99Micros").ToLocalChecked(), Number::New(isolate, h.percentile(0.99) * us)).FromJust();
+  obj->Set(context, String::NewFromUtf8(isolate, "p999Micros").ToLocalChecked(), Number::New(isolate, h.percentile(0.999) * us)).FromJust();
+  obj->Set(context, String::NewFromUtf8(isolate, "maxMicros").ToLocalChecked(), Number::New(isolate, h.max * us)).FromJust();
+  // nonzero buckets as [upper bound in microseconds, count] pairs
+  Local<Array> buckets = Array::New(isolate);
+  unsigned k = 0;
+  for (unsigned b = 0; b < LatencyHistogram::BUCKETS; ++b) {
+    if (h.counts[b]) {
+      Local<Array> pair = Array::New(isolate, 2);
+      pair->Set(context, 0, Number::New(isolate, LatencyHistogram::upperBound(b) * us)).FromJust();
+      pair->Set(context, 1, Number::New(isolate, h.counts[b])).FromJust();
+      buckets->Set(context, k++, pair).FromJust();
+    }
+  }
+  obj->Set(context, String::NewFromUtf8(isolate, "buckets").ToLocalChecked(), buckets).FromJust();
+  return obj;
 }
 
 bool hasValue(const Local<Value>& v) {
   return !v.IsEmpty() && !v->IsUndefined() && !v->IsNull();
 }
 
+// Linear constraints A x - b (<= or ==) 0, evaluated natively. A is either
+// dense (row-major, m*n) or CSR; the Jacobian is A itself, so it is expanded
+// to dense once up front and just copied out when a gradient is requested.
+struct LinearConstraints {
+  unsigned m, n;
+  bool sparse;
+  std::vector<double> values;     // dense A, or the CSR nonzeros
+  std::vector<unsigned> columns;  // CSR column indices
+  std::vector<unsigned> rows;     // CSR row pointers, length m + 1
+  std::vector<double> rhs;        // b, length m
+  std::vector<double> jacobian;   // dense A, m*n
+  std::vector<double> tolerances; // length m
+};
+
+static inline double denseDot(unsigned n, const double* a, const double* x) {
+  // four independent partial sums so the compiler can vectorize this
+  // without -ffast-math
+  double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  unsigned j = 0;
+  for (; j + 4 <= n; j += 4) {
+    s0 += a[j] * x[j];
+    s1 += a[j + 1] * x[j + 1];
+    s2 += a[j + 2] * x[j + 2];
+    s3 += a[j + 3] * x[j + 3];
+  }
+  for (; j < n; ++j) {
+    s0 += a[j] * x[j];
+  }
+  return (s0 + s1) + (s2 + s3);
+}
+
+void linearMFunc(unsigned m, double* result, unsigned n, const double* x, double* grad, void* data)
+{
+  const LinearConstraints* c = static_cast<const LinearConstraints*>(data);
+  if (c->sparse) {
+    for (unsigned i = 0; i < m; ++i) {
+      double s = 0;
+      for (unsigned k = c->rows[i]; k < c->rows[i + 1]; ++k) {
+        s += c->values[k] * x[c->columns[k]];
+      }
+      result[i] = s - c->rhs[i];
+    }
+  }
+  else {
+    const double* a = c->values.data();
+    for (unsigned i = 0; i < m; ++i, a += n) {
+      result[i] = denseDot(n, a, x) - c->rhs[i];
+    }
+  }
+  if (grad) {
+    memcpy(grad, c->jacobian.data(), sizeof(double) * m * n);
+  }
+}
+
+// Copies a Float64Array (or a plain array of numbers) into out.
+bool v8ToDoubleVector(const Local<Value>& v, std::vector<double>& out) {
+  Isolate* isolate = Isolate::GetCurrent();
+  Local<Context> context = isolate->GetCurrentContext();
+  if (v->IsFloat64Array()) {
+    Local<Float64Array> array = v.As<Float64Array>();
+    out.resize(array->Length());
+    if (!out.empty()) {
+      array->CopyContents(out.data(), out.size() * sizeof(double));
+    }
+    return true;
+  }
+  if (v->IsArray()) {
+    Local<Array> array = v.As<Array>();
+    out.resize(array->Length());
+    for (unsigned i = 0; i < array->Length(); ++i) {
+      out[i] = array->Get(context, i).ToLocalChecked()->NumberValue(context).FromJust();
+    }
+    return true;
+  }
+  return false;
+}
+
+// Copies an Int32Array/Uint32Array (or a plain array of numbers) into out.
+bool v8ToIndexVector(const Local<Value>& v, std::vector<unsigned>& out) {
+  Isolate* isolate = Isolate::GetCurrent();
+  Local<Context> context = isolate->GetCurrentContext();
+  if (v->IsInt32Array() || v->IsUint32Array()) {
+    Local<TypedArray> array = v.As<TypedArray>();
+    out.resize(array->Length());
+    if (!out.empty()) {
+      array->CopyContents(out.data(), out.size() * sizeof(unsigned));
+    }
+    return true;
+  }
+  if (v->IsArray()) {
+    Local<Array> array = v.As<Array>();
+    out.resize(array->Length());
+    for (unsigned i = 0; i < array->Length(); ++i) {
+      out[i] = array->Get(context, i).ToLocalChecked()->Uint32Value(context).FromJust();
+    }
+    return true;
+  }
+  return false;
+}
+
+// Reads {A, b} (or {C, d}) with an optional tolerance/tolerances. Returns NULL
+// and sets err if the matrix and right-hand side don't fit together.
+LinearConstraints* readLinearConstraints(Local<Object>& obj, const char* matrixName, const char* rhsName, unsigned n, const char** err) {
+  Isolate* isolate = Isolate::GetCurrent();
+  Local<Context> context = isolate->GetCurrentContext();
+  LinearConstraints* c = new LinearConstraints();
+  c->n = n;
+  Local<Value> matrix = obj->Get(context, String::NewFromUtf8(isolate, matrixName).ToLocalChecked()).ToLocalChecked();
+  Local<Value> rhs = obj->Get(context, String::NewFromUtf8(isolate, rhsName).ToLocalChecked()).ToLocalChecked();
+  *err = NULL;
+
+  bool hasRhs = v8ToDoubleVector(rhs, c->rhs);
+  c->m = c->rhs.size();
+  c->sparse = !matrix->IsFloat64Array() && !matrix->IsArray() && matrix->IsObject();
+  if (!hasRhs) {
+    *err = "right-hand side must be a Float64Array or an array of numbers";
+  }
+  else if (c->sparse) {
+    Local<Object> csr = matrix.As<Object>();
+    GET_VALUE(Value, rowPointers, csr)
+    GET_VALUE(Value, columnIndices, csr)
+    GET_VALUE(Value, values, csr)
+    if (val_rowPointers.IsEmpty() || val_columnIndices.IsEmpty() || val_values.IsEmpty() ||
+        !v8ToIndexVector(val_rowPointers, c->rows) ||
+        !v8ToIndexVector(val_columnIndices, c->columns) ||
+        !v8ToDoubleVector(val_values, c->values)) {
+      *err = "sparse matrix must be a {rowPointers, columnIndices, values} object";
+    }
+    else if (c->rows.size() != c->m + 1 || c->rows[0] != 0 || c->rows[c->m] != c->values.size() ||
+             c->columns.size() != c->values.size()) {
+      *err = "sparse matrix is inconsistent with the number of rows or nonzeros";
+    }
+    else {
+      // check every row pointer before any of them is used as a loop bound
+      for (unsigned i = 0; i < c->m && !*err; ++i) {
+        if (c->rows[i] > c->rows[i + 1] || c->rows[i + 1] > c->values.size()) {
+          *err = "sparse matrix row pointers must be nondecreasing";
+        }
+      }
+      if (!*err) {
+        c->jacobian.assign((size_t)c->m * n, 0.0);
+      }
+      for (unsigned i = 0; i < c->m && !*err; ++i) {
+        for (unsigned k = c->rows[i]; k < c->rows[i + 1] && !*err; ++k) {
+          if (c->columns[k] >= n) {
+            *err = "sparse matrix column index out of range";
+          }
+          else {
+            c->jacobian[(size_t)i * n + c->columns[k]] += c->values[k];
+          }
+        }
+      }
+    }
+  }
+  else if (!v8ToDoubleVector(matrix, c->values)) {
+    *err = "matrix must be a Float64Array, an array of numbers or a sparse {rowPointers, columnIndices, values} object";
+  }
+  else if (c->values.size() != (size_t)c->m * n) {
+    *err = "dense matrix must have (number of rows) * numberOfParameters entries";
+  }
+  else {
+    c->jacobian = c->values;
+  }
+
+  if (!*err) {
+    GET_VALUE(Value, tolerances, obj)
+    GET_VALUE(Value, tolerance, obj)
+    if (hasValue(val_tolerances)) {
+      if (!v8ToDoubleVector(val_tolerances, c->tolerances) || c->tolerances.size() != c->m) {
+        *err = "tolerances must have one entry per row";
+      }
+    }
+    else {
+      c->tolerances.assign(c->m, hasValue(val_tolerance) ? val_tolerance->NumberValue(context).FromJust() : 0.0);
+    }
+  }
+
+  if (*err) {
+    delete c;
+    return NULL;
+  }
+  return c;
+}
+
 NAN_METHOD(Optimize) {
   Isolate* isolate = Isolate::GetCurrent();
   EscapableHandleScope scope(isolate);
@@ -213,19 +696,128 @@ NAN_METHOD(Optimize) {
   GET_VALUE(Number, algorithm, options)
   GET_VALUE(Number, numberOfParameters, options)
   unsigned n = val_numberOfParameters->Uint32Value(context).FromJust();
+
+  // Persistent evaluation store shared across runs
+  GET_VALUE(Object, evaluationStore, options)
+  std::unique_ptr<EvalStore> store;
+  if (hasValue(val_evaluationStore)) {
+    GET_VALUE(Value, path, val_evaluationStore)
+    GET_VALUE(Value, fingerprint, val_evaluationStore)
+    std::string err = "path and fingerprint must be strings";
+    if (hasValue(val_path) && val_path->IsString() && hasValue(val_fingerprint) && val_fingerprint->IsString()) {
+      String::Utf8Value path(isolate, val_path);
+      String::Utf8Value fingerprint(isolate, val_fingerprint);
+      err.clear();
+      store.reset(EvalStore::open(*path, std::string(*fingerprint, fingerprint.length()), n, err));
+    }
+    if (!store) {
+      isolate->ThrowException(Exception::TypeError(
+        String::NewFromUtf8(isolate, ("'evaluationStore': " + err).c_str()).ToLocalChecked()
+      ));
+      info.GetReturnValue().Set(scope.Escape(ret));
+      return;
+    }
+  }
+
+  // Evaluation trace: record every evaluation, or replay a recorded run
+  GET_VALUE(Object, evaluationTrace, options)
+  std::unique_ptr<EvalTrace> trace;
+  if (hasValue(val_evaluationTrace)) {
+    GET_VALUE(Value, record, val_evaluationTrace)
+    GET_VALUE(Value, replay, val_evaluationTrace)
+    std::string err = "exactly one of record or replay must be a path";
+    if (hasValue(val_record) != hasValue(val_replay)) {
+      bool recording = hasValue(val_record);
+      String::Utf8Value path(isolate, recording ? val_record : val_replay);
+      unsigned algorithm = val_algorithm->Uint32Value(context).FromJust();
+      err.clear();
+      trace.reset(recording ? EvalTrace::record(*path, n, algorithm, err) : EvalTrace::replay(*path, n, algorithm, err));
+    }
+    if (!trace) {
+      isolate->ThrowException(Exception::TypeError(
+        String::NewFromUtf8(isolate, ("'evaluationTrace': " + err).c_str()).ToLocalChecked()
+      ));
+      info.GetReturnValue().Set(scope.Escape(ret));
+      return;
+    }
+  }
+
   nlopt_opt opt = nlopt_create(static_cast<nlopt_algorithm>(val_algorithm->Uint32Value(context).FromJust()), n);
 
-  // Objective function
+  // Optional statistics about the run, reported as result.instrumentation
+  GET_VALUE(Boolean, instrumentation, options)
+  std::unique_ptr<Instrumentation> stats;
+  if (hasValue(val_instrumentation) && val_instrumentation->BooleanValue(isolate)) {
+    stats.reset(new Instrumentation());
+  }
+
+  // Optional timeline of the run in the Chrome Trace Event format
+  GET_VALUE(String, timeline, options)
+  std::unique_ptr<Timeline> timeline;
+  if (hasValue(val_timeline)) {
+    timeline.reset(new Timeline());
+  }
+
   GET_VALUE(Function, minObjectiveFunction, options)
   GET_VALUE(Function, maxObjectiveFunction, options)
+
+  // Optional SharedArrayBuffer the best-so-far point is published into
+  GET_VALUE(Value, progress, options)
+  std::unique_ptr<ProgressBuffer> progress;
+  if (hasValue(val_progress)) {
+    if (!val_progress->IsSharedArrayBuffer() || val_progress.As<SharedArrayBuffer>()->ByteLength() < ProgressBuffer::bytes(n)) {
+      nlopt_destroy(opt);
+      isolate->ThrowException(Exception::TypeError(
+        String::NewFromUtf8(isolate, ("'progress' must be a SharedArrayBuffer of at least " + std::to_string(ProgressBuffer::bytes(n)) + " bytes").c_str()).ToLocalChecked()
+      ));
+      info.GetReturnValue().Set(scope.Escape(ret));
+      return;
+    }
+    progress.reset(new ProgressBuffer(val_progress.As<SharedArrayBuffer>()->GetBackingStore()->Data(), n, hasValue(val_maxObjectiveFunction)));
+  }
+
+  // Optional cancellation: an AbortSignal, or an Int32Array (normally on a
+  // SharedArrayBuffer, so other threads can set it) whose first element
+  // becomes nonzero; checked before every evaluation
+  GET_VALUE(Value, signal, options)
+  const std::atomic<int32_t>* cancelFlag = NULL;
+  Object* abortSignal = NULL;
+  if (hasValue(val_signal)) {
+    if (val_signal->IsInt32Array() && val_signal.As<Int32Array>()->Length() > 0) {
+      Local<Int32Array> flag = val_signal.As<Int32Array>();
+      cancelFlag = reinterpret_cast<const std::atomic<int32_t>*>(static_cast<char*>(flag->Buffer()->GetBackingStore()->Data()) + flag->ByteOffset());
+    }
+    else if (val_signal->IsObject() && val_signal.As<Object>()->Has(context, String::NewFromUtf8(isolate, "aborted").ToLocalChecked()).FromJust()) {
+      abortSignal = *val_signal.As<Object>();
+    }
+    else {
+      nlopt_destroy(opt);
+      isolate->ThrowException(Exception::TypeError(
+        String::NewFromUtf8(isolate, "'signal' must be an AbortSignal or an Int32Array").ToLocalChecked()
+      ));
+      info.GetReturnValue().Set(scope.Escape(ret));
+      return;
+    }
+  }
+
+  EvaluationContext evaluation = {store.get(), trace.get(), stats.get(), timeline.get(), progress.get(), cancelFlag, abortSignal, opt, 0, 0};
+  if (timeline || progress) {
+    nlopt_set_trace_func(opt, traceEvent, &evaluation);
+  }
+  std::vector<std::unique_ptr<WrappedFunction> > wrapped;
+  bool wrapping = store || trace || stats || timeline || progress || cancelFlag || abortSignal;
+  nlopt_func func = wrapping ? wrappedFunc : optimizationFunc;
+  nlopt_mfunc mfunc = wrapping ? wrappedMFunc : optimizationMFunc;
+
+  // Objective function
   int minMax = 0;
   if (hasValue(val_minObjectiveFunction)) {
-    code = nlopt_set_min_objective(opt, optimizationFunc, *val_minObjectiveFunction);
+    code = nlopt_set_min_objective(opt, func, wrapCallback(evaluation, wrapped, *val_minObjectiveFunction, false, "objective"));
     CHECK_CODE(minObjectiveFunction)
     ++minMax;
   }
   if (hasValue(val_maxObjectiveFunction)) {
-    code = nlopt_set_max_objective(opt, optimizationFunc, *val_maxObjectiveFunction);
+    code = nlopt_set_max_objective(opt, func, wrapCallback(evaluation, wrapped, *val_maxObjectiveFunction, false, "objective"));
     CHECK_CODE(maxObjectiveFunction)
     ++minMax;
   }
@@ -237,6 +829,42 @@ NAN_METHOD(Optimize) {
     return;
   }
 
+  // Optional pool of worker threads for the batches of points generated by
+  // ISRES, ESCH, CRS2 (initial population, and trial points when
+  // crsBatchSize > 1), MLSL (samples) and DIRECT; the objective itself is
+  // the pool's objective, so every other evaluation still happens on this
+  // thread. Not used with a store or a trace, which need to see every
+  // evaluation in order.
+  GET_VALUE(Object, workerPool, options)
+  WorkerPoolBatch poolBatch;
+  if (hasValue(val_workerPool) && !store && !trace) {
+    GET_VALUE(Value, x, val_workerPool)
+    GET_VALUE(Value, f, val_workerPool)
+    GET_VALUE(Value, capacity, val_workerPool)
+    GET_VALUE(Value, run, val_workerPool)
+    GET_VALUE(Value, numberOfParameters, val_workerPool)
+    unsigned capacity = hasValue(val_capacity) && val_capacity->IsUint32() ? val_capacity.As<Uint32>()->Value() : 0;
+    if (capacity == 0 || !hasValue(val_x) || !val_x->IsFloat64Array() || val_x.As<Float64Array>()->Length() < (size_t)capacity * n
+        || !hasValue(val_f) || !val_f->IsFloat64Array() || val_f.As<Float64Array>()->Length() < capacity
+        || !hasValue(val_run) || !val_run->IsFunction()
+        || !hasValue(val_numberOfParameters) || !val_numberOfParameters->IsUint32() || val_numberOfParameters.As<Uint32>()->Value() != n) {
+      nlopt_destroy(opt);
+      isolate->ThrowException(Exception::TypeError(
+        String::NewFromUtf8(isolate, "'workerPool' must be a pool from nlopt.createWorkerPool with the same numberOfParameters").ToLocalChecked()
+      ));
+      info.GetReturnValue().Set(scope.Escape(ret));
+      return;
+    }
+    Local<Float64Array> x = val_x.As<Float64Array>(), f = val_f.As<Float64Array>();
+    poolBatch.context = &evaluation;
+    poolBatch.run = *val_run.As<Function>();
+    poolBatch.x = reinterpret_cast<double*>(static_cast<char*>(x->Buffer()->GetBackingStore()->Data()) + x->ByteOffset());
+    poolBatch.f = reinterpret_cast<double*>(static_cast<char*>(f->Buffer()->GetBackingStore()->Data()) + f->ByteOffset());
+    poolBatch.capacity = capacity;
+    code = nlopt_set_batch_objective(opt, workerPoolBatch, &poolBatch);
+    CHECK_CODE(workerPool)
+  }
+
   // Optional parameters
   GET_VALUE(Array, lowerBounds, options)
   if (hasValue(val_lowerBounds)) {
@@ -261,6 +889,23 @@ NAN_METHOD(Optimize) {
   SIMPLE_CONFIG_OPTION(xToleranceAbsolute, nlopt_set_xtol_abs1)
   SIMPLE_CONFIG_OPTION(maxEval, nlopt_set_maxeval)
   SIMPLE_CONFIG_OPTION(maxTime, nlopt_set_maxtime)
+  PARAM_CONFIG_OPTION(evalCacheSize, "eval_cache")
+  PARAM_CONFIG_OPTION(evalCacheTolerance, "eval_cache_tol")
+  PARAM_CONFIG_OPTION(crsBatchSize, "crs_batch")
+
+  GET_VALUE(Number, stallWindow, options)
+  GET_VALUE(Number, stallImprovement, options)
+  if (hasValue(val_stallWindow)) {
+    code = nlopt_set_stall(opt, (int)val_stallWindow->Value(), hasValue(val_stallImprovement) ? val_stallImprovement->Value() : 0.0);
+    CHECK_CODE(stallWindow)
+  }
+
+  GET_VALUE(Number, seed, options)
+  GET_VALUE(Number, seedStream, options)
+  if (hasValue(val_seed)) {
+    code = nlopt_set_seed(opt, (unsigned long)val_seed->Value(), hasValue(val_seedStream) ? (unsigned)val_seedStream->Value() : 0);
+    CHECK_CODE(seed)
+  }
 
   GET_VALUE(Array, inequalityConstraints, options)
   if (hasValue(val_inequalityConstraints)) {
@@ -268,7 +913,7 @@ NAN_METHOD(Optimize) {
       Local<Object> obj = val_inequalityConstraints->Get(context, i).ToLocalChecked().As<Object>();
       GET_VALUE(Function, callback, obj)
       GET_VALUE(Number, tolerance, obj)
-      code = nlopt_add_inequality_constraint(opt, optimizationFunc, *val_callback, val_tolerance->NumberValue(context).FromJust());
+      code = nlopt_add_inequality_constraint(opt, func, wrapCallback(evaluation, wrapped, *val_callback, false, "inequalityConstraints[" + std::to_string(i) + "]"), val_tolerance->NumberValue(context).FromJust());
       CHECK_CODE(inequalityConstraints)
     }
   }
@@ -279,7 +924,7 @@ NAN_METHOD(Optimize) {
       Local<Object> obj = val_equalityConstraints->Get(context, i).ToLocalChecked().As<Object>();
       GET_VALUE(Function, callback, obj)
       GET_VALUE(Number, tolerance, obj)
-      code = nlopt_add_equality_constraint(opt, optimizationFunc, *val_callback, val_tolerance->NumberValue(context).FromJust());
+      code = nlopt_add_equality_constraint(opt, func, wrapCallback(evaluation, wrapped, *val_callback, false, "equalityConstraints[" + std::to_string(i) + "]"), val_tolerance->NumberValue(context).FromJust());
       CHECK_CODE(equalityConstraints)
     }
   }
@@ -291,7 +936,7 @@ NAN_METHOD(Optimize) {
       GET_VALUE(Function, callback, obj)
       GET_VALUE(Array, tolerances, obj)
       double* tolerances = v8ArrayToCArray(val_tolerances);
-      code = nlopt_add_inequality_mconstraint(opt, val_tolerances->Length(), optimizationMFunc, *val_callback, tolerances);
+      code = nlopt_add_inequality_mconstraint(opt, val_tolerances->Length(), mfunc, wrapCallback(evaluation, wrapped, *val_callback, true, "inequalityMConstraints[" + std::to_string(i) + "]"), tolerances);
       CHECK_CODE(inequalityMConstraints)
     }
   }
@@ -303,11 +948,49 @@ NAN_METHOD(Optimize) {
       GET_VALUE(Function, callback, obj)
       GET_VALUE(Array, tolerances, obj)
       double* tolerances = v8ArrayToCArray(val_tolerances);
-      code = nlopt_add_equality_mconstraint(opt, val_tolerances->Length(), optimizationMFunc, *val_callback, tolerances);
+      code = nlopt_add_equality_mconstraint(opt, val_tolerances->Length(), mfunc, wrapCallback(evaluation, wrapped, *val_callback, true, "equalityMConstraints[" + std::to_string(i) + "]"), tolerances);
       CHECK_CODE(equalityMConstraints)
     }
   }
 
+  // Linear constraints are evaluated natively, no JS callbacks involved
+  std::vector<LinearConstraints*> linearConstraints;
+  const char* linearError = NULL;
+  const char* linearOption = NULL;
+  GET_VALUE(Object, linearInequalities, options)
+  if (hasValue(val_linearInequalities)) {
+    linearOption = "linearInequalities";
+    LinearConstraints* c = readLinearConstraints(val_linearInequalities, "A", "b", n, &linearError);
+    if (c) {
+      linearConstraints.push_back(c);
+      code = nlopt_add_inequality_mconstraint(opt, c->m, linearMFunc, c, c->tolerances.data());
+      CHECK_CODE(linearInequalities)
+    }
+  }
+
+  GET_VALUE(Object, linearEqualities, options)
+  if (hasValue(val_linearEqualities) && !linearError) {
+    linearOption = "linearEqualities";
+    LinearConstraints* c = readLinearConstraints(val_linearEqualities, "C", "d", n, &linearError);
+    if (c) {
+      linearConstraints.push_back(c);
+      code = nlopt_add_equality_mconstraint(opt, c->m, linearMFunc, c, c->tolerances.data());
+      CHECK_CODE(linearEqualities)
+    }
+  }
+
+  if (linearError) {
+    nlopt_destroy(opt);
+    for (unsigned i = 0; i < linearConstraints.size(); ++i) {
+      delete linearConstraints[i];
+    }
+    isolate->ThrowException(Exception::TypeError(
+      String::NewFromUtf8(isolate, (std::string("'") + linearOption + "': " + linearError).c_str()).ToLocalChecked()
+    ));
+    info.GetReturnValue().Set(scope.Escape(ret));
+    return;
+  }
+
   // Setup parameters for optimization
   double* input = new double[n];
   std::fill(input, input + n, 0);
@@ -324,16 +1007,106 @@ NAN_METHOD(Optimize) {
   // Do the optimization!
   key = String::NewFromUtf8(isolate, "status").ToLocalChecked();
   double output[1] = {0};
+  uint64_t optimizeStart = 0;
+  if (stats || timeline) {
+    isolate->AddGCPrologueCallback(gcPrologue, &evaluation);
+    isolate->AddGCEpilogueCallback(gcEpilogue, &evaluation);
+    optimizeStart = monotonicNanoseconds();
+  }
   checkNloptErrorCode(ret, key, nlopt_optimize(opt, input, output));
+  uint64_t optimizeNs = stats ? monotonicNanoseconds() - optimizeStart : 0;
+  if (stats || timeline) {
+    isolate->RemoveGCPrologueCallback(gcPrologue, &evaluation);
+    isolate->RemoveGCEpilogueCallback(gcEpilogue, &evaluation);
+  }
+  if (timeline) {
+    String::Utf8Value path(isolate, val_timeline);
+    std::string err;
+    ret->Set(context, key_timeline, String::NewFromUtf8(isolate, timeline->write(*path, err) ? "Success" : err.c_str()).ToLocalChecked()).FromJust();
+  }
+  if (progress) {
+    progress->finish(input, output[0]);
+  }
   ret->Set(context, String::NewFromUtf8(isolate, "parameterValues").ToLocalChecked(), cArrayToV8Array(n, input)).FromJust();
   delete[] input;
   ret->Set(context, String::NewFromUtf8(isolate, "outputValue").ToLocalChecked(), Number::New(isolate, output[0])).FromJust();
+  if (hasValue(val_evalCacheSize)) {
+    ret->Set(context, String::NewFromUtf8(isolate, "cacheHits").ToLocalChecked(), Number::New(isolate, nlopt_get_cache_hits(opt))).FromJust();
+    ret->Set(context, String::NewFromUtf8(isolate, "cacheMisses").ToLocalChecked(), Number::New(isolate, nlopt_get_cache_misses(opt))).FromJust();
+  }
+  if (store) {
+    ret->Set(context, String::NewFromUtf8(isolate, "storeHits").ToLocalChecked(), Number::New(isolate, store->hits)).FromJust();
+    ret->Set(context, String::NewFromUtf8(isolate, "storeMisses").ToLocalChecked(), Number::New(isolate, store->misses)).FromJust();
+  }
+  if (trace) {
+    ret->Set(context, String::NewFromUtf8(isolate, "traceEvaluations").ToLocalChecked(), Number::New(isolate, trace->count)).FromJust();
+    if (trace->diverged >= 0) {
+      ret->Set(context, String::NewFromUtf8(isolate, "traceDivergedAt").ToLocalChecked(), Number::New(isolate, trace->diverged)).FromJust();
+    }
+  }
+  if (stats) {
+    Local<Object> obj = Object::New(isolate);
+    Local<Array> functions = Array::New(isolate);
+    for (unsigned i = 0; i < stats->functions.size(); ++i) {
+      const FunctionStats& f = stats->functions[i];
+      Local<Object> fobj = Object::New(isolate);
+      fobj->Set(context, String::NewFromUtf8(isolate, "name").ToLocalChecked(), String::NewFromUtf8(isolate, f.name.c_str()).ToLocalChecked()).FromJust();
+      fobj->Set(context, String::NewFromUtf8(isolate, "evaluations").ToLocalChecked(), Number::New(isolate, f.evaluations)).FromJust();
+      fobj->Set(context, String::NewFromUtf8(isolate, "callbackLatency").ToLocalChecked(), latencyToV8(f.latency)).FromJust();
+      functions->Set(context, i, fobj).FromJust();
+    }
+    obj->Set(context, String::NewFromUtf8(isolate, "numevals").ToLocalChecked(), Number::New(isolate, nlopt_get_numevals(opt))).FromJust();
+    obj->Set(context, String::NewFromUtf8(isolate, "functions").ToLocalChecked(), functions).FromJust();
+    obj->Set(context, String::NewFromUtf8(isolate, "totalSeconds").ToLocalChecked(), Number::New(isolate, optimizeNs * 1e-9)).FromJust();
+    obj->Set(context, String::NewFromUtf8(isolate, "callbackSeconds").ToLocalChecked(), Number::New(isolate, stats->callbackNs * 1e-9)).FromJust();
+    obj->Set(context, String::NewFromUtf8(isolate, "solverSeconds").ToLocalChecked(), Number::New(isolate, (optimizeNs - stats->callbackNs) * 1e-9)).FromJust();
+    obj->Set(context, String::NewFromUtf8(isolate, "gcSeconds").ToLocalChecked(), Number::New(isolate, stats->gcNs * 1e-9)).FromJust();
+    obj->Set(context, String::NewFromUtf8(isolate, "gcCount").ToLocalChecked(), Number::New(isolate, stats->gcCount)).FromJust();
+    obj->Set(context, String::NewFromUtf8(isolate, "workspaceBytes").ToLocalChecked(), Number::New(isolate, nlopt_get_workspace_size(opt))).FromJust();
+    if (nlopt_num_phases() > 0) { // NLopt built with NLOPT_PROFILE
+      Local<Object> phases = Object::New(isolate);
+      for (int p = 0; p < nlopt_num_phases(); ++p) {
+        Local<Object> pobj = Object::New(isolate);
+        pobj->Set(context, String::NewFromUtf8(isolate, "seconds").ToLocalChecked(), Number::New(isolate, nlopt_get_phase_time(opt, p))).FromJust();
+        pobj->Set(context, String::NewFromUtf8(isolate, "count").ToLocalChecked(), Number::New(isolate, nlopt_get_phase_count(opt, p))).FromJust();
+        phases->Set(context, String::NewFromUtf8(isolate, nlopt_phase_name(p)).ToLocalChecked(), pobj).FromJust();
+      }
+      obj->Set(context, String::NewFromUtf8(isolate, "phases").ToLocalChecked(), phases).FromJust();
+    }
+    ret->Set(context, String::NewFromUtf8(isolate, "instrumentation").ToLocalChecked(), obj).FromJust();
+  }
   nlopt_destroy(opt); // Cleanup
+  for (unsigned i = 0; i < linearConstraints.size(); ++i) {
+    delete linearConstraints[i];
+  }
+  if (!poolBatch.exception.IsEmpty()) {
+    isolate->ThrowException(poolBatch.exception.Get(isolate));
+  }
   info.GetReturnValue().Set(scope.Escape(ret));
 }
 
+// sobol(dim, count, skip, x) fills the Float64Array x (count*dim, allocated
+// and validated in JS) with points skip+1 ... skip+count of the Sobol' sequence
+NAN_METHOD(Sobol) {
+  Isolate* isolate = Isolate::GetCurrent();
+  Local<Context> context = isolate->GetCurrentContext();
+  unsigned dim = info[0]->Uint32Value(context).FromJust();
+  unsigned count = info[1]->Uint32Value(context).FromJust();
+  unsigned skip = info[2]->Uint32Value(context).FromJust();
+  Local<Float64Array> x = info[3].As<Float64Array>();
+  double* data = reinterpret_cast<double*>(static_cast<char*>(x->Buffer()->GetBackingStore()->Data()) + x->ByteOffset());
+  nlopt_result code = nlopt_sobol_points(dim, count, skip, data);
+  if (code == NLOPT_OUT_OF_MEMORY) {
+    isolate->ThrowException(Exception::Error(String::NewFromUtf8(isolate, "Out of memory.").ToLocalChecked()));
+  }
+  else if (code != NLOPT_SUCCESS) {
+    isolate->ThrowException(Exception::RangeError(String::NewFromUtf8(isolate, "Invalid Sobol' dimension, count or skip.").ToLocalChecked()));
+  }
+}
+
 NAN_MODULE_INIT(init) {
   Nan::Export(target, "optimize", Optimize);
+  Nan::Export(target, "sobol", Sobol);
 }
 
 NAN_MODULE_WORKER_ENABLED(nlopt, init)
@@ -1,15 +1,33 @@
 (function() {
-  var _, algorithms, optimize;
+  var POOL_CONTROL_WORDS, POOL_COUNT, POOL_DONE, POOL_ERROR, POOL_ERROR_BYTES, POOL_ERROR_LENGTH, POOL_GEN, POOL_STOP, SLOT_CLAIMED, SLOT_FREE, SLOT_POSTED, Worker, _, algorithms, optimize, path, sobolPoints, workerSource;
 
   _ = require("lodash");
 
+  path = require("path");
+
+  Worker = require("worker_threads").Worker;
+
   algorithms = ["GN_DIRECT", "GN_DIRECT_L", "GN_DIRECT_L_RAND", "GN_DIRECT_NOSCAL", "GN_DIRECT_L_NOSCAL", "GN_DIRECT_L_RAND_NOSCAL", "GN_ORIG_DIRECT", "GN_ORIG_DIRECT_L", "GD_STOGO", "GD_STOGO_RAND", "LD_LBFGS_NOCEDAL", "LD_LBFGS", "LN_PRAXIS", "LD_VAR1", "LD_VAR2", "LD_TNEWTON", "LD_TNEWTON_RESTART", "LD_TNEWTON_PRECOND", "LD_TNEWTON_PRECOND_RESTART", "GN_CRS2_LM", "GN_MLSL", "GD_MLSL", "GN_MLSL_LDS", "GD_MLSL_LDS", "LD_MMA", "LN_COBYLA", "LN_NEWUOA", "LN_NEWUOA_BOUND", "LN_NELDERMEAD", "LN_SBPLX", "LN_AUGLAG", "LD_AUGLAG", "LN_AUGLAG_EQ", "LD_AUGLAG_EQ", "LN_BOBYQA", "GN_ISRES", "AUGLAG", "AUGLAG_EQ", "G_MLSL", "G_MLSL_LDS", "LD_SLSQP", "LD_CCSAQ"];
 
   optimize = require('./build/Release/nlopt').optimize;
 
+  sobolPoints = require('./build/Release/nlopt').sobol;
+
   module.exports = function(options) {
-    var i, isArrayOfCallbackTolObjects, isArrayOfDoubles, isArrayOfMultiCallbackTolObjects, len, parm, ref;
+    var i, isArrayOfCallbackTolObjects, isArrayOfDoubles, isArrayOfMultiCallbackTolObjects, isLinearConstraintObject, isVectorOfDoubles, j, len, len1, parm, progress, ref, ref1, signal, workerPool;
+    progress = options.progress;
+    signal = options.signal;
+    workerPool = options.workerPool;
     options = _.cloneDeep(options);
+    if (progress != null) {
+      options.progress = progress;
+    }
+    if (signal != null) {
+      options.signal = signal;
+    }
+    if (workerPool != null) {
+      options.workerPool = workerPool;
+    }
     if (!options.algorithm) {
       throw "'algorithm' must be specified";
     }
@@ -33,6 +51,23 @@
           return acc && _.isObject(val) && _.isFunction(val.callback) && isArrayOfDoubles(val.tolerances);
         }), true);
       };
+      isVectorOfDoubles = function(arr) {
+        return arr instanceof Float64Array || isArrayOfDoubles(arr);
+      };
+      isLinearConstraintObject = function(obj, matrix, rhs) {
+        var m;
+        if (!_.isObject(obj) || !isVectorOfDoubles(obj[rhs])) {
+          return false;
+        }
+        if ((obj.tolerances != null) && !isVectorOfDoubles(obj.tolerances)) {
+          return false;
+        }
+        if ((obj.tolerance != null) && !_.isNumber(obj.tolerance)) {
+          return false;
+        }
+        m = obj[matrix];
+        return isVectorOfDoubles(m) || (_.isObject(m) && isVectorOfDoubles(m.values) && (m.rowPointers != null) && (m.columnIndices != null));
+      };
       if (!options.numberOfParameters) {
         throw "'numberOfParameters' must be specified";
       }
@@ -66,18 +101,244 @@
       if (options.equalityMConstraints && !isArrayOfMultiCallbackTolObjects(options.equalityMConstraints)) {
         throw "'equalityMConstraints' should be an array of {callback:function(){}, tolerances::number[]} objects";
       }
+      if (options.linearInequalities && !isLinearConstraintObject(options.linearInequalities, "A", "b")) {
+        throw "'linearInequalities' should be a {A:Float64Array|{rowPointers, columnIndices, values}, b:number[]} object";
+      }
+      if (options.linearEqualities && !isLinearConstraintObject(options.linearEqualities, "C", "d")) {
+        throw "'linearEqualities' should be a {C:Float64Array|{rowPointers, columnIndices, values}, d:number[]} object";
+      }
+      if (options.evaluationStore && !(_.isObject(options.evaluationStore) && _.isString(options.evaluationStore.path) && _.isString(options.evaluationStore.fingerprint))) {
+        throw "'evaluationStore' should be a {path:string, fingerprint:string} object";
+      }
+      if (options.evaluationTrace && !(_.isObject(options.evaluationTrace) && _.isString(options.evaluationTrace.record || options.evaluationTrace.replay) && !(options.evaluationTrace.record && options.evaluationTrace.replay))) {
+        throw "'evaluationTrace' should be a {record:string} or {replay:string} object";
+      }
+      if ((options.instrumentation != null) && !_.isBoolean(options.instrumentation)) {
+        throw "'instrumentation' must be a boolean";
+      }
+      if ((options.timeline != null) && !_.isString(options.timeline)) {
+        throw "'timeline' must be a string";
+      }
+      if ((options.progress != null) && !(options.progress instanceof SharedArrayBuffer)) {
+        throw "'progress' must be a SharedArrayBuffer";
+      }
+      if ((options.signal != null) && !(options.signal instanceof Int32Array || ((typeof AbortSignal !== "undefined" && AbortSignal !== null) && options.signal instanceof AbortSignal))) {
+        throw "'signal' must be an AbortSignal or an Int32Array";
+      }
+      if (options.workerPool != null) {
+        if (!(_.isObject(options.workerPool) && options.workerPool.buffer instanceof SharedArrayBuffer)) {
+          throw "'workerPool' must be a pool from nlopt.createWorkerPool";
+        }
+        if (options.workerPool.numberOfParameters !== options.numberOfParameters) {
+          throw "'workerPool' was created for a different numberOfParameters";
+        }
+        if ((options.minObjectiveFunction || options.maxObjectiveFunction) !== options.workerPool.objective) {
+          throw "'workerPool' requires its objective as minObjectiveFunction or maxObjectiveFunction";
+        }
+        if (options.evaluationStore || options.evaluationTrace) {
+          throw "'workerPool' cannot be combined with 'evaluationStore' or 'evaluationTrace'";
+        }
+      }
       if (options.initialGuess && !isArrayOfDoubles(options.initialGuess)) {
         throw "'initialGuess' should be an array of doubles";
       }
-      ref = ["stopValue", "fToleranceRelative", "fToleranceAbsolute", "xToleranceRelative", "xToleranceAbsolute", "maxEval", "maxTime"];
+      ref = ["stopValue", "fToleranceRelative", "fToleranceAbsolute", "xToleranceRelative", "xToleranceAbsolute", "maxEval", "maxTime", "evalCacheSize", "evalCacheTolerance", "stallWindow", "stallImprovement"];
       for (i = 0, len = ref.length; i < len; i++) {
         parm = ref[i];
         if (options[parm] && !_.isNumber(options[parm])) {
           throw "'" + parm + "' must be a double";
         }
       }
+      ref1 = ["seed", "seedStream"];
+      for (j = 0, len1 = ref1.length; j < len1; j++) {
+        parm = ref1[j];
+        if ((options[parm] != null) && !(_.isNumber(options[parm]) && options[parm] >= 0 && options[parm] % 1 === 0)) {
+          throw "'" + parm + "' must be a non-negative integer";
+        }
+      }
+      if ((options.crsBatchSize != null) && !(_.isNumber(options.crsBatchSize) && options.crsBatchSize >= 1 && options.crsBatchSize % 1 === 0)) {
+        throw "'crsBatchSize' must be a positive integer";
+      }
     }
     return optimize(options);
   };
 
+  module.exports.sobol = function(dim, count, options) {
+    var i, len, name, ref, ref1, ref2, skip, value, x;
+    if (options == null) {
+      options = {};
+    }
+    skip = (ref = options.skip) != null ? ref : 0;
+    if (!(_.isNumber(dim) && dim % 1 === 0 && dim >= 1 && dim <= 21201)) {
+      throw "'dim' must be an integer from 1 to 21201";
+    }
+    ref1 = [["count", count], ["skip", skip]];
+    for (i = 0, len = ref1.length; i < len; i++) {
+      ref2 = ref1[i], name = ref2[0], value = ref2[1];
+      if (!(_.isNumber(value) && value % 1 === 0 && value >= 0)) {
+        throw "'" + name + "' must be a non-negative integer";
+      }
+    }
+    if (skip + count > 4294967295) {
+      throw "'skip' + 'count' must be at most 4294967295";
+    }
+    x = new Float64Array(dim * count);
+    sobolPoints(dim, count, skip, x);
+    return x;
+  };
+
+  module.exports.progressBufferBytes = function(numberOfParameters) {
+    return 40 + 8 * numberOfParameters;
+  };
+
+  module.exports.readProgress = function(buffer, numberOfParameters) {
+    var done, fields, header, sequence, values;
+    header = new Int32Array(buffer, 0, 2);
+    fields = new Float64Array(buffer, 8, 4 + numberOfParameters);
+    while (true) {
+      sequence = Atomics.load(header, 0);
+      if (sequence & 1) {
+        continue;
+      }
+      values = fields.slice();
+      done = Atomics.load(header, 1);
+      if (Atomics.load(header, 0) === sequence) {
+        break;
+      }
+    }
+    return {
+      bestValue: values[0],
+      bestParameters: Array.from(values.subarray(4)),
+      evaluations: values[1],
+      elapsedSeconds: values[2],
+      iterations: values[3],
+      done: done === 1
+    };
+  };
+
+  POOL_GEN = 0;
+
+  POOL_COUNT = 1;
+
+  POOL_DONE = 2;
+
+  POOL_STOP = 3;
+
+  POOL_ERROR = 4;
+
+  POOL_ERROR_LENGTH = 5;
+
+  POOL_CONTROL_WORDS = 8;
+
+  POOL_ERROR_BYTES = 1024;
+
+  SLOT_FREE = 0;
+
+  SLOT_POSTED = 1;
+
+  SLOT_CLAIMED = 2;
+
+  workerSource = "const {workerData} = require(\"worker_threads\");\nconst {buffer, modulePath, numberOfParameters: n, capacity, layout} = workerData;\nconst control = new Int32Array(buffer, 0, layout.controlWords);\nconst slots = new Int32Array(buffer, 4*layout.controlWords, capacity);\nconst message = new Uint8Array(buffer, layout.errorOffset, layout.errorBytes);\nconst x = new Float64Array(buffer, layout.dataOffset, capacity*n);\nconst f = new Float64Array(buffer, layout.dataOffset + 8*capacity*n, capacity);\nfunction fail(e) {\n\tif (Atomics.compareExchange(control, layout.ERROR, 0, 1) == 0) {\n\t\tconst bytes = new TextEncoder().encode(String(e && e.stack || e)).subarray(0, layout.errorBytes);\n\t\tmessage.set(bytes);\n\t\tAtomics.store(control, layout.ERROR_LENGTH, bytes.length);\n\t}\n}\nlet objective = null, loadError = null;\ntry {\n\tobjective = require(modulePath);\n\tif (typeof objective != \"function\") throw new TypeError(modulePath + \" must export the objective function\");\n} catch (e) {\n\tobjective = null;\n\tloadError = e;\n}\nlet generation = 0;\nfor (;;) {\n\tAtomics.wait(control, layout.GEN, generation);\n\tgeneration = Atomics.load(control, layout.GEN);\n\tif (Atomics.load(control, layout.STOP)) break;\n\tconst count = Atomics.load(control, layout.COUNT);\n\tfor (let k = 0; k < count; ++k) {\n\t\tif (Atomics.compareExchange(slots, k, layout.SLOT_POSTED, layout.SLOT_CLAIMED) != layout.SLOT_POSTED) continue;\n\t\tlet value = NaN;\n\t\ttry {\n\t\t\tif (!objective) throw loadError;\n\t\t\tvalue = objective(n, x.subarray(k*n, (k+1)*n), null);\n\t\t\tif (typeof value != \"number\") throw new TypeError(\"Objective function must return a number.\");\n\t\t} catch (e) {\n\t\t\tfail(e);\n\t\t}\n\t\tf[k] = value;\n\t\tAtomics.store(slots, k, layout.SLOT_FREE);\n\t\tif (Atomics.add(control, layout.DONE, 1) + 1 >= Atomics.load(control, layout.COUNT)) Atomics.notify(control, layout.DONE);\n\t}\n}";
+
+  module.exports.createWorkerPool = function(options) {
+    var buffer, capacity, control, dataOffset, errorOffset, i, layout, modulePath, n, ref, ref1, run, slots, threads, worker, workers;
+    if (!_.isString(options != null ? options.module : void 0)) {
+      throw "'module' must be the path of a module exporting the objective function";
+    }
+    if (!_.isNumber(options.numberOfParameters)) {
+      throw "'numberOfParameters' must be a number";
+    }
+    n = options.numberOfParameters;
+    workers = (ref = options.workers) != null ? ref : require("os").cpus().length;
+    if (!(_.isNumber(workers) && workers >= 1)) {
+      throw "'workers' must be a positive number";
+    }
+    capacity = (ref1 = options.capacity) != null ? ref1 : 256;
+    if (!(_.isNumber(capacity) && capacity >= 1)) {
+      throw "'capacity' must be a positive number";
+    }
+    modulePath = path.resolve(options.module);
+    errorOffset = 4 * (POOL_CONTROL_WORDS + capacity);
+    dataOffset = 8 * Math.ceil((errorOffset + POOL_ERROR_BYTES) / 8);
+    buffer = new SharedArrayBuffer(dataOffset + 8 * capacity * (n + 1));
+    control = new Int32Array(buffer, 0, POOL_CONTROL_WORDS);
+    slots = new Int32Array(buffer, 4 * POOL_CONTROL_WORDS, capacity);
+    layout = {
+      controlWords: POOL_CONTROL_WORDS,
+      errorOffset: errorOffset,
+      errorBytes: POOL_ERROR_BYTES,
+      dataOffset: dataOffset,
+      GEN: POOL_GEN,
+      COUNT: POOL_COUNT,
+      DONE: POOL_DONE,
+      STOP: POOL_STOP,
+      ERROR: POOL_ERROR,
+      ERROR_LENGTH: POOL_ERROR_LENGTH,
+      SLOT_FREE: SLOT_FREE,
+      SLOT_POSTED: SLOT_POSTED,
+      SLOT_CLAIMED: SLOT_CLAIMED
+    };
+    threads = (function() {
+      var j, ref2, results;
+      results = [];
+      for (i = j = 0, ref2 = workers; 0 <= ref2 ? j < ref2 : j > ref2; i = 0 <= ref2 ? ++j : --j) {
+        worker = new Worker(workerSource, {
+          eval: true,
+          workerData: {
+            buffer: buffer,
+            modulePath: modulePath,
+            numberOfParameters: n,
+            capacity: capacity,
+            layout: layout
+          }
+        });
+        worker.unref();
+        results.push(worker);
+      }
+      return results;
+    })();
+    run = function(count) {
+      var done, j, k, length, message, ref2;
+      if (Atomics.load(control, POOL_STOP)) {
+        throw "the worker pool is closed";
+      }
+      Atomics.store(control, POOL_COUNT, count);
+      Atomics.store(control, POOL_DONE, 0);
+      for (k = j = 0, ref2 = count; 0 <= ref2 ? j < ref2 : j > ref2; k = 0 <= ref2 ? ++j : --j) {
+        Atomics.store(slots, k, SLOT_POSTED);
+      }
+      Atomics.add(control, POOL_GEN, 1);
+      Atomics.notify(control, POOL_GEN);
+      while ((done = Atomics.load(control, POOL_DONE)) < count) {
+        Atomics.wait(control, POOL_DONE, done);
+      }
+      if (Atomics.load(control, POOL_ERROR)) {
+        length = Atomics.load(control, POOL_ERROR_LENGTH);
+        message = new TextDecoder().decode(new Uint8Array(buffer, errorOffset, length).slice());
+        Atomics.store(control, POOL_ERROR, 0);
+        throw new Error("objective failed in a worker: " + message);
+      }
+    };
+    return {
+      numberOfParameters: n,
+      workers: workers,
+      capacity: capacity,
+      buffer: buffer,
+      x: new Float64Array(buffer, dataOffset, capacity * n),
+      f: new Float64Array(buffer, dataOffset + 8 * capacity * n, capacity),
+      objective: require(modulePath),
+      run: run,
+      close: function() {
+        var j, len;
+        Atomics.store(control, POOL_STOP, 1);
+        Atomics.add(control, POOL_GEN, 1);
+        Atomics.notify(control, POOL_GEN);
+        for (j = 0, len = threads.length; j < len; j++) {
+          worker = threads[j];
+          worker.terminate();
+        }
+      }
+    };
+  };
+
 }).call(this);
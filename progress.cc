@@ -0,0 +1,53 @@
+#include "progress.h"
+#include "instrumentation.h"
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "std::atomic<uint32_t> must be a plain 32-bit word");
+
+ProgressBuffer::ProgressBuffer(void* data, unsigned n, bool maximize)
+  : sequence(static_cast<std::atomic<uint32_t>*>(data)),
+    done(static_cast<std::atomic<uint32_t>*>(data) + 1),
+    fields(reinterpret_cast<double*>(static_cast<char*>(data) + 8)),
+    n(n), maximize(maximize), haveBest(false), best(NAN),
+    start(monotonicNanoseconds()), evaluations(0), iterations(0) {
+  done->store(0, std::memory_order_relaxed);
+  std::vector<double> nan(n, NAN);
+  publish(nan.data());
+}
+
+void ProgressBuffer::publish(const double* x) {
+  uint32_t s = sequence->load(std::memory_order_relaxed);
+  sequence->store(s + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  fields[0] = best;
+  fields[1] = (double)evaluations;
+  fields[2] = (monotonicNanoseconds() - start) * 1e-9;
+  fields[3] = (double)iterations;
+  if (x) {
+    memcpy(fields + 4, x, sizeof(double) * n);
+  }
+  sequence->store(s + 2, std::memory_order_release);
+}
+
+void ProgressBuffer::evaluated(const double* x, double f) {
+  ++evaluations;
+  bool improved = !haveBest ? !isnan(f) : maximize ? f > best : f < best;
+  if (improved) {
+    haveBest = true;
+    best = f;
+  }
+  publish(improved ? x : NULL);
+}
+
+void ProgressBuffer::iteration() {
+  ++iterations;
+  publish(NULL);
+}
+
+void ProgressBuffer::finish(const double* x, double f) {
+  best = f;
+  publish(x);
+  done->store(1, std::memory_order_release);
+}
@@ -0,0 +1,44 @@
+#ifndef NODE_NLOPT_PROGRESS_H
+#define NODE_NLOPT_PROGRESS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Progress of a running optimization, published into caller-provided shared
+// memory (a SharedArrayBuffer) so other threads can watch it without any
+// callbacks. Layout, all little-endian host order:
+//   bytes  0- 3  uint32 sequence: odd while an update is being written
+//   bytes  4- 7  uint32 done: 1 once optimize has returned
+//   bytes  8-15  double best objective value so far (NaN before the first)
+//   bytes 16-23  double objective evaluations
+//   bytes 24-31  double elapsed seconds
+//   bytes 32-39  double outer iterations (for algorithms that report them)
+//   bytes 40-    double best x[n]
+// A reader loads the sequence, copies the fields, and loads the sequence
+// again; it retries if the value was odd or changed (a seqlock), so it never
+// sees a half-written update and the solver never waits for readers.
+class ProgressBuffer {
+public:
+  static const size_t HEADER_BYTES = 40;
+  static size_t bytes(unsigned n) { return HEADER_BYTES + sizeof(double) * n; }
+
+  ProgressBuffer(void* data, unsigned n, bool maximize);
+
+  void evaluated(const double* x, double f); // an objective evaluation
+  void iteration();
+  void finish(const double* x, double f);    // the result of optimize
+
+private:
+  void publish(const double* x);
+
+  std::atomic<uint32_t>* sequence;
+  std::atomic<uint32_t>* done;
+  double* fields;
+  unsigned n;
+  bool maximize, haveBest;
+  double best;
+  uint64_t start, evaluations, iterations;
+};
+
+#endif
@@ -110,7 +110,7 @@
       expectedResult.status = 'Success: Optimization stopped because xToleranceRelative or xToleranceAbsolute was reached';
       return checkResults(nlopt(options), expectedResult);
     });
-    return it('example', function() {
+    it('example', function() {
       var createMyConstraint, expectedResult, myfunc, options;
       myfunc = function(n, x, grad) {
         if (grad) {
@@ -156,6 +156,470 @@
       options.algorithm = "NLOPT_LN_COBYLA";
       return checkResults(nlopt(options), expectedResult);
     });
+    it('linear constraints', function() {
+      var e, expectedResult, message, objectiveFunc, options;
+      objectiveFunc = function(n, x, grad) {
+        if (grad) {
+          grad[0] = 2 * (x[0] - 1);
+          grad[1] = 2 * (x[1] - 2);
+          grad[2] = 2 * (x[2] - 3);
+        }
+        return (x[0] - 1) * (x[0] - 1) + (x[1] - 2) * (x[1] - 2) + (x[2] - 3) * (x[2] - 3);
+      };
+      expectedResult = {
+        minObjectiveFunction: 'Success',
+        xToleranceRelative: 'Success',
+        linearInequalities: 'Success',
+        linearEqualities: 'Success',
+        initialGuess: 'Success',
+        status: 'Success: Optimization stopped because xToleranceRelative or xToleranceAbsolute was reached',
+        parameterValues: [0.5, 0.5, 2],
+        outputValue: 3.5
+      };
+      options = {
+        algorithm: "LD_SLSQP",
+        numberOfParameters: 3,
+        minObjectiveFunction: objectiveFunc,
+        linearInequalities: {
+          A: new Float64Array([1, 1, 1]),
+          b: [3]
+        },
+        linearEqualities: {
+          C: {
+            rowPointers: [0, 2],
+            columnIndices: [0, 1],
+            values: [1, -1]
+          },
+          d: [0],
+          tolerance: 1e-8
+        },
+        xToleranceRelative: 1e-8,
+        initialGuess: [0, 0, 0]
+      };
+      checkResults(nlopt(options), expectedResult);
+      options.linearEqualities = {
+        C: {
+          rowPointers: new Int32Array([0, 2000000, 3]),
+          columnIndices: [0, 1, 2],
+          values: [1, 1, 1]
+        },
+        d: [0, 0]
+      };
+      message = null;
+      try {
+        nlopt(options);
+      } catch (error) {
+        e = error;
+        message = e.message;
+      }
+      return checkResults(message, "'linearEqualities': sparse matrix row pointers must be nondecreasing");
+    });
+    it('evaluation store', function() {
+      var calls, first, firstCalls, options, path, second;
+      path = require('path').join(require('os').tmpdir(), "nlopt-test-" + process.pid + ".evals");
+      calls = 0;
+      options = {
+        algorithm: "LN_NELDERMEAD",
+        numberOfParameters: 2,
+        minObjectiveFunction: function(n, x) {
+          calls++;
+          return (x[0] - 1) * (x[0] - 1) + (x[1] + 2) * (x[1] + 2);
+        },
+        xToleranceRelative: 1e-6,
+        initialGuess: [0, 0],
+        evaluationStore: {
+          path: path,
+          fingerprint: "paraboloid"
+        }
+      };
+      try {
+        first = nlopt(options);
+        firstCalls = calls;
+        second = nlopt(options);
+        checkResults(second.parameterValues, first.parameterValues);
+        return checkResults([calls, second.storeHits, second.storeMisses], [firstCalls, firstCalls, 0]);
+      } finally {
+        require('fs').unlinkSync(path);
+      }
+    });
+    it('evaluation store skips torn records', function() {
+      var calls, first, firstCalls, fs, options, path, second;
+      fs = require('fs');
+      path = require('path').join(require('os').tmpdir(), "nlopt-test-" + process.pid + ".evals");
+      calls = 0;
+      options = {
+        algorithm: "LN_NELDERMEAD",
+        numberOfParameters: 2,
+        minObjectiveFunction: function(n, x) {
+          calls++;
+          return (x[0] - 1) * (x[0] - 1) + (x[1] + 2) * (x[1] + 2);
+        },
+        xToleranceRelative: 1e-6,
+        initialGuess: [0, 0],
+        evaluationStore: {
+          path: path,
+          fingerprint: "paraboloid"
+        }
+      };
+      try {
+        nlopt(options);
+        fs.appendFileSync(path, Buffer.from("REC1torn record"));
+        options.initialGuess = [3, 3];
+        first = nlopt(options);
+        firstCalls = calls;
+        second = nlopt(options);
+        checkResults(second.parameterValues, first.parameterValues);
+        return checkResults([calls, second.storeMisses], [firstCalls, 0]);
+      } finally {
+        fs.unlinkSync(path);
+      }
+    });
+    it('evaluation store skips failed evaluations', function() {
+      var broken, calls, options, path, second;
+      path = require('path').join(require('os').tmpdir(), "nlopt-test-" + process.pid + ".evals");
+      broken = true;
+      calls = 0;
+      options = {
+        algorithm: "LN_NELDERMEAD",
+        numberOfParameters: 2,
+        minObjectiveFunction: function(n, x) {
+          calls++;
+          if (broken) {
+            return "not a number";
+          }
+          return (x[0] - 1) * (x[0] - 1) + (x[1] + 2) * (x[1] + 2);
+        },
+        xToleranceRelative: 1e-6,
+        maxEval: 20,
+        initialGuess: [0, 0],
+        evaluationStore: {
+          path: path,
+          fingerprint: "paraboloid"
+        }
+      };
+      try {
+        nlopt(options);
+        broken = false;
+        calls = 0;
+        second = nlopt(options);
+        return checkResults([second.storeHits, second.storeMisses], [0, calls]);
+      } finally {
+        require('fs').unlinkSync(path);
+      }
+    });
+    it('evaluation trace', function() {
+      var calls, options, path, recorded, recordedCalls, replayed;
+      path = require('path').join(require('os').tmpdir(), "nlopt-test-" + process.pid + ".trace");
+      calls = 0;
+      options = {
+        algorithm: "LD_SLSQP",
+        numberOfParameters: 2,
+        minObjectiveFunction: function(n, x, grad) {
+          calls++;
+          if (grad) {
+            grad[0] = 2 * (x[0] - 1);
+            grad[1] = 2 * (x[1] + 2);
+          }
+          return (x[0] - 1) * (x[0] - 1) + (x[1] + 2) * (x[1] + 2);
+        },
+        xToleranceRelative: 1e-6,
+        initialGuess: [0, 0],
+        evaluationTrace: {
+          record: path
+        }
+      };
+      try {
+        recorded = nlopt(options);
+        recordedCalls = calls;
+        options.evaluationTrace = {
+          replay: path
+        };
+        replayed = nlopt(options);
+        checkResults(replayed.parameterValues, recorded.parameterValues);
+        return checkResults([calls, replayed.traceEvaluations, replayed.traceDivergedAt], [recordedCalls, recordedCalls, void 0]);
+      } finally {
+        require('fs').unlinkSync(path);
+      }
+    });
+    it('instrumentation', function() {
+      var options, result, stats;
+      options = {
+        algorithm: "LD_SLSQP",
+        numberOfParameters: 2,
+        minObjectiveFunction: function(n, x, grad) {
+          if (grad) {
+            grad[0] = 2 * (x[0] - 1);
+            grad[1] = 2 * (x[1] + 2);
+          }
+          return (x[0] - 1) * (x[0] - 1) + (x[1] + 2) * (x[1] + 2);
+        },
+        inequalityConstraints: [
+          {
+            callback: (function(n, x, grad) {
+              if (grad) {
+                grad[0] = 1;
+                grad[1] = 0;
+              }
+              return x[0] - 0.5;
+            }),
+            tolerance: 1e-8
+          }
+        ],
+        xToleranceRelative: 1e-6,
+        initialGuess: [0, 0],
+        instrumentation: true
+      };
+      result = nlopt(options);
+      checkResults(result.parameterValues, [0.5, -2]);
+      stats = result.instrumentation;
+      checkResults(_.map(stats.functions, 'name'), ['objective', 'inequalityConstraints[0]']);
+      checkResults(stats.functions[0].evaluations, stats.numevals);
+      checkResults(stats.functions[0].callbackLatency.count, stats.numevals);
+      if (!(stats.solverSeconds >= 0 && stats.callbackSeconds >= 0 && stats.totalSeconds >= stats.callbackSeconds)) {
+        throw new Error("inconsistent timings " + (JSON.stringify(stats)));
+      }
+    });
+    it('timeline', function() {
+      var calls, depth, e, events, j, len, options, path, result, runs;
+      path = require('os').tmpdir() + ("/nlopt-test-" + process.pid + ".json");
+      calls = 0;
+      options = {
+        algorithm: "LD_AUGLAG",
+        numberOfParameters: 2,
+        minObjectiveFunction: function(n, x, grad) {
+          calls++;
+          if (grad) {
+            grad[0] = 2 * (x[0] - 1);
+            grad[1] = 2 * (x[1] + 2);
+          }
+          return (x[0] - 1) * (x[0] - 1) + (x[1] + 2) * (x[1] + 2);
+        },
+        equalityConstraints: [
+          {
+            callback: (function(n, x, grad) {
+              if (grad) {
+                grad[0] = 1;
+                grad[1] = 1;
+              }
+              return x[0] + x[1];
+            }),
+            tolerance: 1e-8
+          }
+        ],
+        xToleranceRelative: 1e-6,
+        initialGuess: [0, 0],
+        timeline: path
+      };
+      try {
+        result = nlopt(options);
+        checkResults(result.timeline, "Success");
+        events = JSON.parse(require('fs').readFileSync(path, 'utf8')).traceEvents;
+        depth = 0;
+        for (j = 0, len = events.length; j < len; j++) {
+          e = events[j];
+          if (!(e.tid === 1)) {
+            continue;
+          }
+          depth += e.ph === 'B' ? 1 : e.ph === 'E' ? -1 : 0;
+          if (depth < 0) {
+            throw new Error("unbalanced timeline");
+          }
+        }
+        checkResults(depth, 0);
+        runs = _.map(_.filter(events, {
+          cat: 'run'
+        }), 'name');
+        checkResults(runs[0], 'LD_AUGLAG');
+        if (runs.length < 2) {
+          throw new Error("no nested local optimizations in " + runs);
+        }
+        return checkResults(_.filter(events, {
+          cat: 'callback',
+          name: 'objective'
+        }).length, calls);
+      } finally {
+        require('fs').unlinkSync(path);
+      }
+    });
+    it('progress', function() {
+      var buffer, calls, options, progress, result;
+      buffer = new SharedArrayBuffer(nlopt.progressBufferBytes(2));
+      calls = 0;
+      options = {
+        algorithm: "LN_COBYLA",
+        numberOfParameters: 2,
+        minObjectiveFunction: function(n, x, grad) {
+          checkResults(nlopt.readProgress(buffer, 2).evaluations, calls);
+          calls++;
+          return (x[0] - 1) * (x[0] - 1) + (x[1] + 2) * (x[1] + 2);
+        },
+        xToleranceRelative: 1e-6,
+        initialGuess: [0, 0],
+        progress: buffer
+      };
+      result = nlopt(options);
+      progress = nlopt.readProgress(buffer, 2);
+      checkResults([progress.done, progress.evaluations, progress.bestValue], [true, calls, result.outputValue]);
+      return checkResults(progress.bestParameters, result.parameterValues);
+    });
+    it('cancellation', function() {
+      var calls, cancel, cancellations, controller, flag, j, len, ref, result, results, signal;
+      flag = new Int32Array(new SharedArrayBuffer(4));
+      controller = new AbortController();
+      cancellations = [
+        {
+          signal: flag,
+          cancel: function() {
+            return Atomics.store(flag, 0, 1);
+          }
+        }, {
+          signal: controller.signal,
+          cancel: function() {
+            return controller.abort();
+          }
+        }
+      ];
+      results = [];
+      for (j = 0, len = cancellations.length; j < len; j++) {
+        ref = cancellations[j], signal = ref.signal, cancel = ref.cancel;
+        calls = 0;
+        result = nlopt({
+          algorithm: "LN_NELDERMEAD",
+          numberOfParameters: 2,
+          minObjectiveFunction: function(n, x, grad) {
+            if (++calls === 20) {
+              cancel();
+            }
+            return (x[0] - 1) * (x[0] - 1) + (x[1] + 2) * (x[1] + 2) + 1;
+          },
+          initialGuess: [0, 0],
+          maxEval: 10000,
+          signal: signal
+        });
+        checkResults([calls, result.status], [20, "Failure: Halted because of a forced termination"]);
+        if (!(result.outputValue >= 1 && result.outputValue < 6)) {
+          throw new Error("expected the best point so far, got " + result.outputValue);
+        } else {
+          results.push(void 0);
+        }
+      }
+      return results;
+    });
+    it('stall', function() {
+      var calls, result;
+      calls = 0;
+      result = nlopt({
+        algorithm: "GN_CRS2_LM",
+        numberOfParameters: 2,
+        minObjectiveFunction: function(n, x, grad) {
+          calls++;
+          return Math.max(x[0] * x[0] + x[1] * x[1], 0.01);
+        },
+        lowerBounds: [-5, -5],
+        upperBounds: [5, 5],
+        initialGuess: [4, 4],
+        maxEval: 100000,
+        stallWindow: 300
+      });
+      checkResults([result.status, result.stallWindow, result.outputValue], ["Success: Optimization stopped because the objective stalled for stallWindow evaluations", "Success", 0.01]);
+      if (!(calls < 100000)) {
+        throw new Error("expected the stall to stop the run early, got " + calls + " evaluations");
+      }
+    });
+    it('seed', function() {
+      var first, options, other, second;
+      options = {
+        algorithm: "GN_ISRES",
+        numberOfParameters: 2,
+        minObjectiveFunction: function(n, x, grad) {
+          return (x[0] - 1) * (x[0] - 1) + (x[1] + 2) * (x[1] + 2);
+        },
+        lowerBounds: [-5, -5],
+        upperBounds: [5, 5],
+        maxEval: 300,
+        seed: 7
+      };
+      first = nlopt(options);
+      second = nlopt(options);
+      options.seedStream = 1;
+      other = nlopt(options);
+      if (!_.isEqual(second.parameterValues, first.parameterValues)) {
+        throw new Error("expected the same seed to give the same result, got " + JSON.stringify(second.parameterValues) + " and " + JSON.stringify(first.parameterValues));
+      }
+      if (_.isEqual(other.parameterValues, first.parameterValues)) {
+        throw new Error("expected another seedStream to give another result");
+      }
+    });
+    it('workerPool', function() {
+      var options, pool, pooled, serial;
+      pool = nlopt.createWorkerPool({
+        module: __dirname + "/poolObjective.js",
+        numberOfParameters: 2,
+        workers: 2
+      });
+      options = {
+        algorithm: "GN_DIRECT_L",
+        numberOfParameters: 2,
+        minObjectiveFunction: pool.objective,
+        lowerBounds: [-5, -5],
+        upperBounds: [5, 5],
+        maxEval: 500,
+        instrumentation: true
+      };
+      try {
+        serial = nlopt(options);
+        options.workerPool = pool;
+        pooled = nlopt(options);
+      } finally {
+        pool.close();
+      }
+      checkResults([pooled.workerPool, pooled.status, pooled.outputValue, pooled.parameterValues[0], pooled.parameterValues[1]], ["Success", serial.status, serial.outputValue, serial.parameterValues[0], serial.parameterValues[1]]);
+      if (!(pool.objective.calls - 500 < 100)) {
+        throw new Error("expected most evaluations in the workers, got " + (pool.objective.calls - 500) + " of 500 on the main thread");
+      }
+    });
+    it('crsBatchSize', function() {
+      var calls, options, pool, pooled, serial;
+      pool = nlopt.createWorkerPool({
+        module: __dirname + "/poolObjective.js",
+        numberOfParameters: 2,
+        workers: 2
+      });
+      options = {
+        algorithm: "GN_CRS2_LM",
+        numberOfParameters: 2,
+        minObjectiveFunction: pool.objective,
+        lowerBounds: [-5, -5],
+        upperBounds: [5, 5],
+        maxEval: 800,
+        seed: 3,
+        crsBatchSize: 16
+      };
+      try {
+        serial = nlopt(options);
+        calls = pool.objective.calls;
+        options.workerPool = pool;
+        pooled = nlopt(options);
+      } finally {
+        pool.close();
+      }
+      checkResults([pooled.status, pooled.outputValue, pooled.parameterValues[0], pooled.parameterValues[1]], [serial.status, serial.outputValue, serial.parameterValues[0], serial.parameterValues[1]]);
+      if (!(pool.objective.calls - calls < 50)) {
+        throw new Error("expected most evaluations in the workers, got " + (pool.objective.calls - calls) + " of 800 on the main thread");
+      }
+    });
+    return it('sobol', function() {
+      var all, points, tail;
+      points = nlopt.sobol(3, 4);
+      checkResults(Array.from(points), [0.5, 0.5, 0.5, 0.75, 0.25, 0.75, 0.25, 0.75, 0.25, 0.375, 0.375, 0.625]);
+      all = nlopt.sobol(5000, 40);
+      tail = nlopt.sobol(5000, 15, {
+        skip: 25
+      });
+      if (!_.isEqual(Array.from(tail), Array.from(all.subarray(25 * 5000)))) {
+        throw new Error("points after skipping 25 differ from points 26-40");
+      }
+    });
   });
 
 }).call(this);
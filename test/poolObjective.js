@@ -0,0 +1,8 @@
+// Objective for the workerPool test, loaded by the main thread and by every
+// worker; calls counts the evaluations made by the thread that loaded it.
+var objective = function(n, x, grad) {
+  objective.calls++;
+  return (x[0] - 1) * (x[0] - 1) + (x[1] + 2) * (x[1] + 2) + 1;
+};
+objective.calls = 0;
+module.exports = objective;
@@ -0,0 +1,104 @@
+#include "timeline.h"
+#include "instrumentation.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+Timeline::Timeline() : start(monotonicNanoseconds()) {
+}
+
+void Timeline::begin(const std::string& name, const char* category, unsigned track) {
+  Event e = {'B', track, name, category, monotonicNanoseconds() - start, 0};
+  events.push_back(e);
+}
+
+void Timeline::end(unsigned track) {
+  Event e = {'E', track, std::string(), "", monotonicNanoseconds() - start, 0};
+  events.push_back(e);
+}
+
+void Timeline::beginRun(const char* algorithm) {
+  begin(algorithm, "run");
+  open.push_back(RUN);
+  iterations.push_back(0);
+}
+
+void Timeline::iteration() {
+  if (iterations.empty()) {
+    return;
+  }
+  if (open.back() == ITERATION) {
+    end();
+    open.pop_back();
+  }
+  begin("iteration " + std::to_string(++iterations.back()), "iteration");
+  open.push_back(ITERATION);
+}
+
+void Timeline::endRun() {
+  if (!open.empty() && open.back() == ITERATION) {
+    end();
+    open.pop_back();
+  }
+  if (!open.empty()) {
+    end();
+    open.pop_back();
+    iterations.pop_back();
+  }
+}
+
+void Timeline::beginCallback(const std::string& name) {
+  begin(name, "callback");
+}
+
+void Timeline::endCallback() {
+  end();
+}
+
+void Timeline::gcPause(uint64_t startNs, uint64_t endNs) {
+  Event e = {'X', 2, "GC", "gc", startNs - start, endNs - startNs};
+  events.push_back(e);
+}
+
+static void writeString(FILE* f, const std::string& s) {
+  fputc('"', f);
+  for (size_t i = 0; i < s.size(); ++i) {
+    if (s[i] == '"' || s[i] == '\\') {
+      fputc('\\', f);
+    }
+    fputc(s[i], f);
+  }
+  fputc('"', f);
+}
+
+bool Timeline::write(const char* path, std::string& err) const {
+  FILE* f = fopen(path, "w");
+  if (!f) {
+    err = std::string("cannot create ") + path + ": " + strerror(errno);
+    return false;
+  }
+  fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", f);
+  fputs("{\"ph\":\"M\",\"pid\":1,\"tid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"nlopt\"}},\n", f);
+  fputs("{\"ph\":\"M\",\"pid\":1,\"tid\":1,\"name\":\"thread_name\",\"args\":{\"name\":\"optimization\"}},\n", f);
+  fputs("{\"ph\":\"M\",\"pid\":1,\"tid\":2,\"name\":\"thread_name\",\"args\":{\"name\":\"GC\"}}", f);
+  for (size_t i = 0; i < events.size(); ++i) {
+    const Event& e = events[i];
+    // timestamps are in microseconds
+    fprintf(f, ",\n{\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%.3f", e.phase, e.track, e.ts * 1e-3);
+    if (e.phase != 'E') {
+      fputs(",\"name\":", f);
+      writeString(f, e.name);
+      fprintf(f, ",\"cat\":\"%s\"", e.category);
+    }
+    if (e.phase == 'X') {
+      fprintf(f, ",\"dur\":%.3f", e.dur * 1e-3);
+    }
+    fputc('}', f);
+  }
+  fputs("\n]}\n", f);
+  if (fclose(f) != 0) {
+    err = std::string("cannot write ") + path + ": " + strerror(errno);
+    return false;
+  }
+  return true;
+}
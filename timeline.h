@@ -0,0 +1,49 @@
+#ifndef NODE_NLOPT_TIMELINE_H
+#define NODE_NLOPT_TIMELINE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Timeline of one optimization in the Chrome Trace Event format (JSON),
+// which chrome://tracing and ui.perfetto.dev open directly. Runs of the
+// algorithm (including local optimizations nested inside MLSL or AUGLAG),
+// their outer iterations and the JS callbacks are properly nested duration
+// spans on one track; GC pauses, which V8 reports from inside callbacks,
+// go on a second track.
+class Timeline {
+public:
+  Timeline();
+
+  // nlopt_trace_func events
+  void beginRun(const char* algorithm);
+  void iteration();
+  void endRun();
+
+  void beginCallback(const std::string& name);
+  void endCallback();
+
+  void gcPause(uint64_t startNs, uint64_t endNs);
+
+  bool write(const char* path, std::string& err) const;
+
+private:
+  struct Event {
+    char phase;        // 'B', 'E' or 'X'
+    unsigned track;
+    std::string name;
+    const char* category;
+    uint64_t ts, dur;  // ns since the start
+  };
+  enum SpanKind { RUN, ITERATION };
+
+  void begin(const std::string& name, const char* category, unsigned track = 1);
+  void end(unsigned track = 1);
+
+  uint64_t start;
+  std::vector<Event> events;
+  std::vector<SpanKind> open;        // run/iteration spans still open on track 1
+  std::vector<unsigned> iterations;  // iteration counter of each open run
+};
+
+#endif